@@ -1,5 +1,6 @@
 #pragma once
 #include <stdarg.h>
+#include <stddef.h>
 
 // ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 // § Types
@@ -12,6 +13,7 @@ typedef int vdbTextureFormat;
 typedef int vdbTextureFilter;
 typedef int vdbTextureWrap;
 typedef int vdbTheme;
+typedef int vdbDataType;
 struct vdbVec2 { float x,y;     vdbVec2() { x=y=0;     } vdbVec2(float v) : x(v), y(v) { }             vdbVec2(float _x, float _y) : x(_x), y(_y) { } };
 struct vdbVec3 { float x,y,z;   vdbVec3() { x=y=z=0;   } vdbVec3(float v) : x(v), y(v), z(v) { }       vdbVec3(float _x, float _y, float _z) : x(_x), y(_y), z(_z) { } };
 struct vdbVec4 { float x,y,z,w; vdbVec4() { x=y=z=w=0; } vdbVec4(float v) : x(v), y(v), z(v), w(v) { } vdbVec4(float _x, float _y, float _z, float _w) : x(_x), y(_y), z(_z), w(_w) { } };
@@ -24,6 +26,13 @@ struct vdbRenderTargetDesc
     int stencil_bits;
 };
 
+// With VDB_DISABLE, the API compiles to nothing (see vdb_disabled.h). At
+// runtime, the environment variable VDB=0 makes breaks return false and log
+// and vertex calls return at once.
+#ifdef VDB_DISABLE
+#include "vdb_disabled.h"
+#else
+
 // ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 // § Enums
 // ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
@@ -41,6 +50,7 @@ extern vdbOrientation   VDB_X_DOWN,VDB_X_UP;
 extern vdbOrientation   VDB_Y_DOWN,VDB_Y_UP;
 extern vdbOrientation   VDB_Z_DOWN,VDB_Z_UP;
 extern vdbTheme         VDB_DARK_THEME,VDB_BRIGHT_THEME;
+extern vdbDataType      VDB_FLOAT32,VDB_FLOAT64,VDB_INT32,VDB_INT64,VDB_UINT8,VDB_FLOAT16;
 // extern vdbWidgetFlag    VDB_NOTIFY_ON_RELEASE;
 
 // ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
@@ -291,14 +301,19 @@ vdbVec2 vdbGetRenderOffsetFramebuffer();
 // ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 void    vdbMakeContextCurrent();
 void    vdbDetachContext();
+bool    vdbHasGLDebugOutput(); // OpenGL errors are reported by the driver as they happen (vdb built with VDB_DEBUG), so glGetError needn't be checked
 void    vdbStepOnce();
 void    vdbStepOver();
 bool    vdbBeginBreak(const char *label);
 void    vdbEndBreak();
 bool    vdbIsFirstFrame();
 bool    vdbIsDifferentLabel();
+float   vdbGetFrameDelta(); // seconds between the last two frames shown by a break (measured, at most VDB_MAX_FRAME_DELTA)
 void    vdbAutoStep(bool enabled);
+void    vdbLiveView(bool enabled); // breaks don't pause: a hit is only shown when the display is due for a frame (see VDB_LIVE_VIEW_FPS), and others return at once
+void    vdbWatch(); // call before the first break: breaks don't pause, each runs once and is shown by a viewer on its own thread, while the program keeps running
 void    vdbSaveScreenshot(const char *filename);
+void    vdbSaveScreenshotTiled(const char *filename, int width, int height); // Renders the block in tiles over the next frames and streams them to a PNG file (resolution may exceed the window and GPU limits)
 
 // ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 // § Logging
@@ -309,9 +324,22 @@ void    vdbLogPop();
 void    vdbLogScalar(const char *label, float x, int history=0);
 void    vdbLogMatrix(const char *label, float *x, int rows, int columns, int history=0);
 void    vdbLogVector(const char *label, float *x, int elements, int history=0);
+void    vdbLogArray(const char *label, const void *x, vdbDataType type, int rows, int columns=1, int history=0); // column-major, stored as the given type (e.g. VDB_INT32)
+void    vdbLogView(const char *label, const void *x, size_t bytes, vdbDataType type, int rows, int columns=1, int history=0); // like vdbLogArray, but x is only copied once the current break ends (it must stay valid until then)
 void    vdbLogDump(const char *filename);
+bool    vdbLogSave(const char *filename); // binary format, see vdbLogLoad
+bool    vdbLogLoad(const char *filename, const char *label); // maps a file saved with vdbLogSave into the group /label
+void    vdbLogSpill(const char *filename, int window=0); // moves old samples of logs without history to this file, keeping the newest window values (floats) of each in memory (0: VDB_LOG_SPILL_WINDOW)
 void    vdbLogShow(const char *id, const char *query);
 
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// § Trace files
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+void    vdbTraceRecord(const char *filename); // call before the first break: breaks run once without a window, and their drawing, images, widget values and logs go to this file
+bool    vdbTraceLoad(const char *filename); // loads a trace into the breakpoint history (Tools > History), see tools/vdbreplay
+bool    vdbRemote(const char *name); // call before the first break: breaks run once without a window and are sent to a viewer process (vdbRemoteView) through shared memory, or skipped if none is attached or it falls behind
+bool    vdbRemoteView(const char *name); // shows the hits sent by a vdbRemote client with this name as they arrive, see tools/vdbreplay
+
 // ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 // § Row-major versions of matrix functions:
 // Row-major assumes matrix elements are laid out in memory one row at a time.
@@ -335,6 +363,8 @@ void    vdbUniformMatrix4fv_RowMaj(const char *name, float *x);
 void    vdbUniformMatrix3fv_RowMaj(const char *name, float *x);
 void    vdbLogMatrix_RowMaj(const char *label, float *x, int rows, int columns);
 
+#endif // VDB_DISABLE
+
 // ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 // § Redefine row-major matrix as default
 // This simply redefines the some vdb functions to use the row-major version.
@@ -352,8 +382,15 @@ void    vdbLogMatrix_RowMaj(const char *label, float *x, int rows, int columns);
 #define vdbLogMatrix        vdbLogMatrix_RowMaj
 #endif
 
+#ifdef VDB_DISABLE
+#define VDBB(label) if (0) {
+#define VDBE() }
+#else
 #define VDBB(label) while (vdbBeginBreak(label)) {
 #define VDBE() vdbEndBreak(); }
+#endif
+
+#ifndef VDB_DISABLE
 
 extern vdbKey VDB_KEY_A;
 extern vdbKey VDB_KEY_B;
@@ -431,5 +468,6 @@ extern vdbKey VDB_KEY_RCTRL;
 extern vdbKey VDB_KEY_RSHIFT;
 extern vdbKey VDB_KEY_RALT; /**< alt gr, option */
 extern vdbKey VDB_KEY_RGUI; /**< windows, command (apple), meta */
+#endif
 
 enum { VDB_NUM_KEYS = 512 };
@@ -118,10 +118,14 @@ struct vdbGPUArray
 
 static vdbKernel vdb_active_kernel = 0;
 
+// When vdb has a debug context, the driver reports errors as they happen, so
+// there is no need to call glGetError (which waits for the driver to catch up).
+#define vdbAssertNoGLError() assert(vdbHasGLDebugOutput() || glGetError() == GL_NO_ERROR)
+
 void vdbGPUArrayEnsureWriteable(vdbGPUArray *a)
 {
     vdbMakeContextCurrent();
-    assert(glGetError() == GL_NO_ERROR);
+    vdbAssertNoGLError();
     if (!a->fbo)
     {
         assert(a->color0);
@@ -133,7 +137,7 @@ void vdbGPUArrayEnsureWriteable(vdbGPUArray *a)
         else if (a->target == GL_TEXTURE_2D)
             glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, a->target, a->color0, 0);
         glBindFramebuffer(GL_FRAMEBUFFER, 0);
-        assert(glGetError() == GL_NO_ERROR);
+        vdbAssertNoGLError();
     }
 }
 
@@ -148,7 +152,7 @@ vdbGPUArray *vdbCreateGPUArray(
     GLenum data_type)
 {
     vdbMakeContextCurrent();
-    assert(glGetError() == GL_NO_ERROR);
+    vdbAssertNoGLError();
     assert(channels > 0 && channels <= 4);
     assert(width > 0 && height > 0 && depth > 0);
     assert(channels == 1 || channels == 2 || channels == 4);
@@ -186,7 +190,7 @@ vdbGPUArray *vdbCreateGPUArray(
         glTexParameteri(target, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
         glTexParameteri(target, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
         glBindTexture(target, 0);
-        assert(glGetError() == GL_NO_ERROR);
+        vdbAssertNoGLError();
     }
 
     vdbGPUArray *a = (vdbGPUArray*)calloc(1, sizeof(vdbGPUArray));
@@ -202,7 +206,7 @@ vdbGPUArray *vdbCreateGPUArray(
     a->target = target;
     if (!data)
         vdbGPUArrayEnsureWriteable(a);
-    assert(glGetError() == GL_NO_ERROR);
+    vdbAssertNoGLError();
     return a;
 }
 
@@ -217,30 +221,30 @@ vdbGPUArray *vdbCreateGPUArray4ub(int w, int h, int d, const void *x) { return v
 void vdbDestroyGPUArray(vdbGPUArray *a)
 {
     vdbMakeContextCurrent();
-    assert(glGetError() == GL_NO_ERROR);
+    vdbAssertNoGLError();
     if (a)
     {
         glDeleteTextures(1, &a->color0);
         glDeleteFramebuffers(1, &a->fbo);
         free(a);
-        assert(glGetError() == GL_NO_ERROR);
+        vdbAssertNoGLError();
     }
 }
 
 void vdbGPUArrayToCPU(vdbGPUArray *a, void *cpu_memory)
 {
     vdbMakeContextCurrent();
-    assert(glGetError() == GL_NO_ERROR);
+    vdbAssertNoGLError();
     assert(cpu_memory);
     assert(a->color0);
-    assert(glGetError() == GL_NO_ERROR);
+    vdbAssertNoGLError();
     assert(a->target == GL_TEXTURE_1D || a->target == GL_TEXTURE_2D);
     assert(a->depth == 1);
     glPixelStorei(GL_PACK_ALIGNMENT, 1);
     glBindTexture(a->target, a->color0);
     glGetTexImage(a->target, 0, a->data_format, a->data_type, cpu_memory);
     glBindTexture(a->target, 0);
-    assert(glGetError() == GL_NO_ERROR);
+    vdbAssertNoGLError();
 }
 
 size_t vdbGPUArraySize(vdbGPUArray *a)
@@ -251,7 +255,7 @@ size_t vdbGPUArraySize(vdbGPUArray *a)
 void vdbGPUArrayClear(vdbGPUArray *a)
 {
     vdbMakeContextCurrent();
-    assert(glGetError() == GL_NO_ERROR);
+    vdbAssertNoGLError();
     vdbGPUArrayEnsureWriteable(a);
     assert(a->fbo);
     assert(a->color0);
@@ -260,12 +264,12 @@ void vdbGPUArrayClear(vdbGPUArray *a)
     glClearColor(0,0,0,0);
     glClear(GL_COLOR_BUFFER_BIT);
     glBindFramebuffer(GL_FRAMEBUFFER, last_framebuffer);
-    assert(glGetError() == GL_NO_ERROR);
+    vdbAssertNoGLError();
 }
 
 static GLuint vdbCompileShader(GLenum type, const char **sources, int num_sources)
 {
-    assert(glGetError() == GL_NO_ERROR);
+    vdbAssertNoGLError();
     GLuint shader = glCreateShader(type);
     assert(shader);
     glShaderSource(shader, num_sources, (const GLchar **)sources, 0);
@@ -282,13 +286,13 @@ static GLuint vdbCompileShader(GLenum type, const char **sources, int num_source
         glDeleteShader(shader);
         return 0;
     }
-    assert(glGetError() == GL_NO_ERROR);
+    vdbAssertNoGLError();
     return shader;
 }
 
 static bool vdbProgramLinkStatus(GLuint program)
 {
-    assert(glGetError() == GL_NO_ERROR);
+    vdbAssertNoGLError();
     GLint status; glGetProgramiv(program, GL_LINK_STATUS, &status);
     if (!status)
     {
@@ -300,14 +304,14 @@ static bool vdbProgramLinkStatus(GLuint program)
         free(info);
         return false;
     }
-    assert(glGetError() == GL_NO_ERROR);
+    vdbAssertNoGLError();
     return true;
 }
 
 vdbKernel vdbLoadComputeKernel(const char *source)
 {
     vdbMakeContextCurrent();
-    assert(glGetError() == GL_NO_ERROR);
+    vdbAssertNoGLError();
     assert(source);
     const char *vs_source = R"STR(
         #version 150
@@ -337,14 +341,14 @@ vdbKernel vdbLoadComputeKernel(const char *source)
     glDetachShader(program, fs);
     glDeleteShader(vs);
     glDeleteShader(fs);
-    assert(glGetError() == GL_NO_ERROR);
+    vdbAssertNoGLError();
     return program;
 }
 
 void vdbUseKernel(vdbKernel program)
 {
     vdbMakeContextCurrent();
-    assert(glGetError() == GL_NO_ERROR);
+    vdbAssertNoGLError();
 
     static GLint last_program;
     static GLint last_array_buffer;
@@ -388,7 +392,7 @@ void vdbUseKernel(vdbKernel program)
             assert(loc_iPosition >= 0);
             glEnableVertexAttribArray(loc_iPosition);
             glVertexAttribPointer(loc_iPosition, 2, GL_FLOAT, GL_FALSE, sizeof(GLfloat) * 2, 0);
-            assert(glGetError() == GL_NO_ERROR);
+            vdbAssertNoGLError();
         }
         else
         {
@@ -412,7 +416,7 @@ void vdbUseKernel(vdbKernel program)
             glViewport(last_viewport[0], last_viewport[1], (GLsizei)last_viewport[2], (GLsizei)last_viewport[3]);
             glScissor(last_scissor_box[0], last_scissor_box[1], (GLsizei)last_scissor_box[2], (GLsizei)last_scissor_box[3]);
             glActiveTexture(GL_TEXTURE0);
-            assert(glGetError() == GL_NO_ERROR);
+            vdbAssertNoGLError();
         }
     }
     else
@@ -458,20 +462,20 @@ void vdbUseKernel(vdbKernel program)
             assert(loc_iPosition >= 0);
             glEnableVertexAttribArray(loc_iPosition);
             glVertexAttribPointer(loc_iPosition, 2, GL_FLOAT, GL_FALSE, sizeof(GLfloat) * 2, 0);
-            assert(glGetError() == GL_NO_ERROR);
+            vdbAssertNoGLError();
         }
         else
         {
             // do nothing
         }
     }
-    assert(glGetError() == GL_NO_ERROR);
+    vdbAssertNoGLError();
 }
 
 void vdbRunKernel(vdbGPUArray *out)
 {
     vdbMakeContextCurrent();
-    assert(glGetError() == GL_NO_ERROR);
+    vdbAssertNoGLError();
     assert(out);
     vdbGPUArrayEnsureWriteable(out);
     glBindFramebuffer(GL_FRAMEBUFFER, out->fbo);
@@ -482,7 +486,7 @@ void vdbRunKernel(vdbGPUArray *out)
     else
         assert(false);
     glDrawArrays(GL_TRIANGLES, 0, 6);
-    assert(glGetError() == GL_NO_ERROR);
+    vdbAssertNoGLError();
 }
 
 void vdbUniformArray(const char *name, vdbGPUArray *v, int texture_unit)
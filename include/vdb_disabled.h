@@ -0,0 +1,327 @@
+#pragma once
+// With VDB_DISABLE defined before including vdb.h, every function of the API
+// is one of these inline no-ops, and VDBB(label) becomes if (0) {, so that
+// instrumented code compiles to nothing and doesn't need to link with vdb.
+// The enums and keys are all 0. Keep in sync with vdb.h (functions that
+// return a value return zero, and parameter names are commented out so that
+// -Wunused-parameter stays quiet).
+// § Enums
+static const vdbTextureFormat VDB_RGBA32F = 0, VDB_RGBA8 = 0;
+static const vdbTextureFilter VDB_LINEAR = 0, VDB_LINEAR_MIPMAP = 0, VDB_NEAREST = 0;
+static const vdbTextureWrap   VDB_CLAMP = 0, VDB_REPEAT = 0;
+static const vdbHintKey       VDB_CAMERA_TYPE = 0;
+static const vdbHintKey       VDB_ORIENTATION = 0;
+static const vdbHintKey       VDB_VIEW_SCALE = 0;
+static const vdbHintKey       VDB_SHOW_GRID = 0;
+static const vdbHintKey       VDB_CAMERA_KEY = 0;
+static const vdbHintKey       VDB_THEME = 0;
+static const vdbCameraType    VDB_PLANAR = 0, VDB_TRACKBALL = 0, VDB_TURNTABLE = 0;
+static const vdbOrientation   VDB_X_DOWN = 0, VDB_X_UP = 0;
+static const vdbOrientation   VDB_Y_DOWN = 0, VDB_Y_UP = 0;
+static const vdbOrientation   VDB_Z_DOWN = 0, VDB_Z_UP = 0;
+static const vdbTheme         VDB_DARK_THEME = 0, VDB_BRIGHT_THEME = 0;
+static const vdbDataType      VDB_FLOAT32 = 0, VDB_FLOAT64 = 0, VDB_INT32 = 0, VDB_INT64 = 0, VDB_UINT8 = 0, VDB_FLOAT16 = 0;
+
+// § Hints:
+static inline void    vdbHint(vdbHintKey /*key*/, int /*value*/) { }
+static inline void    vdbHint(vdbHintKey /*key*/, float /*value*/) { }
+static inline void    vdbHint(vdbHintKey /*key*/, bool /*value*/) { }
+
+// § Immediate mode 2D/3D drawing API
+static inline void    vdbInverseColor(bool /*enable*/) { }
+static inline void    vdbClearColor(float /*r*/, float /*g*/, float /*b*/, float /*a*/) { }
+static inline void    vdbClearDepth(float /*d*/) { }
+static inline void    vdbBlendNone() { }
+static inline void    vdbBlendAdd() { }
+static inline void    vdbBlendAlpha() { }
+static inline void    vdbCullFace(bool /*enable*/) { }
+static inline void    vdbDepthTest(bool /*enable*/) { }
+static inline void    vdbDepthWrite(bool /*enable*/) { }
+static inline void    vdbDepthFuncLess() { }
+static inline void    vdbDepthFuncLessOrEqual() { }
+static inline void    vdbDepthFuncAlways() { }
+static inline void    vdbLineWidth(float /*width*/) { }
+static inline void    vdbPointSegments(int /*segments*/) { }
+static inline void    vdbPointSize(float /*size*/) { }
+static inline void    vdbPointSize3D(float /*size*/) { }
+static inline void    vdbBeginLines() { }
+static inline void    vdbBeginPoints() { }
+static inline void    vdbBeginTriangles() { }
+static inline void    vdbEnd() { }
+static inline void    vdbVertex(float /*x*/, float /*y*/, float /*z*/=0.0f, float /*w*/=1.0f) { }
+static inline void    vdbColor(float /*r*/, float /*g*/, float /*b*/, float /*a*/=1.0f) { }
+static inline void    vdbTexel(float /*u*/, float /*v*/) { }
+
+static inline void    vdbVertex(vdbVec2 /*xy*/, float /*z*/=0.0f, float /*w*/=1.0f) { }
+static inline void    vdbVertex(vdbVec3 /*xyz*/, float /*w*/=1.0f) { }
+static inline void    vdbVertex(vdbVec4 /*xyzw*/) { }
+static inline void    vdbColor(vdbVec3 /*rgb*/, float /*alpha*/=1.0f) { }
+static inline void    vdbColor(vdbVec4 /*rgba*/) { }
+
+// § Draw list:
+static inline void    vdbBeginList(int /*list*/) { }
+static inline void    vdbDrawList(int /*list*/) { }
+
+// § Utility drawing functions
+static inline void    vdbCircleSegments(int /*segments*/) { }
+static inline void    vdbNoteV(float /*x*/, float /*y*/, const char * /*fmt*/, va_list /*args*/) { }
+static inline void    vdbNote(float /*x*/, float /*y*/, const char * /*fmt*/, ...) { }
+static inline void    vdbNoteAlign(float /*x*/, float /*y*/) { }
+static inline void    vdbLineCube_(float /*size_x*/, float /*size_y*/, float /*size_z*/) { }
+static inline void    vdbLineCube (float /*size_x*/, float /*size_y*/, float /*size_z*/) { }
+static inline void    vdbLineCube_(vdbVec3 /*p_min*/, vdbVec3 /*p_max*/) { }
+static inline void    vdbLineCube (vdbVec3 /*p_min*/, vdbVec3 /*p_max*/) { }
+static inline void    vdbLineRect_(float /*x*/, float /*y*/, float /*size_x*/, float /*size_y*/) { }
+static inline void    vdbLineRect (float /*x*/, float /*y*/, float /*size_x*/, float /*size_y*/) { }
+static inline void    vdbLineCircle_(float /*x*/, float /*y*/, float /*radius*/) { }
+static inline void    vdbLineCircle (float /*x*/, float /*y*/, float /*radius*/) { }
+static inline void    vdbFillArc_(vdbVec3 /*base*/, vdbVec3 /*p1*/, vdbVec3 /*p2*/) { }
+static inline void    vdbFillArc (vdbVec3 /*base*/, vdbVec3 /*p1*/, vdbVec3 /*p2*/) { }
+static inline void    vdbFillRect_(float /*x*/, float /*y*/, float /*size_x*/, float /*size_y*/) { }
+static inline void    vdbFillRect (float /*x*/, float /*y*/, float /*size_x*/, float /*size_y*/) { }
+static inline void    vdbFillCircle_(float /*x*/, float /*y*/, float /*radius*/) { }
+static inline void    vdbFillCircle (float /*x*/, float /*y*/, float /*radius*/) { }
+static inline void    vdbFillTexturedRect_(float /*x*/, float /*y*/, float /*w*/, float /*h*/) { }
+static inline void    vdbFillTexturedRect (float /*x*/, float /*y*/, float /*w*/, float /*h*/) { }
+
+// § Colormaps
+static inline vdbVec3 vdbGetForegroundColor() { return vdbVec3(); }
+static inline vdbVec3 vdbGetBackgroundColor() { return vdbVec3(); }
+static inline int     vdbSetColormap(const char * /*name*/) { return 0; }
+static inline vdbVec4 vdbNextColor() { return vdbVec4(); }
+static inline vdbVec4 vdbResetColor(int /*offset*/=0) { return vdbVec4(); }
+static inline vdbVec4 vdbGetColor(float /*t*/, float /*alpha*/=1.0f) { return vdbVec4(); }
+static inline vdbVec4 vdbGetColor(int /*i*/, float /*alpha*/=1.0f) { return vdbVec4(); }
+static inline void    vdbColor(float /*t*/, float /*alpha*/=1.0f) { }
+static inline void    vdbColor(int /*i*/, float /*alpha*/=1.0f) { }
+static inline void    vdbColorForeground(float /*alpha*/=1.0f) { }
+static inline void    vdbColorBackground(float /*alpha*/=1.0f) { }
+
+// § Built-in matrix stacks
+static inline void    vdbPushMatrix() { }
+static inline void    vdbPopMatrix() { }
+static inline void    vdbLoadMatrix(float * /*m*/) { }
+static inline void    vdbMultMatrix(float * /*m*/) { }
+static inline void    vdbGetMatrix(float * /*m*/) { }
+static inline void    vdbTranslate(float /*x*/, float /*y*/, float /*z*/) { }
+static inline void    vdbRotateXYZ(float /*x*/, float /*y*/, float /*z*/) { }
+static inline void    vdbRotateZYX(float /*z*/, float /*y*/, float /*x*/) { }
+
+static inline void    vdbPushProjection() { }
+static inline void    vdbPopProjection() { }
+static inline void    vdbLoadProjection(float * /*m*/) { }
+static inline void    vdbMultProjection(float * /*m*/) { }
+static inline void    vdbGetProjection(float * /*m*/) { }
+static inline void    vdbOrtho(float /*x_left*/, float /*x_right*/, float /*y_bottom*/, float /*y_top*/, float /*z_near*/=-1.0f, float /*z_far*/=+1.0f) { }
+static inline void    vdbPerspective(float /*yfov*/, float /*z_near*/, float /*z_far*/, float /*x_offset*/=0.0f, float /*y_offset*/=0.0f) { }
+
+static inline void    vdbGetPVM(float * /*m*/) { }
+static inline void    vdbViewporti(int /*left*/, int /*bottom*/, int /*width*/, int /*height*/) { }
+static inline void    vdbViewport(float /*left*/, float /*bottom*/, float /*width*/, float /*height*/) { }
+
+// § Window information
+static inline float   vdbGetAspectRatio() { return 0.0f; }
+static inline int     vdbGetFramebufferWidth() { return 0; }
+static inline int     vdbGetFramebufferHeight() { return 0; }
+static inline int     vdbGetWindowWidth() { return 0; }
+static inline int     vdbGetWindowHeight() { return 0; }
+
+// § Coordinate system conversions
+static inline vdbVec2 vdbModelToNDC   (float /*x*/, float /*y*/, float /*z*/=0.0f, float /*w*/=1.0f) { return vdbVec2(); }
+static inline vdbVec3 vdbNDCToModel   (float /*x*/, float /*y*/, float /*z*/=-1.0f) { return vdbVec3(); }
+static inline vdbVec2 vdbWindowToNDC  (float /*x*/, float /*y*/) { return vdbVec2(); }
+static inline vdbVec2 vdbNDCToWindow  (float /*x*/, float /*y*/) { return vdbVec2(); }
+static inline vdbVec2 vdbModelToWindow(float /*x*/, float /*y*/, float /*z*/=0.0f, float /*w*/=1.0f) { return vdbVec2(); }
+
+// § Mouse & Keyboard
+static inline bool    vdbWasKeyPressed(vdbKey /*key*/) { return false; }
+static inline bool    vdbWasKeyReleased(vdbKey /*key*/) { return false; }
+static inline bool    vdbIsKeyDown(vdbKey /*key*/) { return false; }
+static inline bool    vdbWasMouseOver(float /*x*/, float /*y*/, float /*z*/=0.0f, float /*w*/=1.0f) { return false; }
+static inline int     vdbGetMouseOverIndex(float * /*x*/=0, float * /*y*/=0, float * /*z*/=0) { return 0; }
+static inline vdbVec2 vdbGetMousePos() { return vdbVec2(); }
+static inline vdbVec2 vdbGetMousePosNDC() { return vdbVec2(); }
+static inline vdbVec3 vdbGetMousePosModel(float /*depth*/=-1.0f) { return vdbVec3(); }
+static inline float   vdbGetMouseWheel() { return 0.0f; }
+static inline bool    vdbWasMouseLeftPressed() { return false; }
+static inline bool    vdbWasMouseRightPressed() { return false; }
+static inline bool    vdbWasMouseMiddlePressed() { return false; }
+static inline bool    vdbWasMouseLeftReleased() { return false; }
+static inline bool    vdbWasMouseRightReleased() { return false; }
+static inline bool    vdbWasMouseMiddleReleased() { return false; }
+static inline bool    vdbIsMouseLeftDown() { return false; }
+static inline bool    vdbIsMouseRightDown() { return false; }
+static inline bool    vdbIsMouseMiddleDown() { return false; }
+static inline bool    vdbIsCameraMoving() { return false; }
+
+// § Images
+static inline void    vdbLoadImageUint8  (int /*slot*/, const void * /*data*/, int /*width*/, int /*height*/, int /*channels*/) { }
+static inline void    vdbLoadImageFloat32(int /*slot*/, const void * /*data*/, int /*width*/, int /*height*/, int /*channels*/) { }
+static inline void    vdbLoadVolumeFloat32(int /*slot*/, const void * /*data*/, int /*width*/, int /*height*/, int /*depth*/, int /*channels*/) { }
+static inline void    vdbDrawImage(int /*slot*/, float /*x*/, float /*y*/, float /*w*/, float /*h*/, vdbTextureFilter /*filter*/=VDB_LINEAR, vdbTextureWrap /*wrap*/=VDB_CLAMP, vdbVec4 /*v_min*/=vdbVec4(0,0,0,0), vdbVec4 /*v_max*/=vdbVec4(1,1,1,1)) { }
+
+// § Shaders
+static inline bool    vdbLoadShader(int /*slot*/, const char * /*fragment_shader_source_string*/) { return false; }
+static inline void    vdbBeginShader(int /*slot*/) { }
+static inline void    vdbUniform1f(const char * /*name*/, float /*x*/) { }
+static inline void    vdbUniform2f(const char * /*name*/, float /*x*/, float /*y*/) { }
+static inline void    vdbUniform3f(const char * /*name*/, float /*x*/, float /*y*/, float /*z*/) { }
+static inline void    vdbUniform4f(const char * /*name*/, float /*x*/, float /*y*/, float /*z*/, float /*w*/) { }
+static inline void    vdbUniform1i(const char * /*name*/, int /*x*/) { }
+static inline void    vdbUniform2i(const char * /*name*/, int /*x*/, int /*y*/) { }
+static inline void    vdbUniform3i(const char * /*name*/, int /*x*/, int /*y*/, int /*z*/) { }
+static inline void    vdbUniform4i(const char * /*name*/, int /*x*/, int /*y*/, int /*z*/, int /*w*/) { }
+static inline void    vdbUniformMatrix4fv(const char * /*name*/, float * /*x*/) { }
+static inline void    vdbUniformMatrix3fv(const char * /*name*/, float * /*x*/) { }
+static inline void    vdbEndShader() { }
+
+// § Render targets
+static inline void    vdbBeginRenderTarget(int /*slot*/, vdbRenderTargetDesc /*desc*/) { }
+static inline void    vdbEndRenderTarget() { }
+static inline void    vdbDrawRenderTarget(int /*slot*/, vdbTextureFilter /*filter*/=VDB_LINEAR, vdbTextureWrap /*wrap*/=VDB_CLAMP) { }
+static inline void    vdbDrawRenderTargetWithDepth(int /*slot*/, vdbTextureFilter /*filter*/=VDB_LINEAR, vdbTextureWrap /*wrap*/=VDB_CLAMP) { }
+
+// § Texture bindings
+static inline void    vdbActiveTextureUnit(int /*unit*/) { }
+static inline void    vdbBindImage(int /*slot*/, vdbTextureFilter /*filter*/=VDB_LINEAR, vdbTextureWrap /*wrap*/=VDB_CLAMP) { }
+static inline void    vdbBindRenderTarget(int /*slot*/, vdbTextureFilter /*filter*/=VDB_LINEAR, vdbTextureWrap /*wrap*/=VDB_CLAMP) { }
+static inline void    vdbBindRenderTargetDepth(int /*slot*/, vdbTextureFilter /*filter*/=VDB_LINEAR, vdbTextureWrap /*wrap*/=VDB_CLAMP) { }
+static inline void    vdbUnbindTexture() { }
+
+// § Widgets
+static inline float   vdbSliderFloat(const char * /*name*/, float /*vmin*/, float /*vmax*/, float /*v_init*/, const char * /*format*/="%.3f") { return 0.0f; }
+static inline int     vdbSliderInt  (const char * /*name*/, int /*vmin*/, int /*vmax*/, int /*v_init*/) { return 0; }
+static inline bool    vdbCheckbox   (const char * /*name*/, bool /*init*/) { return false; }
+static inline bool    vdbButton     (const char * /*name*/) { return false; }
+static inline bool    vdbWereItemsEdited() { return false; }
+static inline bool    vdbWereItemsDeactivated() { return false; }
+
+// § Render scaler
+static inline void    vdbBeginRenderScale(int /*down*/, int /*up*/) { }
+static inline void    vdbBeginRenderScale(int /*width*/, int /*height*/, int /*up*/) { }
+static inline void    vdbEndRenderScale() { }
+static inline vdbVec2 vdbGetRenderScale() { return vdbVec2(); }
+static inline vdbVec2 vdbGetRenderOffset() { return vdbVec2(); }
+static inline vdbVec2 vdbGetRenderOffsetFramebuffer() { return vdbVec2(); }
+
+// § Low-level functionality
+static inline void    vdbMakeContextCurrent() { }
+static inline void    vdbDetachContext() { }
+static inline bool    vdbHasGLDebugOutput() { return false; }
+static inline void    vdbStepOnce() { }
+static inline void    vdbStepOver() { }
+static inline bool    vdbBeginBreak(const char * /*label*/) { return false; }
+static inline void    vdbEndBreak() { }
+static inline bool    vdbIsFirstFrame() { return false; }
+static inline bool    vdbIsDifferentLabel() { return false; }
+static inline float   vdbGetFrameDelta() { return 0.0f; }
+static inline void    vdbAutoStep(bool /*enabled*/) { }
+static inline void    vdbLiveView(bool /*enabled*/) { }
+static inline void    vdbWatch() { }
+static inline void    vdbSaveScreenshot(const char * /*filename*/) { }
+static inline void    vdbSaveScreenshotTiled(const char * /*filename*/, int /*width*/, int /*height*/) { }
+
+// § Logging
+static inline void    vdbLogPush(const char * /*label*/) { }
+static inline void    vdbLogPush() { }
+static inline void    vdbLogPop() { }
+static inline void    vdbLogScalar(const char * /*label*/, float /*x*/, int /*history*/=0) { }
+static inline void    vdbLogMatrix(const char * /*label*/, float * /*x*/, int /*rows*/, int /*columns*/, int /*history*/=0) { }
+static inline void    vdbLogVector(const char * /*label*/, float * /*x*/, int /*elements*/, int /*history*/=0) { }
+static inline void    vdbLogArray(const char * /*label*/, const void * /*x*/, vdbDataType /*type*/, int /*rows*/, int /*columns*/=1, int /*history*/=0) { }
+static inline void    vdbLogView(const char * /*label*/, const void * /*x*/, size_t /*bytes*/, vdbDataType /*type*/, int /*rows*/, int /*columns*/=1, int /*history*/=0) { }
+static inline void    vdbLogDump(const char * /*filename*/) { }
+static inline bool    vdbLogSave(const char * /*filename*/) { return false; }
+static inline bool    vdbLogLoad(const char * /*filename*/, const char * /*label*/) { return false; }
+static inline void    vdbLogSpill(const char * /*filename*/, int /*window*/=0) { }
+static inline void    vdbLogShow(const char * /*id*/, const char * /*query*/) { }
+
+// § Trace files
+static inline void    vdbTraceRecord(const char * /*filename*/) { }
+static inline bool    vdbTraceLoad(const char * /*filename*/) { return false; }
+static inline bool    vdbRemote(const char * /*name*/) { return false; }
+static inline bool    vdbRemoteView(const char * /*name*/) { return false; }
+
+// § Row-major versions of matrix functions:
+static inline void    vdbLoadProjection_RowMaj(float * /*m*/) { }
+static inline void    vdbLoadMatrix_RowMaj(float * /*m*/) { }
+static inline void    vdbMultMatrix_RowMaj(float * /*m*/) { }
+static inline void    vdbGetMatrix_RowMaj(float * /*m*/) { }
+static inline void    vdbGetProjection_RowMaj(float * /*m*/) { }
+static inline void    vdbGetPVM_RowMaj(float * /*m*/) { }
+static inline void    vdbUniformMatrix4fv_RowMaj(const char * /*name*/, float * /*x*/) { }
+static inline void    vdbUniformMatrix3fv_RowMaj(const char * /*name*/, float * /*x*/) { }
+static inline void    vdbLogMatrix_RowMaj(const char * /*label*/, float * /*x*/, int /*rows*/, int /*columns*/) { }
+
+
+// § Keys
+static const vdbKey VDB_KEY_A = 0;
+static const vdbKey VDB_KEY_B = 0;
+static const vdbKey VDB_KEY_C = 0;
+static const vdbKey VDB_KEY_D = 0;
+static const vdbKey VDB_KEY_E = 0;
+static const vdbKey VDB_KEY_F = 0;
+static const vdbKey VDB_KEY_G = 0;
+static const vdbKey VDB_KEY_H = 0;
+static const vdbKey VDB_KEY_I = 0;
+static const vdbKey VDB_KEY_J = 0;
+static const vdbKey VDB_KEY_K = 0;
+static const vdbKey VDB_KEY_L = 0;
+static const vdbKey VDB_KEY_M = 0;
+static const vdbKey VDB_KEY_N = 0;
+static const vdbKey VDB_KEY_O = 0;
+static const vdbKey VDB_KEY_P = 0;
+static const vdbKey VDB_KEY_Q = 0;
+static const vdbKey VDB_KEY_R = 0;
+static const vdbKey VDB_KEY_S = 0;
+static const vdbKey VDB_KEY_T = 0;
+static const vdbKey VDB_KEY_U = 0;
+static const vdbKey VDB_KEY_V = 0;
+static const vdbKey VDB_KEY_W = 0;
+static const vdbKey VDB_KEY_X = 0;
+static const vdbKey VDB_KEY_Y = 0;
+static const vdbKey VDB_KEY_Z = 0;
+static const vdbKey VDB_KEY_1 = 0;
+static const vdbKey VDB_KEY_2 = 0;
+static const vdbKey VDB_KEY_3 = 0;
+static const vdbKey VDB_KEY_4 = 0;
+static const vdbKey VDB_KEY_5 = 0;
+static const vdbKey VDB_KEY_6 = 0;
+static const vdbKey VDB_KEY_7 = 0;
+static const vdbKey VDB_KEY_8 = 0;
+static const vdbKey VDB_KEY_9 = 0;
+static const vdbKey VDB_KEY_0 = 0;
+static const vdbKey VDB_KEY_RETURN = 0;
+static const vdbKey VDB_KEY_ESCAPE = 0;
+static const vdbKey VDB_KEY_BACKSPACE = 0;
+static const vdbKey VDB_KEY_TAB = 0;
+static const vdbKey VDB_KEY_SPACE = 0;
+static const vdbKey VDB_KEY_F1 = 0;
+static const vdbKey VDB_KEY_F2 = 0;
+static const vdbKey VDB_KEY_F3 = 0;
+static const vdbKey VDB_KEY_F4 = 0;
+static const vdbKey VDB_KEY_F5 = 0;
+static const vdbKey VDB_KEY_F6 = 0;
+static const vdbKey VDB_KEY_F7 = 0;
+static const vdbKey VDB_KEY_F8 = 0;
+static const vdbKey VDB_KEY_F9 = 0;
+static const vdbKey VDB_KEY_F10 = 0;
+static const vdbKey VDB_KEY_F11 = 0;
+static const vdbKey VDB_KEY_F12 = 0;
+static const vdbKey VDB_KEY_HOME = 0;
+static const vdbKey VDB_KEY_PAGEUP = 0;
+static const vdbKey VDB_KEY_DELETE = 0;
+static const vdbKey VDB_KEY_END = 0;
+static const vdbKey VDB_KEY_PAGEDOWN = 0;
+static const vdbKey VDB_KEY_RIGHT = 0;
+static const vdbKey VDB_KEY_LEFT = 0;
+static const vdbKey VDB_KEY_DOWN = 0;
+static const vdbKey VDB_KEY_UP = 0;
+static const vdbKey VDB_KEY_LCTRL = 0;
+static const vdbKey VDB_KEY_LSHIFT = 0;
+static const vdbKey VDB_KEY_LALT = 0;
+static const vdbKey VDB_KEY_LGUI = 0;
+static const vdbKey VDB_KEY_RCTRL = 0;
+static const vdbKey VDB_KEY_RSHIFT = 0;
+static const vdbKey VDB_KEY_RALT = 0;
+static const vdbKey VDB_KEY_RGUI = 0;
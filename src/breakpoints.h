@@ -0,0 +1,70 @@
+// Breakpoint policies decide whether a hit of vdbBeginBreak stops the program:
+// always (the default), never, every Nth hit, after the first N hits, or when
+// the newest sample of a scalar log crosses a threshold. They're edited in the
+// Break menu and saved with the label's frame settings in vdb.ini.
+//
+// A policy is checked before any SDL, OpenGL or ImGui work, so a hit that
+// doesn't break costs a cache lookup of its label and a few comparisons, and
+// the breaks can be left in hot loops.
+namespace breakpoints
+{
+    // Finds a log by its path, e.g. /iter/loss (anonymous groups can't be named)
+    static log_t *FindLog(const char *path)
+    {
+        log_t *l = &logs.root;
+        const char *c = path;
+        while (*c == '/') c++;
+        while (*c && l)
+        {
+            const char *end = c;
+            while (*end && *end != '/') end++;
+            size_t n = end - c;
+            l = logs.FindChild(l, c, n, intern::Hash(c, n), log_type_any);
+            c = end;
+            while (*c == '/') c++;
+        }
+        return l != &logs.root ? l : NULL;
+    }
+
+    static bool Crossed(break_settings_t &b)
+    {
+        if (!b.is_resolved || b.resolved_tree_version != logs.tree_version)
+        {
+            b.resolved = FindLog(b.log);
+            b.is_resolved = true;
+            b.resolved_tree_version = logs.tree_version;
+        }
+        log_t *l = b.resolved;
+        if (!l || l->type != log_type_scalar || l->NumSamples() == 0)
+            return false;
+        bool above = *l->Sample(l->NumSamples() - 1) > b.threshold;
+        bool crossed = b.has_value && above != b.was_above &&
+                       (b.direction == 0 || above == (b.direction > 0));
+        b.was_above = above;
+        b.has_value = true;
+        return crossed;
+    }
+
+    // Called at each hit (not each frame of a break). Returns true if the hit
+    // shouldn't break.
+    static bool Skip(frame_settings_t *fs)
+    {
+        break_settings_t &b = fs->breaks;
+        b.hits++;
+        switch (b.mode)
+        {
+            case break_never:    return true;
+            case break_every:    return b.count > 1 && b.hits % (uint64_t)b.count != 0;
+            case break_after:    return b.count > 0 && b.hits <= (uint64_t)b.count;
+            case break_crossing: return !Crossed(b);
+            default:             return false;
+        }
+    }
+
+    // The log path was edited
+    static void Unresolve(break_settings_t &b)
+    {
+        b.is_resolved = false;
+        b.has_value = false;
+    }
+}
@@ -8,7 +8,7 @@ bool vdbIsCameraMoving()
 void vdbCamera2D()
 {
     is_camera_moving = false;
-    const float dt = 1.0f/60.0f;
+    const float dt = frame_clock::delta;
 
     GetFrameSettings()->camera.planar.dirty = true;
     float scroll_sensitivity = settings.camera.scroll_sensitivity;
@@ -106,7 +106,7 @@ void vdbCamera2D()
 void vdbCameraTrackball()
 {
     is_camera_moving = false;
-    const float dt = 1.0f/60.0f; // todo: expose API vdbGetFrameDelta()
+    const float dt = frame_clock::delta;
 
     auto &cs = settings.camera;
     GetFrameSettings()->camera.trackball.dirty = true;
@@ -226,7 +226,7 @@ void vdbCameraTurntable()
     float &radius = GetFrameSettings()->camera.turntable.radius;
     bool can_move = GetFrameSettings()->camera.key == VDB_KEY_INVALID ||
                     vdbIsKeyDown(GetFrameSettings()->camera.key);
-    const float dt = 1.0f/60.0f;
+    const float dt = frame_clock::delta;
 
     // zooming
     if (vdbGetMouseWheel() != 0.0f)
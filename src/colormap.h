@@ -2,8 +2,8 @@
 
 namespace colormap
 {
-    static int current_colormap = 0;
-    static int current_color = 0;
+    static thread_local int current_colormap = 0; // per thread, like transform
+    static thread_local int current_color = 0;
 
     static vdbColormapData *GetColormapData()
     {
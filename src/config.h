@@ -46,6 +46,71 @@
 // where the information is stored.
 #define VDB_IMGUI_INI_FILENAME "./imgui.ini"
 
+// Maximum width and height of the tiles rendered by vdbSaveScreenshotTiled.
+// The tile size is further limited by the driver's maximum renderbuffer size.
+#define VDB_SCREENSHOT_TILE_SIZE 2048
+
+// Lower bound and granularity of the render scale chosen by the dynamic
+// resolution controller (enabled per block with 'Frame budget' in the View menu).
+#define VDB_DYNAMIC_RESOLUTION_MIN  0.25f
+#define VDB_DYNAMIC_RESOLUTION_STEP 0.05f
+
+// Number of entries (power of two) in the cache that maps the pointer of a
+// log label (e.g. a string literal) to its log, skipping the hash lookup.
+#define VDB_LOG_LOOKUP_CACHE_SIZE 4096
+
+// Number of entries (power of two) in the cache that maps the pointer of a
+// breakpoint label to its settings, so that a hit doesn't hash its label.
+#define VDB_LABEL_CACHE_SIZE 256
+
+// Size in bytes of the blocks that log calls from threads other than the one
+// calling vdbBeginBreak are queued in (a thread allocates more when it fills one).
+#define VDB_LOG_STREAM_BLOCK_SIZE (256*1024)
+
+// With vdbLogSpill, logs without a history limit keep at most about this many
+// values (floats) in memory, unless vdbLogSpill is given a window; older values are moved to the spill file in
+// chunks of VDB_LOG_SPILL_CHUNK values. Logging blocks if more than
+// VDB_LOG_SPILL_QUEUE_LIMIT bytes are waiting to be written.
+#define VDB_LOG_SPILL_WINDOW      (4*1024*1024)
+#define VDB_LOG_SPILL_CHUNK       (256*1024)
+#define VDB_LOG_SPILL_QUEUE_LIMIT (64*1024*1024)
+
+// Scalar logs keep a min/max pyramid for plotting (those with a history limit
+// only once they are plotted), where each level merges VDB_LOG_PYRAMID_FACTOR buckets of the level below.
+// The coarsest bucket (FACTOR^LEVELS samples) must fit in an int.
+#define VDB_LOG_PYRAMID_FACTOR 8
+#define VDB_LOG_PYRAMID_LEVELS 8
+
+// Smoothing factor of the exponential moving average in log queries (@ema)
+#define VDB_LOG_EMA_ALPHA 0.05f
+
+// Memory in bytes for the drawing of past breakpoint hits (Tools > History).
+// The oldest hits are dropped beyond this. Set to 0 to disable recording.
+#define VDB_HISTORY_BUDGET (256*1024*1024)
+
+// The most hits per second that are shown in the live view (vdbLiveView).
+// Hits in between return from vdbBeginBreak at once.
+#define VDB_LIVE_VIEW_FPS 60
+
+// Size in bytes of the shared memory ring between a vdbRemote client and its
+// viewer. A hit (with the images loaded since the last one sent) that doesn't
+// fit is dropped.
+#define VDB_REMOTE_BUFFER_SIZE (64*1024*1024)
+
+// A vdbRemote client takes its viewer as gone (e.g. it crashed) if it hasn't
+// read from the ring in this many milliseconds while there was something to read.
+#define VDB_REMOTE_TIMEOUT 3000
+
+// Frame times kept for the plot in the View menu, and the longest frame time
+// (in seconds) that vdbGetFrameDelta returns, so that e.g. the camera doesn't
+// jump after the program was slow for a frame.
+#define VDB_FRAME_TIME_HISTORY 120
+#define VDB_MAX_FRAME_DELTA 0.1f
+
+// If 1, a frame that would look the same as the one on the screen is not
+// rendered and swapped (see damage.h). Set to 0 to present every frame.
+#define VDB_SKIP_UNCHANGED_FRAMES 1
+
 #define VDB_HOTKEY_FRAMEGRAB   (keys::pressed[VDB_KEY_S] && keys::down[VDB_KEY_LALT])
 #define VDB_HOTKEY_WINDOW_SIZE (keys::pressed[VDB_KEY_W] && keys::down[VDB_KEY_LALT])
 #define VDB_HOTKEY_SKETCH_MODE (keys::pressed[VDB_KEY_D] && keys::down[VDB_KEY_LALT])
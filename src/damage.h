@@ -0,0 +1,69 @@
+// Damage tracking. While a break is paused the block runs every frame, but
+// most frames look the same as the one before (e.g. the mouse moved over an
+// empty part of the window). Everything that goes to the screen is hashed as
+// it is drawn: immediate-mode geometry (with its state and transform), images,
+// and the UI's draw lists. If the hash of a frame equals that of the frame on
+// the screen, vdbEndBreak skips rendering the UI and swapping buffers, and the
+// last presented frame stays up.
+//
+// Drawing that isn't hashed (custom shaders, render targets, render scaling,
+// screenshots and video capture) and window events mark the frame damaged
+// with Touch, so it is always presented.
+namespace history { static uint64_t Hash(const void *data, size_t size); } // see history.h
+
+namespace damage
+{
+    static uint64_t hash; // of what was drawn in the current frame
+    static uint64_t presented_hash; // of the frame on the screen
+    static bool touched; // something changed that isn't hashed
+    static bool has_presented;
+
+    static void Touch() { touched = true; }
+
+    static void Add(const void *data, size_t size)
+    {
+        hash = (hash ^ history::Hash(data, size))*0x100000001b3ull;
+    }
+
+    template <typename T>
+    static void Add(const T &value) { Add(&value, sizeof(T)); }
+
+    static void BeginFrame()
+    {
+        hash = 0;
+    }
+
+    static void AddDrawData(ImDrawData *draw_data)
+    {
+        Add(draw_data->DisplaySize);
+        Add(draw_data->FramebufferScale);
+        for (int i = 0; i < draw_data->CmdListsCount; i++)
+        {
+            ImDrawList *list = draw_data->CmdLists[i];
+            Add(list->VtxBuffer.Data, list->VtxBuffer.Size*sizeof(ImDrawVert));
+            Add(list->IdxBuffer.Data, list->IdxBuffer.Size*sizeof(ImDrawIdx));
+            for (int j = 0; j < list->CmdBuffer.Size; j++)
+            {
+                ImDrawCmd *cmd = &list->CmdBuffer[j];
+                Add(cmd->ClipRect);
+                Add(cmd->TextureId);
+                Add(cmd->ElemCount);
+            }
+        }
+    }
+
+    // Returns whether the frame must be presented (rendered and swapped)
+    static bool EndFrame(int framebuffer_width, int framebuffer_height)
+    {
+        Add(framebuffer_width);
+        Add(framebuffer_height);
+        bool present = !VDB_SKIP_UNCHANGED_FRAMES || touched || !has_presented || hash != presented_hash;
+        touched = false;
+        if (present)
+        {
+            presented_hash = hash;
+            has_presented = true;
+        }
+        return present;
+    }
+}
@@ -0,0 +1,163 @@
+// Dynamic resolution picks a render scale each frame such that the frame
+// time stays within a user-specified budget (Settings are per block, see
+// render_scaler_settings_t::budget_ms). The frame time is measured on the
+// GPU with GL_TIME_ELAPSED queries (ARB_timer_query) when the driver has
+// them, and otherwise from the CPU as the time from the start of the frame
+// until SwapBuffers returns. Query results are read back a few frames late
+// to avoid stalling the pipeline. Queries are only issued while a budget is
+// set, so frames without one don't pay for them.
+//
+// The cost of a frame is assumed to be proportional to the number of pixels
+// (i.e. to scale^2), so the controller moves the scale toward
+//     applied_scale*sqrt(budget/measured)
+// The scale is continuous (it is not limited to the 1/(1<<n) factors in the
+// Render scale menu), but is quantized to VDB_DYNAMIC_RESOLUTION_STEP with
+// some hysteresis, so the render scaler doesn't reallocate its framebuffers
+// every frame.
+#ifndef GL_TIME_ELAPSED
+#define GL_TIME_ELAPSED 0x88BF
+#endif
+typedef void (APIENTRYP GLGETQUERYOBJECTUI64VPROC)(GLuint, GLenum, GLuint64*);
+static GLGETQUERYOBJECTUI64VPROC vdb_glGetQueryObjectui64v;
+
+namespace dynamic_resolution
+{
+    enum { num_queries = 4 };
+    static bool initialized;
+    static bool has_timer_query;
+    static GLuint queries[num_queries];
+    static bool query_pending[num_queries];
+    static int query_index;
+    static bool query_active; // a query was begun this frame
+    static Uint64 frame_begin;
+    static float gpu_ms; // smoothed; zero if not available
+    static float cpu_ms; // smoothed
+    static bool has_new_measurement;
+    static float scale = 1.0f; // continuous controller state
+    static float applied_scale = 1.0f; // quantized scale that is actually rendered with
+
+    static void Initialize()
+    {
+        initialized = true;
+        bool supported = SDL_GL_ExtensionSupported("GL_ARB_timer_query") ||
+                         GLVersion.major > 3 || (GLVersion.major == 3 && GLVersion.minor >= 3);
+        if (supported)
+        {
+            vdb_glGetQueryObjectui64v = (GLGETQUERYOBJECTUI64VPROC)SDL_GL_GetProcAddress("glGetQueryObjectui64v");
+            if (vdb_glGetQueryObjectui64v)
+            {
+                glGenQueries(num_queries, queries);
+                has_timer_query = true;
+            }
+        }
+    }
+
+    static void Smooth(float *ms, float sample)
+    {
+        if (*ms == 0.0f) *ms = sample;
+        else             *ms += 0.2f*(sample - *ms);
+    }
+
+    // Called after events are processed (time spent idling is not counted)
+    static void BeginFrame(float budget_ms)
+    {
+        if (!initialized)
+            Initialize();
+        frame_begin = SDL_GetPerformanceCounter();
+        query_active = has_timer_query && budget_ms > 0.0f;
+        if (query_active)
+        {
+            assert(!query_pending[query_index]);
+            glBeginQuery(GL_TIME_ELAPSED, queries[query_index]);
+        }
+        else
+        {
+            // drop results from before the budget was cleared; they were measured at another scale
+            for (int i = 0; i < num_queries; i++)
+                query_pending[i] = false;
+            gpu_ms = 0.0f;
+        }
+    }
+
+    // Called right before SwapBuffers
+    static void EndFrame()
+    {
+        if (!query_active)
+            return;
+        query_active = false;
+
+        glEndQuery(GL_TIME_ELAPSED);
+        query_pending[query_index] = true;
+        query_index = (query_index + 1) % num_queries;
+
+        // read back finished queries without waiting, oldest first
+        for (int i = 0; i < num_queries; i++)
+        {
+            int j = (query_index + i) % num_queries;
+            if (!query_pending[j])
+                continue;
+            GLint available = 0;
+            glGetQueryObjectiv(queries[j], GL_QUERY_RESULT_AVAILABLE, &available);
+            if (!available)
+                break;
+            GLuint64 ns = 0;
+            vdb_glGetQueryObjectui64v(queries[j], GL_QUERY_RESULT, &ns);
+            query_pending[j] = false;
+            Smooth(&gpu_ms, (float)(ns/1.0e6));
+            has_new_measurement = true;
+        }
+
+        // the next BeginFrame reuses queries[query_index], so make sure it's done
+        if (query_pending[query_index])
+        {
+            GLuint64 ns = 0;
+            vdb_glGetQueryObjectui64v(queries[query_index], GL_QUERY_RESULT, &ns);
+            query_pending[query_index] = false;
+            Smooth(&gpu_ms, (float)(ns/1.0e6));
+            has_new_measurement = true;
+        }
+    }
+
+    // Called right after SwapBuffers
+    static void AfterSwap()
+    {
+        Uint64 ticks = SDL_GetPerformanceCounter() - frame_begin;
+        Smooth(&cpu_ms, (float)(1000.0*ticks/SDL_GetPerformanceFrequency()));
+        if (!has_timer_query)
+            has_new_measurement = true;
+    }
+
+    // Returns the render scale to use this frame (1 means full resolution)
+    static float Update(float budget_ms)
+    {
+        if (budget_ms <= 0.0f)
+        {
+            scale = 1.0f;
+            applied_scale = 1.0f;
+            return applied_scale;
+        }
+
+        if (has_new_measurement)
+        {
+            has_new_measurement = false;
+            float measured = has_timer_query ? gpu_ms : cpu_ms;
+            if (measured > 0.0f)
+            {
+                float target = applied_scale*sqrtf(budget_ms/measured); // measured at applied_scale
+                scale += 0.3f*(target - scale);
+                if (scale < VDB_DYNAMIC_RESOLUTION_MIN) scale = VDB_DYNAMIC_RESOLUTION_MIN;
+                if (scale > 1.0f) scale = 1.0f;
+            }
+        }
+
+        const float step = VDB_DYNAMIC_RESOLUTION_STEP;
+        if (fabsf(scale - applied_scale) > 0.75f*step)
+        {
+            applied_scale = step*floorf(scale/step + 0.5f);
+            if (applied_scale > 1.0f) applied_scale = 1.0f;
+            if (applied_scale < step) applied_scale = step;
+        }
+
+        return applied_scale;
+    }
+}
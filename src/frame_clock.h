@@ -0,0 +1,42 @@
+// Frame clock. Measures the time between the frames shown by a break (see
+// vdbGetFrameDelta), which the camera controls move by, and keeps the last
+// VDB_FRAME_TIME_HISTORY frame times for the View menu. When nothing waits
+// for the display (vsync is off, or the frame wasn't presented), Pace sleeps
+// until the next frame is due at the target frame rate (Settings > Frame rate).
+namespace frame_clock
+{
+    static Uint64 frame_begin; // performance counter when the current frame began
+    static float delta = 1.0f/60.0f; // seconds between the last two frames
+    static float times[VDB_FRAME_TIME_HISTORY]; // in milliseconds, oldest first starting at next
+    static int next;
+
+    // Called once per frame, after events are processed. If the loop waited
+    // for events, the time spent idling isn't a frame time (the camera would
+    // jump), so the last measurement is kept.
+    static void BeginFrame(bool waited_for_events)
+    {
+        Uint64 now = SDL_GetPerformanceCounter();
+        if (frame_begin && !waited_for_events)
+        {
+            float seconds = (float)((double)(now - frame_begin)/SDL_GetPerformanceFrequency());
+            if (seconds > VDB_MAX_FRAME_DELTA)
+                seconds = VDB_MAX_FRAME_DELTA;
+            delta = seconds;
+            times[next] = 1000.0f*seconds;
+            next = (next + 1) % VDB_FRAME_TIME_HISTORY;
+        }
+        frame_begin = now;
+    }
+
+    // Sleeps until a frame at the given rate is due (0 is unlimited)
+    static void Pace(int fps)
+    {
+        if (fps <= 0)
+            return;
+        Uint64 frequency = SDL_GetPerformanceFrequency();
+        Uint64 due = frame_begin + frequency/fps;
+        Uint64 now = SDL_GetPerformanceCounter();
+        if (now < due)
+            SDL_Delay((Uint32)(1000*(due - now)/frequency));
+    }
+}
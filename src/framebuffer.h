@@ -11,7 +11,7 @@ struct framebuffer_t
     GLenum internal_format;
 };
 
-static framebuffer_t *current_framebuffer = NULL;
+static thread_local framebuffer_t *current_framebuffer = NULL; // per thread, so a watched block never sees the viewer's (see watch.h)
 
 static void EnableFramebuffer(framebuffer_t *fb)
 {
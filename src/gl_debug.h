@@ -0,0 +1,168 @@
+// OpenGL error reporting. Errors used to be found by calling glGetError after
+// vdb's GL calls (e.g. after every vdbUniform), and each call waits for the
+// driver to catch up with the commands issued so far. Instead, errors are
+// found by polling glGetError once per frame, at the end of vdbEndBreak.
+// The poll can't tell which call failed, so the vdb functions that made GL
+// calls in the frame are remembered (see Remember), and listed with the
+// error: the one that failed is among them, but unlike the old checks after
+// each call, vdb doesn't know which one.
+//
+// Under VDB_DEBUG vdb asks for a debug context (which costs more per call on
+// some drivers, so release builds don't), and if the driver has KHR_debug or
+// ARB_debug_output, it calls Callback when an error happens. The output is
+// synchronous, so the error is printed with the vdb function that was running
+// (see GLCallSite), and the assert in Callback stops in the GL call that
+// failed. Either way vdb exits at the end of a frame that had errors.
+
+#ifndef GL_DEBUG_OUTPUT
+#define GL_DEBUG_OUTPUT 0x92E0
+#endif
+#ifndef GL_DEBUG_OUTPUT_SYNCHRONOUS
+#define GL_DEBUG_OUTPUT_SYNCHRONOUS 0x8242
+#endif
+#ifndef GL_DEBUG_TYPE_ERROR
+#define GL_DEBUG_TYPE_ERROR 0x824C
+#endif
+#ifndef GL_CONTEXT_FLAG_DEBUG_BIT
+#define GL_CONTEXT_FLAG_DEBUG_BIT 0x00000002
+#endif
+typedef void (APIENTRYP GLDEBUGCALLBACK)(GLenum, GLenum, GLuint, GLenum, GLsizei, const GLchar*, const void*);
+typedef void (APIENTRYP GLDEBUGMESSAGECALLBACKPROC)(GLDEBUGCALLBACK, const void*);
+typedef void (APIENTRYP GLDEBUGMESSAGECONTROLPROC)(GLenum, GLenum, GLenum, GLsizei, const GLuint*, GLboolean);
+
+// Marks the rest of the enclosing scope as running inside the current vdb
+// function, so errors reported by the driver can say where they came from.
+// detail (e.g. a uniform name) may be NULL.
+#define GLCallSite(detail) gl_debug::call_site_t gl_call_site(__func__, detail)
+
+namespace gl_debug
+{
+    static bool active; // errors are reported by Callback
+    static int errors; // since the last Check
+    static thread_local const char *call_site; // NULL outside vdb (the callback runs on the thread that made the call)
+    static thread_local const char *call_site_detail;
+    static GLDEBUGMESSAGECALLBACKPROC DebugMessageCallback;
+    static GLDEBUGMESSAGECONTROLPROC DebugMessageControl;
+
+    // The last call sites since the last Check, for when it finds an error
+    // (only the OpenGL thread makes GL calls, so these aren't thread_local)
+    enum { max_recent = 16 };
+    static const char *recent_site[max_recent];
+    static const char *recent_detail[max_recent];
+    static int num_recent; // since the last Check (may be more than max_recent)
+
+    // Keeps a call site, unless it repeats the last one (e.g. in a loop)
+    static void Remember(const char *site, const char *detail)
+    {
+        int last = (num_recent + max_recent - 1) % max_recent;
+        if (num_recent > 0 && recent_site[last] == site && recent_detail[last] == detail)
+            return;
+        recent_site[num_recent % max_recent] = site;
+        recent_detail[num_recent % max_recent] = detail;
+        num_recent++;
+    }
+
+    struct call_site_t
+    {
+        const char *prev_site;
+        const char *prev_detail;
+        call_site_t(const char *site, const char *detail)
+        {
+            prev_site = call_site;
+            prev_detail = call_site_detail;
+            call_site = site;
+            call_site_detail = detail;
+            if (!active)
+                Remember(site, detail);
+        }
+        ~call_site_t()
+        {
+            call_site = prev_site;
+            call_site_detail = prev_detail;
+        }
+    };
+
+    static void APIENTRY Callback(GLenum source, GLenum type, GLuint id, GLenum severity,
+                                  GLsizei length, const GLchar *message, const void *user)
+    {
+        (void)source; (void)id; (void)severity; (void)length; (void)user;
+        if (type != GL_DEBUG_TYPE_ERROR)
+            return;
+        const char *site = call_site;
+        const char *detail = call_site_detail;
+        if (!site)
+            fprintf(stderr, "OpenGL error outside of vdb: %s\n", message);
+        else if (!detail)
+            fprintf(stderr, "OpenGL error in %s: %s\n", site, message);
+        else
+            fprintf(stderr, "OpenGL error in %s('%s'): %s\n", site, detail, message);
+        errors++;
+        assert(false && "Error in OpenGL function call. Run with a debugger to see where and why it crashed.");
+    }
+
+    // Called once after the context is created. The driver only has to report
+    // errors through the callback in a debug context (see window::CreateContext),
+    // so in any other context this leaves errors to Check.
+    static void Init()
+    {
+        GLint flags = 0;
+        glGetIntegerv(GL_CONTEXT_FLAGS, &flags);
+        if (!(flags & GL_CONTEXT_FLAG_DEBUG_BIT))
+            return;
+
+        bool khr = SDL_GL_ExtensionSupported("GL_KHR_debug") == SDL_TRUE;
+        if (khr)
+        {
+            DebugMessageCallback = (GLDEBUGMESSAGECALLBACKPROC)SDL_GL_GetProcAddress("glDebugMessageCallback");
+            DebugMessageControl = (GLDEBUGMESSAGECONTROLPROC)SDL_GL_GetProcAddress("glDebugMessageControl");
+        }
+        else if (SDL_GL_ExtensionSupported("GL_ARB_debug_output"))
+        {
+            DebugMessageCallback = (GLDEBUGMESSAGECALLBACKPROC)SDL_GL_GetProcAddress("glDebugMessageCallbackARB");
+            DebugMessageControl = (GLDEBUGMESSAGECONTROLPROC)SDL_GL_GetProcAddress("glDebugMessageControlARB");
+        }
+        if (!DebugMessageCallback)
+            return;
+
+        // Only errors are of interest, so the driver needn't generate the rest
+        // (performance warnings, notifications, etc.)
+        if (DebugMessageControl)
+        {
+            DebugMessageControl(GL_DONT_CARE, GL_DONT_CARE, GL_DONT_CARE, 0, NULL, GL_FALSE);
+            DebugMessageControl(GL_DONT_CARE, GL_DEBUG_TYPE_ERROR, GL_DONT_CARE, 0, NULL, GL_TRUE);
+        }
+        DebugMessageCallback(Callback, NULL);
+        if (khr) // ARB_debug_output is always enabled in a debug context
+            glEnable(GL_DEBUG_OUTPUT);
+        glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+        active = true;
+    }
+
+    // Exits if there were errors since the last check. Without the callback
+    // this polls glGetError, so call it at most once per frame.
+    static void Check(const char *when)
+    {
+        if (!active)
+        {
+            GLenum error = glGetError();
+            if (error != GL_NO_ERROR)
+            {
+                fprintf(stderr, "OpenGL error %s: (0x%x) %s\n", when, error, GLErrorCodeString(error));
+                int first = num_recent > max_recent ? num_recent - max_recent : 0;
+                if (num_recent > 0)
+                    fprintf(stderr, "It happened in one of these vdb calls, or in a GL call of the program (oldest first%s):\n", first > 0 ? ", earlier ones left out" : "");
+                for (int i = first; i < num_recent; i++)
+                {
+                    const char *site = recent_site[i % max_recent];
+                    const char *detail = recent_detail[i % max_recent];
+                    if (detail) fprintf(stderr, "    %s('%s')\n", site, detail);
+                    else        fprintf(stderr, "    %s\n", site);
+                }
+                errors++;
+            }
+            num_recent = 0;
+        }
+        if (errors > 0)
+            exit(EXIT_FAILURE);
+    }
+}
@@ -1,12 +1,18 @@
+// Hints are applied to the frame settings when the next frame begins. A
+// watched block may give them on its own thread, so they're set and applied
+// under the lock (see watch.h).
 namespace hints
 {
+    static SDL_SpinLock lock;
     static float view_scale;           static bool view_scale_pending;
     static bool show_grid;             static bool show_grid_pending;
     static vdbCameraType camera_type;  static bool camera_type_pending;
     static vdbOrientation orientation; static bool orientation_pending;
     static vdbKey camera_key;          static bool camera_key_pending;
+    static vdbTheme theme;             static bool theme_pending;
     static void BeginFrame()
     {
+        SDL_AtomicLock(&lock);
         if (view_scale_pending)
         {
             GetFrameSettings()->grid.grid_scale = view_scale;
@@ -36,29 +42,40 @@ namespace hints
             GetFrameSettings()->camera.key = camera_key;
             camera_key_pending = false;
         }
+        if (theme_pending)
+        {
+            settings.global_theme = theme;
+            theme_pending = false;
+        }
+        SDL_AtomicUnlock(&lock);
     }
 }
 
 void vdbHint(vdbHintKey key, float value)
 {
+    SDL_AtomicLock(&hints::lock);
     if (key == VDB_VIEW_SCALE)
     {
         hints::view_scale = value;
         hints::view_scale_pending = true;
     }
+    SDL_AtomicUnlock(&hints::lock);
 }
 
 void vdbHint(vdbHintKey key, bool value)
 {
+    SDL_AtomicLock(&hints::lock);
     if (key == VDB_SHOW_GRID)
     {
         hints::show_grid = value;
         hints::show_grid_pending = true;
     }
+    SDL_AtomicUnlock(&hints::lock);
 }
 
 void vdbHint(vdbHintKey key, int value)
 {
+    SDL_AtomicLock(&hints::lock);
     if (key == VDB_CAMERA_TYPE &&
         (value == VDB_PLANAR ||
          value == VDB_TRACKBALL ||
@@ -83,6 +100,8 @@ void vdbHint(vdbHintKey key, int value)
     }
     else if (key == VDB_THEME && (value == VDB_DARK_THEME || value == VDB_BRIGHT_THEME))
     {
-        settings.global_theme = value;
+        hints::theme = value;
+        hints::theme_pending = true;
     }
+    SDL_AtomicUnlock(&hints::lock);
 }
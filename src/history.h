@@ -0,0 +1,463 @@
+// History of breakpoint hits (Tools > History). The drawing done in the last
+// frame of each hit (geometry, images and notes) is recorded as a list of
+// commands, so that earlier hits can be shown again while the program stays
+// paused, without running it again.
+//
+// Hits are only recorded while the History window is open or a recorded hit
+// is followed (watch.h, remote.h), and always without a window (trace.h).
+// Every frame of a break is then recorded into a reused buffer, since it's
+// not known which frame is the last until the user steps. When the break ends
+// (Commit), the frame is kept: vertex data and note text are deduplicated
+// by content, so geometry that doesn't change between hits is stored once
+// (and uploaded to the GPU once when replayed), and images are kept alive by
+// reference counting their textures (LoadImage gives an image slot a new
+// texture instead of overwriting one that's referenced). The oldest hits
+// are dropped once the history uses more than VDB_HISTORY_BUDGET bytes.
+//
+// Custom shaders, render targets and volume images are not recorded. The
+// values of the widgets panel are kept as text and listed in the window.
+//
+// The same commands are what vdbTraceRecord writes to disk for each hit
+// (see trace.h), and vdbTraceLoad hands the hits it reads back to AddFrame.
+#include <vector>
+#include <unordered_map>
+
+enum history_cmd_type_t
+{
+    history_cmd_clear = 0,
+    history_cmd_draw,
+    history_cmd_image,
+    history_cmd_note,
+    history_cmd_widgets // the values of the widgets panel (shown in the History window)
+};
+
+// Vertices or note text, shared by all recorded hits with the same content
+struct history_blob_t
+{
+    uint64_t hash;
+    size_t size;
+    int refs;
+    GLuint vbo; // created when first replayed
+    history_blob_t *next; // with the same hash
+    // followed by size bytes
+    char *Data() { return (char*)(this + 1); }
+};
+
+struct history_cmd_t
+{
+    history_cmd_type_t type;
+    imm_state_t state;
+    vdbMat4 projection;
+    vdbMat4 view_model;
+    int viewport[4];
+    GLuint texture; // of images and textured geometry, or 0
+    int image; // the image slot of the texture, or -1 (used by trace files)
+
+    // draw
+    imm_prim_type_t prim_type;
+    bool texel_specified;
+    size_t count;
+    int list; // the user draw list (vdbDrawList) that is drawn, or -1
+
+    // image
+    float pvm[4*4];
+    bool is_mono;
+    vdbTextureFilter filter;
+    vdbTextureWrap wrap;
+    vdbVec4 v_min, v_max; // also the clear color (v_min)
+
+    // image rectangle, or note position in window units (x,y) and alignment (w,h)
+    float x, y, w, h;
+
+    // vertices or text: in the arena while recording, in a blob once committed
+    size_t offset, size;
+    history_blob_t *blob;
+};
+
+struct history_frame_t
+{
+    const char *label; // of the break
+    int hit; // counts breakpoint hits since the program started
+    std::vector<history_cmd_t> cmds;
+};
+
+namespace history
+{
+    // The frame is recorded by the thread that runs the break, which may be a
+    // watched block while the viewer records its own (see watch.h)
+    static thread_local bool recording; // between vdbBeginBreak and vdbEndBreak
+    static thread_local std::vector<history_cmd_t> cmds; // of the current frame
+    static thread_local std::vector<char> arena; // data of the current frame's commands
+    static std::vector<imm_vertex_t> shared_list_vertices[IMM_MAX_LISTS];
+    static thread_local std::vector<imm_vertex_t> *list_vertices = shared_list_vertices; // see vdbBeginList (a block has its own, like imm)
+    static std::vector<history_frame_t*> frames; // oldest first
+    static std::unordered_map<uint64_t, history_blob_t*> blobs;
+    static std::unordered_map<GLuint, int> texture_refs;
+    static size_t used_bytes;
+    static int hits;
+    static int viewing = -1; // the frame shown instead of the live one, or -1
+    static bool follow; // show the newest frame instead of the live one (see watch.h)
+    static bool enabled; // the History window is open (see ui::HistoryWindow)
+
+    static bool IsRecording() { return recording; }
+    static bool IsViewing() { return viewing >= 0; }
+
+    static uint64_t Hash(const void *data, size_t size)
+    {
+        const unsigned char *p = (const unsigned char*)data;
+        uint64_t h = 0xcbf29ce484222325ull ^ size;
+        size_t i = 0;
+        for (; i + 8 <= size; i += 8)
+        {
+            uint64_t word;
+            memcpy(&word, p + i, 8);
+            h = (h ^ word)*0x100000001b3ull;
+            h ^= h >> 29;
+        }
+        for (; i < size; i++)
+            h = (h ^ p[i])*0x100000001b3ull;
+        return h;
+    }
+
+    static history_blob_t *AddBlob(const void *data, size_t size)
+    {
+        uint64_t hash = Hash(data, size);
+        history_blob_t *&first = blobs[hash];
+        for (history_blob_t *b = first; b; b = b->next)
+        {
+            if (b->size == size && memcmp(b->Data(), data, size) == 0)
+            {
+                b->refs++;
+                return b;
+            }
+        }
+        history_blob_t *b = (history_blob_t*)malloc(sizeof(history_blob_t) + size);
+        assert(b && "Failed to allocate memory for breakpoint history");
+        b->hash = hash;
+        b->size = size;
+        b->refs = 1;
+        b->vbo = 0;
+        b->next = first;
+        memcpy(b->Data(), data, size);
+        first = b;
+        used_bytes += sizeof(history_blob_t) + size;
+        return b;
+    }
+
+    static void ReleaseBlob(history_blob_t *b)
+    {
+        if (--b->refs > 0)
+            return;
+        std::unordered_map<uint64_t, history_blob_t*>::iterator it = blobs.find(b->hash);
+        assert(it != blobs.end());
+        history_blob_t **link = &it->second;
+        while (*link != b)
+            link = &(*link)->next;
+        *link = b->next;
+        if (!it->second)
+            blobs.erase(it);
+        if (b->vbo)
+            glDeleteBuffers(1, &b->vbo);
+        used_bytes -= sizeof(history_blob_t) + b->size;
+        free(b);
+    }
+
+    static bool IsReferenced(GLuint texture)
+    {
+        return texture_refs.find(texture) != texture_refs.end();
+    }
+
+    static bool IsImageTexture(GLuint texture)
+    {
+        for (int i = 0; i < MAX_IMAGES; i++)
+            if (images[i].handle == texture && !images[i].volume)
+                return true;
+        return false;
+    }
+
+    static void ReleaseTexture(GLuint texture)
+    {
+        std::unordered_map<GLuint, int>::iterator it = texture_refs.find(texture);
+        assert(it != texture_refs.end());
+        if (--it->second > 0)
+            return;
+        texture_refs.erase(it);
+        if (!IsImageTexture(texture)) // the slot was given a new texture
+            glDeleteTextures(1, &texture);
+    }
+
+    static void DropOldest()
+    {
+        history_frame_t *frame = frames[0];
+        for (size_t i = 0; i < frame->cmds.size(); i++)
+        {
+            history_cmd_t &cmd = frame->cmds[i];
+            if (cmd.blob)
+                ReleaseBlob(cmd.blob);
+            if (cmd.texture)
+                ReleaseTexture(cmd.texture);
+        }
+        used_bytes -= sizeof(history_frame_t) + frame->cmds.size()*sizeof(history_cmd_t);
+        delete frame;
+        frames.erase(frames.begin());
+        if (viewing > 0)
+            viewing--; // keep showing the same frame
+    }
+
+    static history_cmd_t *AddCommand(history_cmd_type_t type)
+    {
+        history_cmd_t cmd;
+        memset(&cmd, 0, sizeof(cmd));
+        cmd.type = type;
+        cmd.state = immediate::GetState();
+        cmd.projection = transform::projection;
+        cmd.view_model = transform::view_model;
+        cmd.viewport[0] = transform::viewport_left;
+        cmd.viewport[1] = transform::viewport_bottom;
+        cmd.viewport[2] = transform::viewport_width;
+        cmd.viewport[3] = transform::viewport_height;
+        cmd.list = -1;
+        cmd.image = -1;
+        cmds.push_back(cmd);
+        return &cmds.back();
+    }
+
+    static void AddData(history_cmd_t *cmd, const void *data, size_t size)
+    {
+        cmd->offset = arena.size();
+        cmd->size = size;
+        arena.insert(arena.end(), (const char*)data, (const char*)data + size);
+    }
+
+    // Returns the texture that vdb last bound to unit 0 if it's the texture of
+    // an image slot, or one the history keeps alive (the slot may have been
+    // given a new one since). Tracked in image.h rather than queried from GL,
+    // which would stall on some drivers. Other textures (e.g. of render
+    // targets) may not outlive the frame.
+    static GLuint BoundImageTexture()
+    {
+        if (!bound_texture)
+            return 0;
+        if ((bound_image >= 0 && images[bound_image].handle == bound_texture) || IsReferenced(bound_texture))
+            return bound_texture;
+        return 0;
+    }
+
+    // Called by vdbEnd, with the vertices of the immediate-mode block
+    static void RecordDraw(imm_list_t *list, const imm_vertex_t *vertices)
+    {
+        if (!recording)
+            return;
+        history_cmd_t *cmd = AddCommand(history_cmd_draw);
+        cmd->prim_type = list->prim_type;
+        cmd->texel_specified = list->texel_specified;
+        cmd->count = list->count;
+        if (list->texel_specified)
+        {
+            cmd->texture = BoundImageTexture();
+            cmd->image = bound_image;
+        }
+        AddData(cmd, vertices, list->count*sizeof(imm_vertex_t));
+    }
+
+    // Called by vdbEnd when a user draw list was filled. Lists are kept even
+    // while not recording, since they are usually filled once and drawn in
+    // every frame from then on.
+    static void RecordList(int slot, const imm_vertex_t *vertices, size_t count)
+    {
+        if (VDB_HISTORY_BUDGET > 0 || window::IsHeadless())
+            list_vertices[slot].assign(vertices, vertices + count);
+    }
+
+    // Called by vdbDrawList. The vertices are copied when the hit is committed.
+    static void RecordDrawList(int slot, imm_list_t *list)
+    {
+        if (!recording || list->count == 0 || list_vertices[slot].size() != list->count)
+            return;
+        history_cmd_t *cmd = AddCommand(history_cmd_draw);
+        cmd->prim_type = list->prim_type;
+        cmd->texel_specified = list->texel_specified;
+        cmd->count = list->count;
+        cmd->list = slot;
+        if (list->texel_specified)
+        {
+            cmd->texture = BoundImageTexture();
+            cmd->image = bound_image;
+        }
+    }
+
+    static void RecordClear(vdbVec4 color)
+    {
+        if (!recording)
+            return;
+        AddCommand(history_cmd_clear)->v_min = color;
+    }
+
+    static void RecordImage(int slot, GLuint texture, bool is_mono, float *pvm, float x, float y, float w, float h,
+                            vdbTextureFilter filter, vdbTextureWrap wrap, vdbVec4 v_min, vdbVec4 v_max)
+    {
+        if (!recording)
+            return;
+        history_cmd_t *cmd = AddCommand(history_cmd_image);
+        cmd->texture = texture;
+        cmd->image = slot;
+        cmd->is_mono = is_mono;
+        memcpy(cmd->pvm, pvm, sizeof(cmd->pvm));
+        cmd->x = x; cmd->y = y; cmd->w = w; cmd->h = h;
+        cmd->filter = filter;
+        cmd->wrap = wrap;
+        cmd->v_min = v_min;
+        cmd->v_max = v_max;
+    }
+
+    static void RecordNote(float x, float y, float align_x, float align_y, const char *text)
+    {
+        if (!recording)
+            return;
+        history_cmd_t *cmd = AddCommand(history_cmd_note);
+        cmd->x = x; cmd->y = y; cmd->w = align_x; cmd->h = align_y;
+        AddData(cmd, text, strlen(text) + 1);
+    }
+
+    // Called by vdbEndBreak, with one line per widget
+    static void RecordWidgets(const char *text)
+    {
+        if (!recording)
+            return;
+        AddData(AddCommand(history_cmd_widgets), text, strlen(text) + 1);
+    }
+
+    static void BeginFrame()
+    {
+        cmds.clear();
+        arena.clear();
+        recording = (VDB_HISTORY_BUDGET > 0 && (enabled || follow)) || window::IsHeadless(); // see trace.h
+    }
+
+    // Takes ownership of a frame whose blobs are referenced, and drops the
+    // oldest frames if the history exceeds its budget
+    static void AddFrame(history_frame_t *frame)
+    {
+        for (size_t i = 0; i < frame->cmds.size(); i++)
+            if (frame->cmds[i].texture)
+                texture_refs[frame->cmds[i].texture]++;
+        used_bytes += sizeof(history_frame_t) + frame->cmds.size()*sizeof(history_cmd_t);
+        frames.push_back(frame);
+        while (used_bytes > VDB_HISTORY_BUDGET && frames.size() > 1)
+            DropOldest();
+    }
+
+    // Keeps the last recorded frame of a break that has ended
+    static void Commit(const char *label)
+    {
+        if (cmds.empty())
+            return;
+        if (!follow)
+            viewing = -1;
+
+        history_frame_t *frame = new history_frame_t;
+        frame->label = label;
+        frame->hit = hits++;
+        frame->cmds = cmds;
+        for (size_t i = 0; i < frame->cmds.size(); i++)
+        {
+            history_cmd_t &cmd = frame->cmds[i];
+            if (cmd.list >= 0)
+                cmd.blob = AddBlob(list_vertices[cmd.list].data(), cmd.count*sizeof(imm_vertex_t));
+            else if (cmd.type != history_cmd_clear && cmd.type != history_cmd_image)
+                cmd.blob = AddBlob(&arena[cmd.offset], cmd.size);
+        }
+        AddFrame(frame);
+        cmds.clear();
+        arena.clear();
+    }
+
+    static void Replay(history_frame_t *frame)
+    {
+        imm_state_t state = immediate::GetState();
+        vdbMat4 projection = transform::projection;
+        vdbMat4 view_model = transform::view_model;
+        int viewport[4] = { transform::viewport_left, transform::viewport_bottom, transform::viewport_width, transform::viewport_height };
+
+        for (size_t i = 0; i < frame->cmds.size(); i++)
+        {
+            history_cmd_t &cmd = frame->cmds[i];
+            immediate::SetState(cmd.state);
+            transform::projection = cmd.projection;
+            transform::view_model = cmd.view_model;
+            transform::pvm = vdbMul4x4(cmd.projection, cmd.view_model);
+            vdbViewporti(cmd.viewport[0], cmd.viewport[1], cmd.viewport[2], cmd.viewport[3]);
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_2D, cmd.texture);
+
+            if (cmd.type == history_cmd_clear)
+            {
+                vdbClearColor(cmd.v_min.x, cmd.v_min.y, cmd.v_min.z, cmd.v_min.w);
+            }
+            else if (cmd.type == history_cmd_draw)
+            {
+                history_blob_t *b = cmd.blob;
+                if (!b->vbo)
+                {
+                    glGenBuffers(1, &b->vbo);
+                    glBindBuffer(GL_ARRAY_BUFFER, b->vbo);
+                    glBufferData(GL_ARRAY_BUFFER, b->size, b->Data(), GL_STATIC_DRAW);
+                    glBindBuffer(GL_ARRAY_BUFFER, 0);
+                }
+                imm_list_t list;
+                memset(&list, 0, sizeof(list));
+                list.count = cmd.count;
+                list.vbo = b->vbo;
+                list.prim_type = cmd.prim_type;
+                list.texel_specified = cmd.texel_specified;
+                list.hash = b->hash;
+                DrawImmediate(list);
+            }
+            else if (cmd.type == history_cmd_image)
+            {
+                vdbSetTextureParameters(cmd.filter, cmd.wrap);
+                DrawImageQuad(cmd.is_mono, cmd.pvm, cmd.x, cmd.y, cmd.w, cmd.h, cmd.v_min, cmd.v_max);
+            }
+            else if (cmd.type == history_cmd_note)
+            {
+                using namespace immediate_util;
+                ImFormatString(temp_buffer, sizeof(temp_buffer), "vdb_tooltip_%d", note_index++);
+                ImGui::SetNextWindowPos(ImVec2(cmd.x, cmd.y), 0, ImVec2(cmd.w, cmd.h));
+                ImGui::Begin(temp_buffer, 0, ImGuiWindowFlags_NoInputs|ImGuiWindowFlags_NoTitleBar|ImGuiWindowFlags_NoMove|ImGuiWindowFlags_NoResize|ImGuiWindowFlags_NoSavedSettings|ImGuiWindowFlags_AlwaysAutoResize);
+                ImGui::TextUnformatted(cmd.blob->Data());
+                ImGui::End();
+            }
+        }
+
+        glBindTexture(GL_TEXTURE_2D, 0);
+        bound_texture = 0;
+        immediate::SetState(state);
+        transform::projection = projection;
+        transform::view_model = view_model;
+        transform::pvm = vdbMul4x4(projection, view_model);
+        vdbViewporti(viewport[0], viewport[1], viewport[2], viewport[3]);
+    }
+
+    // Stops recording, and draws the frame that is viewed (if any) over the live one
+    static void EndFrame()
+    {
+        recording = false;
+        if (window::IsHeadless())
+            return;
+        if (viewing >= (int)frames.size())
+            viewing = -1;
+        int shown = viewing;
+        if (shown < 0 && follow)
+            shown = (int)frames.size() - 1;
+        damage::Add(shown);
+        if (shown < 0)
+            return;
+        vdb_style_t style = GetStyle();
+        glDepthMask(GL_TRUE);
+        glClearDepth(1.0f);
+        glClearColor(style.clear.x, style.clear.y, style.clear.z, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT|GL_DEPTH_BUFFER_BIT);
+        glDepthMask(GL_FALSE);
+        Replay(frames[shown]);
+    }
+}
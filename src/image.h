@@ -22,7 +22,11 @@ struct image_t
 };
 
 enum { MAX_IMAGES = 1024 };
-static image_t images[MAX_IMAGES];
+static image_t shared_images[MAX_IMAGES];
+static thread_local image_t *images = shared_images; // a watched block has its own (see watch::BeginBlock)
+static thread_local int active_texture_unit; // see vdbActiveTextureUnit
+static thread_local int bound_image = -1; // slot bound to unit 0 by vdbBindImage, or -1 (recorded in traces)
+static thread_local GLuint bound_texture; // GL_TEXTURE_2D of unit 0 as vdb last bound it (see history::BoundImageTexture)
 
 image_t *GetImage(int slot)
 {
@@ -57,6 +61,8 @@ GLenum TextureWrapToGL(vdbTextureWrap wrap)
 
 void vdbSetTextureParameters(vdbTextureFilter filter, vdbTextureWrap wrap)
 {
+    damage::Add(filter);
+    damage::Add(wrap);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, (filter == VDB_LINEAR_MIPMAP) ? GL_LINEAR : TextureFilterToGL(filter));
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, TextureFilterToGL(filter));
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S,     TextureWrapToGL(wrap));
@@ -93,9 +99,30 @@ GLuint TexImage2D(
     if (min_filter == GL_LINEAR_MIPMAP_LINEAR)
         glGenerateMipmap(GL_TEXTURE_2D);
     glBindTexture(GL_TEXTURE_2D, 0);
+    if (active_texture_unit == 0)
+        bound_texture = 0;
     return result;
 }
 
+namespace history
+{
+    static bool IsReferenced(GLuint texture);
+    static void RecordImage(int slot, GLuint texture, bool is_mono, float *pvm, float x, float y, float w, float h,
+                            vdbTextureFilter filter, vdbTextureWrap wrap, vdbVec4 v_min, vdbVec4 v_max);
+}
+namespace trace
+{
+    static void WriteImage(int slot, const void *data, int width, int height, int channels, bool is_float);
+}
+namespace watch
+{
+    static void QueueImage(int slot, const void *data, int width, int height, int channels, bool is_float);
+}
+namespace remote
+{
+    static void QueueImage(int slot, const void *data, int width, int height, int channels, bool is_float);
+}
+
 void LoadImage(int slot,
                const void *data,
                int width,
@@ -111,6 +138,8 @@ void LoadImage(int slot,
     image_t *image = GetImage(slot);
     image->width = width;
     image->height = height;
+    if (image->handle && history::IsReferenced(image->handle))
+        image->handle = 0; // the old texture is kept (and freed) by the breakpoint history
     image->volume = false;
     if (!image->handle)
         glGenTextures(1, &image->handle);
@@ -130,6 +159,8 @@ void LoadImage(int slot,
                  data_type,
                  data);
     glBindTexture(GL_TEXTURE_2D, 0);
+    if (active_texture_unit == 0)
+        bound_texture = 0;
 }
 
 void LoadVolume(int slot,
@@ -151,6 +182,8 @@ void LoadVolume(int slot,
     image->height = height;
     image->depth = depth;
     image->volume = true;
+    if (image->handle && history::IsReferenced(image->handle))
+        image->handle = 0;
     if (!image->handle)
         glGenTextures(1, &image->handle);
     glBindTexture(GL_TEXTURE_3D, image->handle);
@@ -173,9 +206,41 @@ void LoadVolume(int slot,
     glBindTexture(GL_TEXTURE_3D, 0);
 }
 
+// While recording a trace, images are written to the trace file instead of
+// being uploaded (see vdbTraceRecord), and in a watched block they are queued
+// for the viewer thread to upload (see vdbWatch)
+static void LoadImageHeadless(int slot, const void *data, int width, int height, int channels, bool is_float)
+{
+    image_t *image = GetImage(slot);
+    image->width = width;
+    image->height = height;
+    image->channels = channels;
+    image->volume = false;
+    trace::WriteImage(slot, data, width, height, channels, is_float);
+    watch::QueueImage(slot, data, width, height, channels, is_float);
+    remote::QueueImage(slot, data, width, height, channels, is_float);
+}
+
+// The content is hashed instead of marking the frame damaged, so that an image
+// that is loaded with the same data every frame doesn't cause a redraw
+static void LoadImageDamage(int slot, const void *data, int width, int height, size_t size)
+{
+    damage::Add(slot);
+    damage::Add(width);
+    damage::Add(height);
+    damage::Add(data, size);
+}
+
 void vdbLoadImageUint8(int slot, const void *data, int width, int height, int channels)
 {
     assert(channels >= 1 && channels <= 4 && "'channels' must be 1,2,3 or 4");
+    if (window::IsHeadless())
+    {
+        LoadImageHeadless(slot, data, width, height, channels, false);
+        return;
+    }
+    GLCallSite(NULL);
+    LoadImageDamage(slot, data, width, height, width*height*channels*sizeof(unsigned char));
     if      (channels == 1) LoadImage(slot, data, width, height, GL_RED, GL_UNSIGNED_BYTE, GL_RGBA);
     else if (channels == 2) LoadImage(slot, data, width, height, GL_RG, GL_UNSIGNED_BYTE, GL_RGBA);
     else if (channels == 3) LoadImage(slot, data, width, height, GL_RGB, GL_UNSIGNED_BYTE, GL_RGBA);
@@ -186,6 +251,13 @@ void vdbLoadImageUint8(int slot, const void *data, int width, int height, int ch
 void vdbLoadImageFloat32(int slot, const void *data, int width, int height, int channels)
 {
     assert(channels >= 1 && channels <= 4 && "'channels' must be 1,2,3 or 4");
+    if (window::IsHeadless())
+    {
+        LoadImageHeadless(slot, data, width, height, channels, true);
+        return;
+    }
+    GLCallSite(NULL);
+    LoadImageDamage(slot, data, width, height, width*height*channels*sizeof(float));
     if      (channels == 1) LoadImage(slot, data, width, height, GL_RED, GL_FLOAT, GL_RGBA32F);
     else if (channels == 2) LoadImage(slot, data, width, height, GL_RG, GL_FLOAT, GL_RGBA32F);
     else if (channels == 3) LoadImage(slot, data, width, height, GL_RGB, GL_FLOAT, GL_RGBA32F);
@@ -196,6 +268,12 @@ void vdbLoadImageFloat32(int slot, const void *data, int width, int height, int
 void vdbLoadVolumeFloat32(int slot, const void *data, int width, int height, int depth, int channels)
 {
     assert(channels >= 1 && channels <= 4 && "'channels' must be 1,2,3 or 4");
+    if (window::IsHeadless()) // volumes are not traced
+    {
+        GetImage(slot)->volume = true;
+        return;
+    }
+    GLCallSite(NULL);
     if      (channels == 1) LoadVolume(slot, data, width, height, depth, GL_RED, GL_FLOAT, GL_RGBA32F);
     else if (channels == 2) LoadVolume(slot, data, width, height, depth, GL_RG, GL_FLOAT, GL_RGBA32F);
     else if (channels == 3) LoadVolume(slot, data, width, height, depth, GL_RGB, GL_FLOAT, GL_RGBA32F);
@@ -203,11 +281,13 @@ void vdbLoadVolumeFloat32(int slot, const void *data, int width, int height, int
     GetImage(slot)->channels = channels;
 }
 
-void vdbDrawImage(int slot,
+// Draws the texture bound to unit 0 with the image shader, as a quad with
+// corners (x,y) and (x+w,y+h) transformed by pvm. Single-channel (mono)
+// textures are mapped through the current colormap.
+static void DrawImageQuad(bool is_mono,
+    float *pvm,
     float x, float y,
     float w, float h,
-    vdbTextureFilter filter,
-    vdbTextureWrap wrap,
     vdbVec4 v_min,
     vdbVec4 v_max)
 {
@@ -224,9 +304,18 @@ void vdbDrawImage(int slot,
     static GLint uniform_im_pos   = glGetUniformLocation(program, "im_pos");
     static GLint uniform_im_size  = glGetUniformLocation(program, "im_size");
 
+    damage::Add(is_mono);
+    damage::Add(pvm, 4*4*sizeof(float));
+    damage::Add(x); damage::Add(y);
+    damage::Add(w); damage::Add(h);
+    damage::Add(v_min);
+    damage::Add(v_max);
+    damage::Add(bound_image);
+    damage::Add(colormap::current_colormap);
+
     glUseProgram(program);
 
-    if (GetImage(slot)->channels == 1)
+    if (is_mono)
     {
         vdbColormapData *cmap = colormap::GetColormapData();
         assert(cmap);
@@ -256,11 +345,8 @@ void vdbDrawImage(int slot,
         glUniform1i(uniform_is_cmap, 0);
     }
 
-    vdbBindImage(slot, filter, wrap);
     glUniform1i(uniform_sampler0, 0);
 
-    float pvm[4*4];
-    vdbGetPVM(pvm);
     UniformMat4fv(uniform_pvm, 1, pvm);
     glUniform2f(uniform_im_pos, x, y);
     glUniform2f(uniform_im_size, w, h);
@@ -294,21 +380,64 @@ void vdbDrawImage(int slot,
     glBindVertexArray(0);
     glActiveTexture(GL_TEXTURE0);
     glBindTexture(GL_TEXTURE_2D, 0);
+    bound_texture = 0;
     glUseProgram(0);
 }
 
+void vdbDrawImage(int slot,
+    float x, float y,
+    float w, float h,
+    vdbTextureFilter filter,
+    vdbTextureWrap wrap,
+    vdbVec4 v_min,
+    vdbVec4 v_max)
+{
+    float pvm[4*4];
+    vdbGetPVM(pvm);
+    image_t *image = GetImage(slot);
+    if (!image->volume)
+        history::RecordImage(slot, image->handle, image->channels == 1, pvm, x, y, w, h, filter, wrap, v_min, v_max);
+    if (window::IsHeadless())
+        return;
+    GLCallSite(NULL);
+    glActiveTexture(GL_TEXTURE0);
+    active_texture_unit = 0;
+    vdbBindImage(slot, filter, wrap);
+    DrawImageQuad(image->channels == 1, pvm, x, y, w, h, v_min, v_max);
+    bound_image = -1; // unbound by DrawImageQuad
+}
+
 void vdbActiveTextureUnit(int unit)
 {
+    active_texture_unit = unit;
+    if (window::IsHeadless())
+        return;
     glActiveTexture(GL_TEXTURE0 + unit);
 }
 
 void vdbUnbindTexture()
 {
+    if (active_texture_unit == 0)
+    {
+        bound_image = -1;
+        bound_texture = 0;
+    }
+    if (window::IsHeadless())
+        return;
     glBindTexture(GL_TEXTURE_2D, 0);
 }
 
 void vdbBindImage(int slot, vdbTextureFilter filter, vdbTextureWrap wrap)
 {
+    if (active_texture_unit == 0)
+    {
+        bound_image = GetImage(slot)->volume ? -1 : slot;
+        if (!GetImage(slot)->volume) // volumes are bound to GL_TEXTURE_3D
+            bound_texture = GetImage(slot)->handle;
+    }
+    if (window::IsHeadless())
+        return;
+    GLCallSite(NULL);
     if (GetImage(slot)->volume)
         glBindTexture(GL_TEXTURE_3D, GetImage(slot)->handle);
     else
@@ -35,6 +35,7 @@ struct imm_list_t
     GLuint vbo;
     imm_prim_type_t prim_type;
     bool texel_specified;
+    uint64_t hash; // of the vertices (see damage.h)
 };
 
 struct imm_state_t
@@ -81,14 +82,36 @@ struct imm_t
     imm_list_t user_lists[IMM_MAX_LISTS];
 
     vdbVec2 ndc_offset;
+
+    bool clear_color_was_set;
+    vdbVec4 clear_color;
 };
 
-static imm_t imm;
+// A watched block draws with its own (see watch::BeginBlock), since the lists
+// and vertex buffer are kept between breaks
+static imm_t shared_imm;
+static thread_local imm_t *imm = &shared_imm;
+
+namespace history
+{
+    static void RecordDraw(imm_list_t *list, const imm_vertex_t *vertices);
+    static void RecordList(int slot, const imm_vertex_t *vertices, size_t count);
+    static void RecordDrawList(int slot, imm_list_t *list);
+    static void RecordClear(vdbVec4 color);
+}
 
 namespace immediate
 {
-    static bool clear_color_was_set;
-    static vdbVec4 clear_color;
+    // Sets an imm->state flag and the matching OpenGL capability, if there is
+    // a context to set it in (see window::IsHeadless)
+    static void SetEnabled(GLenum cap, GLboolean *state, bool enabled)
+    {
+        *state = enabled ? GL_TRUE : GL_FALSE;
+        if (window::IsHeadless())
+            return;
+        if (enabled) glEnable(cap);
+        else glDisable(cap);
+    }
 
     static void DefaultState()
     {
@@ -102,12 +125,16 @@ namespace immediate
         vdbCullFace(false);
         vdbInverseColor(false);
         vdbDepthFuncLessOrEqual();
-        glDisable(GL_SCISSOR_TEST);
+        SetEnabled(GL_SCISSOR_TEST, &imm->state.enable_scissor_test, false);
+        if (window::IsHeadless())
+            return;
         glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
     }
 
     static imm_state_t GetState()
     {
+        if (window::IsHeadless())
+            return imm->state; // kept up to date by the vdb* state functions below
         imm_state_t s = {0};
         glGetIntegerv(GL_BLEND_SRC_RGB, (GLint*)&s.blend_src_rgb);
         glGetIntegerv(GL_BLEND_DST_RGB, (GLint*)&s.blend_dst_rgb);
@@ -122,11 +149,11 @@ namespace immediate
         s.enable_depth_test = glIsEnabled(GL_DEPTH_TEST);
         s.enable_scissor_test = glIsEnabled(GL_SCISSOR_TEST);
         s.enable_color_logic_op = glIsEnabled(GL_COLOR_LOGIC_OP);
-        s.line_width = imm.state.line_width;
-        s.point_size = imm.state.point_size;
-        s.point_segments = imm.state.point_segments;
-        s.line_width_is_3D = imm.state.line_width_is_3D;
-        s.point_size_is_3D = imm.state.point_size_is_3D;
+        s.line_width = imm->state.line_width;
+        s.point_size = imm->state.point_size;
+        s.point_segments = imm->state.point_segments;
+        s.line_width_is_3D = imm->state.line_width_is_3D;
+        s.point_size_is_3D = imm->state.point_size_is_3D;
         return s;
     }
 
@@ -141,83 +168,86 @@ namespace immediate
         if (s.enable_depth_test) glEnable(GL_DEPTH_TEST); else glDisable(GL_DEPTH_TEST);
         if (s.enable_scissor_test) glEnable(GL_SCISSOR_TEST); else glDisable(GL_SCISSOR_TEST);
         if (s.enable_color_logic_op) vdbInverseColor(true); else vdbInverseColor(false);
-        imm.state.line_width = s.line_width;
-        imm.state.point_size = s.point_size;
-        imm.state.point_segments = s.point_segments;
-        imm.state.line_width_is_3D = s.line_width_is_3D;
-        imm.state.point_size_is_3D = s.point_size_is_3D;
+        imm->state.line_width = s.line_width;
+        imm->state.point_size = s.point_size;
+        imm->state.point_segments = s.point_segments;
+        imm->state.line_width_is_3D = s.line_width_is_3D;
+        imm->state.point_size_is_3D = s.point_size_is_3D;
     }
 
     static void SetRenderOffsetNDC(vdbVec2 ndc_offset)
     {
-        imm.ndc_offset = ndc_offset;
+        imm->ndc_offset = ndc_offset;
     }
 
     static void BeginFrame()
     {
         immediate::DefaultState();
-        immediate::clear_color_was_set = false;
+        imm->clear_color_was_set = false;
     }
 }
 
 static void BeginImmediate(imm_prim_type_t prim_type)
 {
-    if (!imm.initialized)
+    if (!imm->initialized)
     {
-        imm.initialized = true;
-
-        if (imm.state.line_width == 0.0f)
-            imm.state.line_width = 1.0f;
-        if (imm.state.point_size == 0.0f)
-            imm.state.point_size = 1.0f;
-        if (imm.state.point_segments == 0)
-            imm.state.point_segments = 16;
-
-        imm.buffer_capacity = 1024*100;
-        imm.buffer = new imm_vertex_t[imm.buffer_capacity];
-        assert(imm.buffer);
-
-        glGenVertexArrays(1, &imm.vao);
-
-        static unsigned char default_texture_data[] = { 255, 255, 255, 255 };
-        glGenTextures(1, &imm.default_texture);
-        glBindTexture(GL_TEXTURE_2D, imm.default_texture);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1,  1,  0, GL_RGBA, GL_UNSIGNED_BYTE, default_texture_data);
-        glBindTexture(GL_TEXTURE_2D, 0);
-
-        imm.vertex.color[0] = 0;
-        imm.vertex.color[1] = 0;
-        imm.vertex.color[2] = 0;
-        imm.vertex.color[3] = 255;
+        imm->initialized = true;
+
+        if (imm->state.line_width == 0.0f)
+            imm->state.line_width = 1.0f;
+        if (imm->state.point_size == 0.0f)
+            imm->state.point_size = 1.0f;
+        if (imm->state.point_segments == 0)
+            imm->state.point_segments = 16;
+
+        imm->buffer_capacity = 1024*100;
+        imm->buffer = new imm_vertex_t[imm->buffer_capacity];
+        assert(imm->buffer);
+
+        if (!window::IsHeadless())
+        {
+            glGenVertexArrays(1, &imm->vao);
+
+            static unsigned char default_texture_data[] = { 255, 255, 255, 255 };
+            glGenTextures(1, &imm->default_texture);
+            glBindTexture(GL_TEXTURE_2D, imm->default_texture);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1,  1,  0, GL_RGBA, GL_UNSIGNED_BYTE, default_texture_data);
+            glBindTexture(GL_TEXTURE_2D, 0);
+        }
+
+        imm->vertex.color[0] = 0;
+        imm->vertex.color[1] = 0;
+        imm->vertex.color[2] = 0;
+        imm->vertex.color[3] = 255;
     }
 
-    assert(imm.initialized);
-    assert(imm.buffer);
-    assert(imm.vao);
+    assert(imm->initialized);
+    assert(imm->buffer);
+    assert(imm->vao || window::IsHeadless());
 
-    assert(!imm.inside_begin_end && "Missing vdbEnd before vdbBegin");
-    imm.inside_begin_end = true;
-    imm.prim_type = prim_type;
-    imm.count = 0;
-    imm.texel_specified = false;
+    assert(!imm->inside_begin_end && "Missing vdbEnd before vdbBegin");
+    imm->inside_begin_end = true;
+    imm->prim_type = prim_type;
+    imm->count = 0;
+    imm->texel_specified = false;
 
-    imm.vertex.texel[0] = 0.0f;
-    imm.vertex.texel[1] = 0.0f;
+    imm->vertex.texel[0] = 0.0f;
+    imm->vertex.texel[1] = 0.0f;
 
-    imm.vertex.position[0] = 0.0f;
-    imm.vertex.position[1] = 0.0f;
-    imm.vertex.position[2] = 0.0f;
-    imm.vertex.position[3] = 1.0f;
+    imm->vertex.position[0] = 0.0f;
+    imm->vertex.position[1] = 0.0f;
+    imm->vertex.position[2] = 0.0f;
+    imm->vertex.position[3] = 1.0f;
 }
 
 static void DrawImmediatePoints(imm_list_t list)
 {
-    assert(imm.vao);
-    assert(imm.default_texture);
+    assert(imm->vao);
+    assert(imm->default_texture);
 
     if (!glVertexAttribDivisor)
         glVertexAttribDivisor = (GLVERTEXATTRIBDIVISORPROC)SDL_GL_GetProcAddress("glVertexAttribDivisor");
@@ -244,10 +274,10 @@ static void DrawImmediatePoints(imm_list_t list)
         UniformMat4(uniform_model_to_view, 1, transform::view_model);
         glUniform1i(uniform_sampler0, 0); // We assume any user-bound texture is bound to GL_TEXTURE0
         if (!list.texel_specified)
-            glBindTexture(GL_TEXTURE_2D, imm.default_texture);
-        if (imm.state.point_size_is_3D)
+            glBindTexture(GL_TEXTURE_2D, imm->default_texture);
+        if (imm->state.point_size_is_3D)
         {
-            // Note: point_size is treated as a radius inside the shader, but imm.state.point_size
+            // Note: point_size is treated as a radius inside the shader, but imm->state.point_size
             // is considered to be diameter (to be consistent with glPointSize). For efficiency
             // we divide by two before passing it in, so we don't have to do it in the shader.
 
@@ -260,18 +290,18 @@ static void DrawImmediatePoints(imm_list_t list)
             // If the scaling factors are not the same, we choose the smallest one:
             float s = sx < sy ? sx : sy;
 
-            glUniform2f(uniform_point_size, 0.5f*s*imm.state.point_size, 0.5f*s*imm.state.point_size);
+            glUniform2f(uniform_point_size, 0.5f*s*imm->state.point_size, 0.5f*s*imm->state.point_size);
         }
         else
         {
             // Convert point size units from screen pixels to NDC.
             // Note: Division by two as per above.
             glUniform2f(uniform_point_size,
-                        imm.state.point_size/vdbGetWindowWidth(),
-                        imm.state.point_size/vdbGetWindowHeight());
+                        imm->state.point_size/vdbGetWindowWidth(),
+                        imm->state.point_size/vdbGetWindowHeight());
         }
-        glUniform1i(uniform_size_is_3D, imm.state.point_size_is_3D ? 1 : 0);
-        glUniform2f(uniform_ndc_offset, imm.ndc_offset.x, imm.ndc_offset.y);
+        glUniform1i(uniform_size_is_3D, imm->state.point_size_is_3D ? 1 : 0);
+        glUniform2f(uniform_ndc_offset, imm->ndc_offset.x, imm->ndc_offset.y);
     }
 
     // generate primitive geometry
@@ -291,13 +321,13 @@ static void DrawImmediatePoints(imm_list_t list)
             glBindBuffer(GL_ARRAY_BUFFER, 0);
         }
 
-        if (imm.state.point_segments > max_segments)
-            imm.state.point_segments = max_segments;
+        if (imm->state.point_segments > max_segments)
+            imm->state.point_segments = max_segments;
 
         int last_point_segments = 0;
-        if (imm.state.point_segments != last_point_segments)
+        if (imm->state.point_segments != last_point_segments)
         {
-            if (imm.state.point_segments == 4)
+            if (imm->state.point_segments == 4)
             {
                 glBindBuffer(GL_ARRAY_BUFFER, point_geometry_vbo);
                 glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(quad), quad);
@@ -308,25 +338,25 @@ static void DrawImmediatePoints(imm_list_t list)
             else
             {
                 circle[0] = vdbVec2(0.0f, 0.0f);
-                for (int i = 0; i <= imm.state.point_segments; i++)
+                for (int i = 0; i <= imm->state.point_segments; i++)
                 {
-                    float t = 2.0f*3.1415926f*i/(float)(imm.state.point_segments);
+                    float t = 2.0f*3.1415926f*i/(float)(imm->state.point_segments);
                     circle[i+1] = vdbVec2(cosf(t), sinf(t));
                 }
                 glBindBuffer(GL_ARRAY_BUFFER, point_geometry_vbo);
-                glBufferSubData(GL_ARRAY_BUFFER, 0, (imm.state.point_segments+2)*sizeof(vdbVec2), circle);
+                glBufferSubData(GL_ARRAY_BUFFER, 0, (imm->state.point_segments+2)*sizeof(vdbVec2), circle);
                 glBindBuffer(GL_ARRAY_BUFFER, 0);
                 rasterization_mode = GL_TRIANGLE_FAN;
-                rasterization_count = imm.state.point_segments+2;
+                rasterization_count = imm->state.point_segments+2;
             }
-            last_point_segments = imm.state.point_segments;
+            last_point_segments = imm->state.point_segments;
         }
     }
     assert(rasterization_count);
     assert(rasterization_mode);
     assert(point_geometry_vbo);
 
-    glBindVertexArray(imm.vao);
+    glBindVertexArray(imm->vao);
 
     // instance geometry
     glBindBuffer(GL_ARRAY_BUFFER, list.vbo);
@@ -373,8 +403,8 @@ static void DrawImmediateLinesThin(imm_list_t list)
     UniformMat4(uniform_pvm, 1, transform::pvm);
     glUniform1i(uniform_sampler0, 0); // We assume any user-bound texture is bound to GL_TEXTURE0
     if (!list.texel_specified)
-        glBindTexture(GL_TEXTURE_2D, imm.default_texture);
-    glBindVertexArray(imm.vao);
+        glBindTexture(GL_TEXTURE_2D, imm->default_texture);
+    glBindVertexArray(imm->vao);
     glBindBuffer(GL_ARRAY_BUFFER, list.vbo);
     glEnableVertexAttribArray(attrib_position);
     glEnableVertexAttribArray(attrib_texel);
@@ -393,8 +423,8 @@ static void DrawImmediateLinesThin(imm_list_t list)
 
 static void DrawImmediateLinesThick(imm_list_t list)
 {
-    assert(imm.vao);
-    assert(imm.default_texture);
+    assert(imm->vao);
+    assert(imm->default_texture);
 
     if (!glVertexAttribDivisor)
         glVertexAttribDivisor = (GLVERTEXATTRIBDIVISORPROC)SDL_GL_GetProcAddress("glVertexAttribDivisor");
@@ -427,11 +457,11 @@ static void DrawImmediateLinesThick(imm_list_t list)
         UniformMat4(uniform_model_to_view, 1, transform::view_model);
         glUniform1i(uniform_sampler0, 0); // We assume any user-bound texture is bound to GL_TEXTURE0
         if (!list.texel_specified)
-            glBindTexture(GL_TEXTURE_2D, imm.default_texture);
-        if (imm.state.line_width_is_3D)
+            glBindTexture(GL_TEXTURE_2D, imm->default_texture);
+        if (imm->state.line_width_is_3D)
         {
             assert(false && "Not implemented yet");
-            // Note: point_size is treated as a radius inside the shader, but imm.state.point_size
+            // Note: point_size is treated as a radius inside the shader, but imm->state.point_size
             // is considered to be diameter (to be consistent with glPointSize). For efficiency
             // we divide by two before passing it in, so we don't have to do it in the shader.
 
@@ -444,19 +474,19 @@ static void DrawImmediateLinesThick(imm_list_t list)
             // If the scaling factors are not the same, we choose the smallest one:
             float s = sx < sy ? sx : sy;
 
-            glUniform2f(uniform_line_width, 0.5f*s*imm.state.line_width, 0.5f*s*imm.state.line_width);
+            glUniform2f(uniform_line_width, 0.5f*s*imm->state.line_width, 0.5f*s*imm->state.line_width);
         }
         else
         {
             // Convert point size units from screen pixels to NDC.
             // Note: Division by two as per above.
             glUniform2f(uniform_line_width,
-                        imm.state.line_width/vdbGetWindowWidth(),
-                        imm.state.line_width/vdbGetWindowHeight());
+                        imm->state.line_width/vdbGetWindowWidth(),
+                        imm->state.line_width/vdbGetWindowHeight());
         }
         glUniform1f(uniform_aspect, (float)vdbGetFramebufferWidth()/vdbGetFramebufferHeight());
-        glUniform1i(uniform_width_is_3D, imm.state.line_width_is_3D ? 1 : 0);
-        glUniform2f(uniform_ndc_offset, imm.ndc_offset.x, imm.ndc_offset.y);
+        glUniform1i(uniform_width_is_3D, imm->state.line_width_is_3D ? 1 : 0);
+        glUniform2f(uniform_ndc_offset, imm->ndc_offset.x, imm->ndc_offset.y);
     }
 
     // generate primitive geometry
@@ -478,7 +508,7 @@ static void DrawImmediateLinesThick(imm_list_t list)
     assert(rasterization_mode);
     assert(point_geometry_vbo);
 
-    glBindVertexArray(imm.vao);
+    glBindVertexArray(imm->vao);
 
     // instance geometry
     glBindBuffer(GL_ARRAY_BUFFER, list.vbo);
@@ -530,13 +560,13 @@ static void DrawImmediateLinesThick(imm_list_t list)
 
 static void DrawImmediateLines(imm_list_t list)
 {
-    assert(imm.initialized);
+    assert(imm->initialized);
     assert(list.count % 2 == 0 && "LINES type expects vertex count to be a multiple of 2");
 
     bool use_thick_shader =
-        imm.state.line_width_is_3D ||
-        imm.state.line_width*vdbGetRenderScale().x != 1.0f ||
-        imm.state.line_width*vdbGetRenderScale().y != 1.0f;
+        imm->state.line_width_is_3D ||
+        imm->state.line_width*vdbGetRenderScale().x != 1.0f ||
+        imm->state.line_width*vdbGetRenderScale().y != 1.0f;
 
     if (use_thick_shader)
         DrawImmediateLinesThick(list);
@@ -546,7 +576,7 @@ static void DrawImmediateLines(imm_list_t list)
 
 static void DrawImmediateTriangles(imm_list_t list)
 {
-    assert(imm.initialized);
+    assert(imm->initialized);
     assert(list.count % 3 == 0 && "TRIANGLES type expects vertex count to be a multiple of 3");
 
     static GLuint program = LoadShaderFromMemory(shader_triangles_vs, shader_triangles_fs);
@@ -561,10 +591,10 @@ static void DrawImmediateTriangles(imm_list_t list)
     glUseProgram(program);
     UniformMat4(uniform_pvm, 1, transform::pvm);
     glUniform1i(uniform_sampler0, 0); // We assume any user-bound texture is bound to GL_TEXTURE0
-    glUniform2f(ndc_offset, imm.ndc_offset.x, imm.ndc_offset.y);
+    glUniform2f(ndc_offset, imm->ndc_offset.x, imm->ndc_offset.y);
     if (!list.texel_specified)
-        glBindTexture(GL_TEXTURE_2D, imm.default_texture);
-    glBindVertexArray(imm.vao);
+        glBindTexture(GL_TEXTURE_2D, imm->default_texture);
+    glBindVertexArray(imm->vao);
     glBindBuffer(GL_ARRAY_BUFFER, list.vbo);
     glEnableVertexAttribArray(attrib_position);
     glEnableVertexAttribArray(attrib_texel);
@@ -583,8 +613,23 @@ static void DrawImmediateTriangles(imm_list_t list)
 
 static void DrawImmediate(imm_list_t list)
 {
-    if (list.count <= 0)
+    if (list.count <= 0 || window::IsHeadless()) // recorded only (see history::RecordDraw)
         return;
+    if (!list.texel_specified)
+        bound_texture = 0; // imm->default_texture is bound
+    damage::Add(list.hash);
+    damage::Add(list.count);
+    damage::Add(list.prim_type);
+    damage::Add(list.texel_specified);
+    damage::Add(imm->state);
+    damage::Add(imm->ndc_offset);
+    damage::Add(transform::projection);
+    damage::Add(transform::view_model);
+    damage::Add(transform::viewport_left);
+    damage::Add(transform::viewport_bottom);
+    damage::Add(transform::viewport_width);
+    damage::Add(transform::viewport_height);
+    damage::Add(bound_image);
     if      (list.prim_type == IMM_PRIM_POINTS)    DrawImmediatePoints(list);
     else if (list.prim_type == IMM_PRIM_LINES)     DrawImmediateLines(list);
     else if (list.prim_type == IMM_PRIM_TRIANGLES) DrawImmediateTriangles(list);
@@ -593,116 +638,131 @@ static void DrawImmediate(imm_list_t list)
 
 void vdbEnd()
 {
-    assert(imm.initialized);
-    assert(imm.inside_begin_end && "Missing vdbBegin before vdbEnd");
+    assert(imm->initialized);
+    assert(imm->inside_begin_end && "Missing vdbBegin before vdbEnd");
 
-    if (imm.count <= 0)
+    if (imm->count <= 0)
     {
-        imm.inside_begin_end = false;
-        imm.current_list = NULL;
+        imm->inside_begin_end = false;
+        imm->current_list = NULL;
         return;
     }
 
-    imm_list_t *list = &imm.default_list;
+    GLCallSite(NULL);
+
+    imm_list_t *list = &imm->default_list;
     GLenum vbo_mode = GL_STATIC_DRAW;
-    if (imm.current_list)
+    if (imm->current_list)
     {
-        list = imm.current_list;
+        list = imm->current_list;
         vbo_mode = GL_DYNAMIC_DRAW;
     }
 
-    if (!list->vbo)
-        glGenBuffers(1, &list->vbo);
-    assert(list->vbo);
+    if (!window::IsHeadless())
+    {
+        if (!list->vbo)
+            glGenBuffers(1, &list->vbo);
+        assert(list->vbo);
 
-    glBindBuffer(GL_ARRAY_BUFFER, list->vbo);
-    if (list->vbo_capacity >= imm.count)
+        glBindBuffer(GL_ARRAY_BUFFER, list->vbo);
+        if (list->vbo_capacity >= imm->count)
+        {
+            glBufferSubData(GL_ARRAY_BUFFER, 0, imm->count*sizeof(imm_vertex_t), (const GLvoid*)imm->buffer);
+        }
+        else
+        {
+            // We don't need to call glDeleteBuffers as per spec: "BufferData deletes any existing data store"
+            glBufferData(GL_ARRAY_BUFFER, imm->count*sizeof(imm_vertex_t), (const GLvoid*)imm->buffer, vbo_mode);
+            list->vbo_capacity = imm->count;
+        }
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+    list->texel_specified = imm->texel_specified;
+    list->count = imm->count;
+    list->prim_type = imm->prim_type;
+    list->hash = history::Hash(imm->buffer, imm->count*sizeof(imm_vertex_t));
+
+    if (!imm->current_list)
     {
-        glBufferSubData(GL_ARRAY_BUFFER, 0, imm.count*sizeof(imm_vertex_t), (const GLvoid*)imm.buffer);
+        history::RecordDraw(list, imm->buffer);
+        DrawImmediate(*list);
     }
     else
     {
-        // We don't need to call glDeleteBuffers as per spec: "BufferData deletes any existing data store"
-        glBufferData(GL_ARRAY_BUFFER, imm.count*sizeof(imm_vertex_t), (const GLvoid*)imm.buffer, vbo_mode);
-        list->vbo_capacity = imm.count;
+        history::RecordList((int)(imm->current_list - imm->user_lists), imm->buffer, imm->count);
     }
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    list->texel_specified = imm.texel_specified;
-    list->count = imm.count;
-    list->prim_type = imm.prim_type;
-
-    if (!imm.current_list)
-        DrawImmediate(*list);
 
-    imm.inside_begin_end = false;
-    imm.current_list = NULL;
+    imm->inside_begin_end = false;
+    imm->current_list = NULL;
 }
 
 void vdbBeginList(int slot)
 {
     assert(slot >= 0 && slot < IMM_MAX_LISTS);
-    assert(imm.current_list == NULL);
-    imm.current_list = imm.user_lists + slot;
+    assert(imm->current_list == NULL);
+    imm->current_list = imm->user_lists + slot;
 }
 
 void vdbDrawList(int slot)
 {
     assert(slot >= 0 && slot < IMM_MAX_LISTS);
-    DrawImmediate(imm.user_lists[slot]);
+    history::RecordDrawList(slot, &imm->user_lists[slot]);
+    DrawImmediate(imm->user_lists[slot]);
 }
 
 void vdbTexel(float u, float v)
 {
-    assert(imm.inside_begin_end && "vdbTexel cannot be called outside vdbBegin/vdbEnd block");
-    imm.texel_specified = true;
-    imm.vertex.texel[0] = u;
-    imm.vertex.texel[1] = v;
+    assert(imm->inside_begin_end && "vdbTexel cannot be called outside vdbBegin/vdbEnd block");
+    imm->texel_specified = true;
+    imm->vertex.texel[0] = u;
+    imm->vertex.texel[1] = v;
 }
 
 void vdbColor4ub(unsigned char r, unsigned char g, unsigned char b, unsigned char a)
 {
-    imm.vertex.color[0] = (GLubyte)(r);
-    imm.vertex.color[1] = (GLubyte)(g);
-    imm.vertex.color[2] = (GLubyte)(b);
-    imm.vertex.color[3] = (GLubyte)(a);
+    imm->vertex.color[0] = (GLubyte)(r);
+    imm->vertex.color[1] = (GLubyte)(g);
+    imm->vertex.color[2] = (GLubyte)(b);
+    imm->vertex.color[3] = (GLubyte)(a);
 }
 
 void vdbColor(float r, float g, float b, float a)
 {
-    imm.vertex.color[0] = (GLubyte)(255*r);
-    imm.vertex.color[1] = (GLubyte)(255*g);
-    imm.vertex.color[2] = (GLubyte)(255*b);
-    imm.vertex.color[3] = (GLubyte)(255*a);
+    imm->vertex.color[0] = (GLubyte)(255*r);
+    imm->vertex.color[1] = (GLubyte)(255*g);
+    imm->vertex.color[2] = (GLubyte)(255*b);
+    imm->vertex.color[3] = (GLubyte)(255*a);
 }
 
 void vdbVertex(float x, float y, float z, float w)
 {
-    assert(imm.inside_begin_end && "vdbVertex cannot be called outside vdbBegin/vdbEnd block");
-    assert(imm.count < imm.buffer_capacity);
-    imm.vertex.position[0] = x;
-    imm.vertex.position[1] = y;
-    imm.vertex.position[2] = z;
-    imm.vertex.position[3] = w;
-    imm.buffer[imm.count++] = imm.vertex;
-
-    if (imm.count == imm.buffer_capacity)
+    if (vdb_disabled) return;
+    assert(imm->inside_begin_end && "vdbVertex cannot be called outside vdbBegin/vdbEnd block");
+    assert(imm->count < imm->buffer_capacity);
+    imm->vertex.position[0] = x;
+    imm->vertex.position[1] = y;
+    imm->vertex.position[2] = z;
+    imm->vertex.position[3] = w;
+    imm->buffer[imm->count++] = imm->vertex;
+
+    if (imm->count == imm->buffer_capacity)
     {
-        size_t new_buffer_capacity = (3*imm.buffer_capacity)/2;
+        size_t new_buffer_capacity = (3*imm->buffer_capacity)/2;
         imm_vertex_t *new_buffer = new imm_vertex_t[new_buffer_capacity];
         assert(new_buffer && "Ran out of memory expanding buffer");
-        for (size_t i = 0; i < imm.buffer_capacity; i++)
-            new_buffer[i] = imm.buffer[i];
-        free(imm.buffer);
-        imm.buffer = new_buffer;
-        imm.buffer_capacity = new_buffer_capacity;
+        for (size_t i = 0; i < imm->buffer_capacity; i++)
+            new_buffer[i] = imm->buffer[i];
+        free(imm->buffer);
+        imm->buffer = new_buffer;
+        imm->buffer_capacity = new_buffer_capacity;
     }
 }
 
-void vdbLineWidth(float width)                       { imm.state.line_width = width; imm.state.line_width_is_3D = false; }
-void vdbLineWidth3D(float width)                     { imm.state.line_width = width; imm.state.line_width_is_3D = true; }
-void vdbPointSize(float size)                        { imm.state.point_size = size; imm.state.point_size_is_3D = false; }
-void vdbPointSize3D(float size)                      { imm.state.point_size = size; imm.state.point_size_is_3D = true; }
-void vdbPointSegments(int segments)                  { assert(segments >= 3); imm.state.point_segments = segments; }
+void vdbLineWidth(float width)                       { imm->state.line_width = width; imm->state.line_width_is_3D = false; }
+void vdbLineWidth3D(float width)                     { imm->state.line_width = width; imm->state.line_width_is_3D = true; }
+void vdbPointSize(float size)                        { imm->state.point_size = size; imm->state.point_size_is_3D = false; }
+void vdbPointSize3D(float size)                      { imm->state.point_size = size; imm->state.point_size_is_3D = true; }
+void vdbPointSegments(int segments)                  { assert(segments >= 3); imm->state.point_segments = segments; }
 void vdbBeginTriangles()                             { BeginImmediate(IMM_PRIM_TRIANGLES); }
 void vdbBeginLines()                                 { BeginImmediate(IMM_PRIM_LINES); }
 void vdbBeginPoints()                                { BeginImmediate(IMM_PRIM_POINTS); }
@@ -715,13 +775,17 @@ void vdbColor(vdbVec4 v)                      { vdbColor(v.x, v.y, v.z, v.w); }
 
 void vdbInverseColor(bool enable)
 {
+    imm->state.enable_color_logic_op = enable ? GL_TRUE : GL_FALSE;
     if (enable)
     {
-        glLogicOp(GL_XOR);
-        glEnable(GL_COLOR_LOGIC_OP);
+        if (!window::IsHeadless())
+        {
+            glLogicOp(GL_XOR);
+            glEnable(GL_COLOR_LOGIC_OP);
+        }
         vdbColor4ub(0x80, 0x80, 0x80, 0x00);
     }
-    else
+    else if (!window::IsHeadless())
     {
         glDisable(GL_COLOR_LOGIC_OP);
     }
@@ -731,55 +795,72 @@ void vdbClearColor(float r, float g, float b, float a)
 {
     if (!current_framebuffer)
     {
-        immediate::clear_color_was_set = true;
-        immediate::clear_color = vdbVec4(r,g,b,a);
+        imm->clear_color_was_set = true;
+        imm->clear_color = vdbVec4(r,g,b,a);
     }
+    history::RecordClear(vdbVec4(r,g,b,a));
+    if (window::IsHeadless())
+        return;
     glClearColor(r,g,b,a);
     glClear(GL_COLOR_BUFFER_BIT);
 }
 
 void vdbClearDepth(float d)
 {
+    if (window::IsHeadless())
+        return;
     glClearDepth(d);
     glClear(GL_DEPTH_BUFFER_BIT);
 }
 
+// The state functions below also keep imm->state up to date, which is what
+// immediate::GetState returns while recording a trace (without OpenGL).
 void vdbCullFace(bool enabled)
 {
-    if (enabled) glEnable(GL_CULL_FACE);
-    else glDisable(GL_CULL_FACE);
+    immediate::SetEnabled(GL_CULL_FACE, &imm->state.enable_cull_face, enabled);
 }
 
 void vdbBlendNone()
 {
-    glDisable(GL_BLEND);
+    immediate::SetEnabled(GL_BLEND, &imm->state.enable_blend, false);
 }
 
-void vdbBlendAdd()
+static void Blend(GLenum src_rgb, GLenum dst_rgb, GLenum src_alpha, GLenum dst_alpha)
 {
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_ONE, GL_ONE);
+    imm->state.blend_equation_rgb = imm->state.blend_equation_alpha = GL_FUNC_ADD;
+    imm->state.blend_src_rgb = src_rgb;
+    imm->state.blend_dst_rgb = dst_rgb;
+    imm->state.blend_src_alpha = src_alpha;
+    imm->state.blend_dst_alpha = dst_alpha;
+    immediate::SetEnabled(GL_BLEND, &imm->state.enable_blend, true);
+    if (window::IsHeadless()) return;
+    glBlendEquation(GL_FUNC_ADD);
+    glBlendFuncSeparate(src_rgb, dst_rgb, src_alpha, dst_alpha);
 }
 
-void vdbBlendAlpha()
+void vdbBlendAdd() { Blend(GL_ONE, GL_ONE, GL_ONE, GL_ONE); }
+void vdbBlendAlpha() { Blend(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ONE); }
+
+static void DepthFunc(GLenum func)
 {
-    glEnable(GL_BLEND);
-    glBlendEquation(GL_FUNC_ADD);
-    glBlendFuncSeparate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ONE);
+    imm->state.depth_func = func;
+    if (window::IsHeadless()) return;
+    glDepthFunc(func);
 }
 
-void vdbDepthFuncAlways() { glDepthFunc(GL_ALWAYS); }
-void vdbDepthFuncLess() { glDepthFunc(GL_LESS); }
-void vdbDepthFuncLessOrEqual() { glDepthFunc(GL_LEQUAL); }
+void vdbDepthFuncAlways() { DepthFunc(GL_ALWAYS); }
+void vdbDepthFuncLess() { DepthFunc(GL_LESS); }
+void vdbDepthFuncLessOrEqual() { DepthFunc(GL_LEQUAL); }
 
 void vdbDepthTest(bool enabled)
 {
-    if (enabled) glEnable(GL_DEPTH_TEST);
-    else glDisable(GL_DEPTH_TEST);
+    immediate::SetEnabled(GL_DEPTH_TEST, &imm->state.enable_depth_test, enabled);
 }
 
 void vdbDepthWrite(bool enabled)
 {
+    imm->state.depth_writemask = enabled ? GL_TRUE : GL_FALSE;
+    if (window::IsHeadless()) return;
     if (enabled) { glDepthMask(GL_TRUE); glDepthRange(0.0f, 1.0f); }
     else { glDepthMask(GL_FALSE); }
 }
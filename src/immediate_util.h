@@ -1,10 +1,10 @@
-namespace immediate_util
+namespace immediate_util // per thread, like transform
 {
-    static int circle_segments;
-    static int note_index;
-    static float note_align_x;
-    static float note_align_y;
-    static char temp_buffer[1024*3 + 1];
+    static thread_local int circle_segments;
+    static thread_local int note_index;
+    static thread_local float note_align_x;
+    static thread_local float note_align_y;
+    static thread_local char temp_buffer[1024*3 + 1];
     static void BeginFrame()
     {
         note_index = 0;
@@ -19,11 +19,28 @@ void vdbCircleSegments(int segments)
     immediate_util::circle_segments = segments;
 }
 
+namespace history
+{
+    static bool IsRecording();
+    static bool IsViewing();
+    static void RecordNote(float x, float y, float align_x, float align_y, const char *text);
+}
+
 void vdbNoteV(float x, float y, const char *fmt, va_list args)
 {
     using namespace immediate_util;
     vdbVec2 ndc = vdbModelToNDC(x,y,0.0f,1.0f);
     vdbVec2 win = vdbNDCToWindow(ndc.x,ndc.y);
+    if (history::IsRecording())
+    {
+        va_list copy;
+        va_copy(copy, args);
+        vsnprintf(temp_buffer, sizeof(temp_buffer), fmt, copy);
+        va_end(copy);
+        history::RecordNote(win.x, win.y, note_align_x, note_align_y, temp_buffer);
+    }
+    if (window::IsHeadless() || history::IsViewing()) // the notes of the viewed hit are shown instead
+        return;
     ImFormatString(temp_buffer, sizeof(temp_buffer), "vdb_tooltip_%d", note_index);
     ImGui::SetNextWindowPos(ImVec2(win.x, win.y), 0, ImVec2(note_align_x, note_align_y));
     ImGui::Begin(temp_buffer, 0, ImGuiWindowFlags_NoInputs|ImGuiWindowFlags_NoTitleBar|ImGuiWindowFlags_NoMove|ImGuiWindowFlags_NoResize|ImGuiWindowFlags_NoSavedSettings|ImGuiWindowFlags_AlwaysAutoResize);
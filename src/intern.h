@@ -0,0 +1,138 @@
+// Interned strings are copied once into an arena and never freed, such that
+// equal strings share a single, stable pointer. This lets vdb hold on to
+// labels that the user passed as stack-allocated or formatted strings.
+namespace intern
+{
+    enum { block_size = 64*1024 };
+
+    struct block_t
+    {
+        block_t *prev;
+        size_t used;
+        size_t size;
+        // followed by size bytes
+    };
+
+    static SDL_SpinLock lock; // watched blocks intern on their own thread (see watch.h)
+    static block_t *block;
+    static const char **table; // open addressing (linear probing)
+    static unsigned int *hashes;
+    static int capacity;
+    static int count;
+
+    // FNV-1a
+    static unsigned int Hash(const char *s, size_t n)
+    {
+        unsigned int h = 2166136261u;
+        for (size_t i = 0; i < n; i++)
+        {
+            h ^= (unsigned char)s[i];
+            h *= 16777619u;
+        }
+        return h;
+    }
+
+    static unsigned int Hash(const char *s)
+    {
+        unsigned int h = 2166136261u;
+        for (; *s; s++)
+        {
+            h ^= (unsigned char)*s;
+            h *= 16777619u;
+        }
+        return h;
+    }
+
+    // Compares the unterminated string s (of length n) with the terminated string t
+    static bool Equal(const char *s, size_t n, const char *t)
+    {
+        return strncmp(s, t, n) == 0 && t[n] == '\0';
+    }
+
+    static char *Allocate(size_t n)
+    {
+        if (!block || block->used + n > block->size)
+        {
+            size_t size = n > (size_t)block_size ? n : (size_t)block_size;
+            block_t *b = (block_t*)malloc(sizeof(block_t) + size);
+            assert(b && "Failed to allocate memory for interned strings");
+            b->prev = block;
+            b->used = 0;
+            b->size = size;
+            block = b;
+        }
+        char *result = (char*)(block + 1) + block->used;
+        block->used += n;
+        return result;
+    }
+
+    static void Grow()
+    {
+        int new_capacity = capacity ? 2*capacity : 256;
+        const char **new_table = (const char**)calloc(new_capacity, sizeof(const char*));
+        unsigned int *new_hashes = (unsigned int*)calloc(new_capacity, sizeof(unsigned int));
+        assert(new_table && new_hashes);
+        for (int i = 0; i < capacity; i++)
+        {
+            if (!table[i])
+                continue;
+            int j = hashes[i] & (new_capacity - 1);
+            while (new_table[j])
+                j = (j + 1) & (new_capacity - 1);
+            new_table[j] = table[i];
+            new_hashes[j] = hashes[i];
+        }
+        free(table);
+        free(hashes);
+        table = new_table;
+        hashes = new_hashes;
+        capacity = new_capacity;
+    }
+
+    // Returns the interned copy of s, or NULL if s was never interned
+    static const char *Find(const char *s, size_t n, unsigned int hash)
+    {
+        if (!capacity)
+            return NULL;
+        int i = hash & (capacity - 1);
+        while (table[i])
+        {
+            if (hashes[i] == hash && Equal(s, n, table[i]))
+                return table[i];
+            i = (i + 1) & (capacity - 1);
+        }
+        return NULL;
+    }
+
+    static const char *Intern(const char *s, size_t n, unsigned int hash)
+    {
+        SDL_AtomicLock(&lock);
+        if (const char *found = Find(s, n, hash))
+        {
+            SDL_AtomicUnlock(&lock);
+            return found;
+        }
+
+        if (2*(count + 1) > capacity)
+            Grow();
+
+        char *copy = Allocate(n + 1);
+        memcpy(copy, s, n);
+        copy[n] = '\0';
+
+        int i = hash & (capacity - 1);
+        while (table[i])
+            i = (i + 1) & (capacity - 1);
+        table[i] = copy;
+        hashes[i] = hash;
+        count++;
+        SDL_AtomicUnlock(&lock);
+        return copy;
+    }
+
+    static const char *Intern(const char *s)
+    {
+        size_t n = strlen(s);
+        return Intern(s, n, Hash(s, n));
+    }
+}
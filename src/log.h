@@ -1,73 +1,594 @@
 #pragma once
 #include <vector>
+#include <deque>
+#include <algorithm>
+#include <stdint.h>
 typedef int log_type_t;
 enum log_type_
 {
     log_type_group = 0,
     log_type_scalar,
-    log_type_matrix
+    log_type_matrix,
+    log_type_array // a matrix of some other element type than float (see vdbLogArray)
+};
+enum { log_type_any = -1 }; // for lookups
+
+enum log_element_
+{
+    log_float32 = 0,
+    log_float64,
+    log_int32,
+    log_int64,
+    log_uint8,
+    log_float16,
+    log_num_elements
+};
+
+vdbDataType
+    VDB_FLOAT32 = log_float32,
+    VDB_FLOAT64 = log_float64,
+    VDB_INT32   = log_int32,
+    VDB_INT64   = log_int64,
+    VDB_UINT8   = log_uint8,
+    VDB_FLOAT16 = log_float16;
+
+static int LogElementSize(int element)
+{
+    static const int size[log_num_elements] = { 4, 8, 4, 8, 1, 2 };
+    assert(element >= 0 && element < log_num_elements);
+    return size[element];
+}
+
+static const char *LogElementName(int element)
+{
+    static const char *name[log_num_elements] = { "float32", "float64", "int32", "int64", "uint8", "float16" };
+    assert(element >= 0 && element < log_num_elements);
+    return name[element];
+}
+
+static float LogHalfToFloat(uint16_t h)
+{
+    uint32_t sign = (uint32_t)(h & 0x8000) << 16;
+    uint32_t exponent = (h >> 10) & 0x1f;
+    uint32_t mantissa = h & 0x3ff;
+    uint32_t bits;
+    if (exponent == 0x1f)
+        bits = sign | 0x7f800000 | (mantissa << 13); // inf or nan
+    else if (exponent == 0)
+    {
+        float x = mantissa*(1.0f/16777216.0f); // zero or subnormal (mantissa*2^-24)
+        return sign ? -x : x;
+    }
+    else
+        bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+    float x;
+    memcpy(&x, &bits, sizeof(x));
+    return x;
+}
+
+// Min/max pyramid over the samples of a scalar log, so that plots can draw
+// any range at screen resolution without visiting every sample. Level k has
+// one (min, max) pair per VDB_LOG_PYRAMID_FACTOR^(k+1) samples. The pyramid
+// takes about 2/(VDB_LOG_PYRAMID_FACTOR-1) times the memory of the samples.
+//
+// Once a log spills (see log_spill.h), levels with buckets smaller than
+// VDB_LOG_SPILL_CHUNK samples drop the buckets over spilled samples, so they
+// only take memory in proportion to the samples in memory. Queries of spilled
+// samples at those levels are answered from the finest level that kept them.
+//
+// For a log with a history limit the buckets are over the slots of its ring
+// buffer rather than over samples, so that overwriting the oldest sample only
+// updates the buckets over that slot (see Set and QueryRing).
+struct log_pyramid_t
+{
+    enum { levels = VDB_LOG_PYRAMID_LEVELS };
+    std::deque<float> min_max[levels]; // interleaved min and max
+    int64_t dropped[levels]; // number of buckets dropped from the front
+    int64_t count; // number of samples added (including spilled ones, so it can pass 2^31)
+    unsigned int version; // of the log when a ring pyramid was last in sync with it
+
+    log_pyramid_t() : count(0), version(0) { memset(dropped, 0, sizeof(dropped)); }
+
+    int BucketSize(int level)
+    {
+        int size = VDB_LOG_PYRAMID_FACTOR;
+        for (int k = 0; k < level; k++)
+            size *= VDB_LOG_PYRAMID_FACTOR;
+        return size;
+    }
+
+    void Add(float x)
+    {
+        int64_t i = count++;
+        int size = VDB_LOG_PYRAMID_FACTOR;
+        for (int k = 0; k < levels; k++, size *= VDB_LOG_PYRAMID_FACTOR)
+        {
+            std::deque<float> &v = min_max[k];
+            int bucket = (int)(i/size - dropped[k]);
+            if (2*bucket == (int)v.size())
+            {
+                v.push_back(x);
+                v.push_back(x);
+            }
+            else
+            {
+                if (x < v[2*bucket])     v[2*bucket] = x;
+                if (x > v[2*bucket + 1]) v[2*bucket + 1] = x;
+            }
+        }
+    }
+
+    // Recomputes the buckets over slot i of a ring buffer holding the values
+    // [0, n), after the value in slot i was written. Slots are filled in order.
+    void Set(const float *values, int n, int i)
+    {
+        if (i == count)
+        {
+            Add(values[i]);
+            return;
+        }
+        int size = 1;
+        for (int k = 0; k < levels; k++)
+        {
+            // bucket i/(size*FACTOR) of level k merges items [first, end) of the level below
+            int first = i/size - (i/size) % VDB_LOG_PYRAMID_FACTOR;
+            int end = first + VDB_LOG_PYRAMID_FACTOR;
+            int below = k == 0 ? n : (int)min_max[k - 1].size()/2;
+            if (end > below)
+                end = below;
+            float lo = k == 0 ? values[first] : min_max[k - 1][2*first];
+            float hi = k == 0 ? values[first] : min_max[k - 1][2*first + 1];
+            for (int j = first + 1; j < end; j++)
+            {
+                float a = k == 0 ? values[j] : min_max[k - 1][2*j];
+                float b = k == 0 ? values[j] : min_max[k - 1][2*j + 1];
+                if (a < lo) lo = a;
+                if (b > hi) hi = b;
+            }
+            size *= VDB_LOG_PYRAMID_FACTOR;
+            int bucket = i/size;
+            min_max[k][2*bucket] = lo;
+            min_max[k][2*bucket + 1] = hi;
+        }
+    }
+
+    // Index of the first sample that the given level has buckets for
+    int64_t Covered(int level) { return dropped[level]*BucketSize(level); }
+
+    // Drops the buckets of the fine levels that only cover samples before first
+    void Drop(int64_t first)
+    {
+        int size = VDB_LOG_PYRAMID_FACTOR;
+        for (int k = 0; k < levels && size < VDB_LOG_SPILL_CHUNK; k++, size *= VDB_LOG_PYRAMID_FACTOR)
+        {
+            int n = (int)(first/size - dropped[k]);
+            if (n <= 0)
+                continue;
+            min_max[k].erase(min_max[k].begin(), min_max[k].begin() + 2*n);
+            dropped[k] += n;
+        }
+    }
+
+    // Min and max over the buckets at the given level that overlap samples
+    // [first, end), or at a coarser level if the given one dropped them
+    void Query(int level, int64_t first, int64_t end, float *min_value, float *max_value)
+    {
+        while (level + 1 < levels && first < Covered(level))
+            level++;
+        int size = BucketSize(level);
+        std::deque<float> &v = min_max[level];
+        int64_t b = first/size - dropped[level];
+        if (b < 0)
+            b = 0;
+        for (; b <= (end - 1)/size - dropped[level] && 2*b < (int64_t)v.size(); b++)
+        {
+            if (v[2*b] < *min_value)     *min_value = v[2*b];
+            if (v[2*b + 1] > *max_value) *max_value = v[2*b + 1];
+        }
+    }
+
+    // Query of the samples [first, end) (oldest first) of a ring pyramid over
+    // n slots, where the oldest sample is in slot head
+    void QueryRing(int level, int head, int n, int first, int end, float *min_value, float *max_value)
+    {
+        int slot = (head + first) % n;
+        int length = end - first;
+        if (slot + length <= n)
+        {
+            Query(level, slot, slot + length, min_value, max_value);
+        }
+        else
+        {
+            Query(level, slot, n, min_value, max_value);
+            Query(level, 0, slot + length - n, min_value, max_value);
+        }
+    }
+};
+
+// P-square estimate of a quantile (Jain and Chlamtac, 1985), which tracks
+// five markers instead of keeping the samples.
+struct log_quantile_t
+{
+    float p;
+    int64_t count;
+    float q[5]; // marker heights
+    float n[5]; // marker positions
+    float np[5]; // desired marker positions
+    float dn[5];
+
+    log_quantile_t(float p) : p(p), count(0) { }
+
+    void Add(float x)
+    {
+        if (count < 5)
+        {
+            q[count++] = x;
+            if (count == 5)
+            {
+                std::sort(q, q + 5);
+                for (int i = 0; i < 5; i++)
+                    n[i] = (float)i;
+                np[0] = 0.0f; np[1] = 2.0f*p; np[2] = 4.0f*p; np[3] = 2.0f + 2.0f*p; np[4] = 4.0f;
+                dn[0] = 0.0f; dn[1] = p/2.0f; dn[2] = p;      dn[3] = (1.0f + p)/2.0f; dn[4] = 1.0f;
+            }
+            return;
+        }
+        count++;
+
+        int k;
+        if (x < q[0])       { q[0] = x; k = 0; }
+        else if (x >= q[4]) { q[4] = x; k = 3; }
+        else                { k = 0; while (x >= q[k + 1]) k++; }
+        for (int i = k + 1; i < 5; i++)
+            n[i] += 1.0f;
+        for (int i = 0; i < 5; i++)
+            np[i] += dn[i];
+
+        // move the middle markers toward their desired positions
+        for (int i = 1; i <= 3; i++)
+        {
+            float d = np[i] - n[i];
+            if ((d >= 1.0f && n[i + 1] - n[i] > 1.0f) || (d <= -1.0f && n[i - 1] - n[i] < -1.0f))
+            {
+                int s = d > 0.0f ? 1 : -1;
+                float qp = q[i] + s/(n[i + 1] - n[i - 1])*
+                    ((n[i] - n[i - 1] + s)*(q[i + 1] - q[i])/(n[i + 1] - n[i]) +
+                     (n[i + 1] - n[i] - s)*(q[i] - q[i - 1])/(n[i] - n[i - 1]));
+                if (q[i - 1] < qp && qp < q[i + 1])
+                    q[i] = qp;
+                else
+                    q[i] = q[i] + s*(q[i + s] - q[i])/(n[i + s] - n[i]);
+                n[i] += s;
+            }
+        }
+    }
+
+    float Estimate()
+    {
+        if (count == 0)
+            return NAN;
+        if (count >= 5)
+            return q[2];
+        float sorted[4]; // insertion sort of the (at most four) samples so far
+        for (int i = 0; i < count && i < 4; i++)
+        {
+            int j = i;
+            for (; j > 0 && sorted[j - 1] > q[i]; j--)
+                sorted[j] = sorted[j - 1];
+            sorted[j] = q[i];
+        }
+        return sorted[(int)(p*(count - 1) + 0.5f)];
+    }
+};
+
+// Running aggregates of a scalar log, created when a query first asks for
+// them (see log_query.h) and updated on every append from then on. They
+// include the samples the log had at that point, but for logs with a
+// history limit, not the ones that had already been dropped. NaNs are skipped.
+struct log_stats_t
+{
+    int64_t count;
+    double sum;
+    float min, max;
+    float ema;
+    std::vector<log_quantile_t> quantiles;
+
+    log_stats_t() : count(0), sum(0.0), min(FLT_MAX), max(-FLT_MAX), ema(0.0f) { }
+
+    void Add(float x)
+    {
+        if (x != x)
+            return;
+        count++;
+        sum += x;
+        if (x < min) min = x;
+        if (x > max) max = x;
+        ema = count == 1 ? x : ema + VDB_LOG_EMA_ALPHA*(x - ema);
+        for (size_t i = 0; i < quantiles.size(); i++)
+            quantiles[i].Add(x);
+    }
 };
 
 struct log_t
 {
-    const char *label;
+    const char *label; // interned (see intern.h), or NULL for anonymous groups
+    unsigned int label_hash;
     log_t *parent;
     log_type_t type;
     std::vector<log_t*> children;
     std::vector<float> data;
     int rows, columns; // for matrix types
                        // note: matrix data is always column-major
+    int element; // for arrays, stored in their own width (padded to a whole
+                 // number of floats per sample), see LogElementSize
     int history;
+    int head; // index of the oldest sample when a bounded history is full, or a spilled log's window (data is a ring buffer)
+
+    // Samples of a log loaded from a file (see log_file.h) point into the
+    // read-only mapping of the file, and are used instead of data until the
+    // log is appended to.
+    float *mapped;
+    int mapped_count;
+
+    // Number of older samples that were moved to the spill file (see
+    // log_spill.h), and the file offsets of the chunks they were moved in.
+    int64_t spilled;
+    std::vector<uint64_t> spill_offsets;
+
+    // For scalar logs: over all samples (includes spilled ones) without a
+    // history limit, and over the ring buffer slots with one (only once plotted)
+    log_pyramid_t *pyramid;
+
+    log_stats_t *stats; // for scalar logs, see log_stats_t
+
+    // Changes whenever a sample is added. Unique across logs, so that caches
+    // keyed on it (e.g. log_heatmap_t) can't mistake one log for another.
+    unsigned int version;
+
+    // Memory given to vdbLogView that is the newest sample until the break
+    // ends, when it's copied into the slot reserved for it (logs_t::FlushView)
+    const void *view;
+
+    int SampleBytes() { return type == log_type_array ? rows*columns*LogElementSize(element) : (int)sizeof(float)*SampleSize(); }
+    int SampleSize() // in floats
+    {
+        if (type == log_type_array) return (SampleBytes() + 3)/4;
+        return type == log_type_matrix ? rows*columns : 1;
+    }
+    int NumSamples() { return mapped ? mapped_count : (int)data.size()/SampleSize(); }
+    float *Values() { return mapped ? mapped : data.data(); }
+
+    // Returns the i'th oldest sample (rows*columns values for matrices)
+    float *Sample(int i)
+    {
+        int count = NumSamples();
+        assert(i >= 0 && i < count);
+        if (view && i == count - 1)
+            return (float*)view;
+        return Values() + ((head + i) % count)*SampleSize();
+    }
+
+    // Returns element i of a sample of a matrix or array log
+    double Element(const float *sample, int i)
+    {
+        if (type != log_type_array)
+            return sample[i];
+        switch (element)
+        {
+            case log_float64: return ((const double*)sample)[i];
+            case log_int32:   return ((const int32_t*)sample)[i];
+            case log_int64:   return (double)((const int64_t*)sample)[i];
+            case log_uint8:   return ((const uint8_t*)sample)[i];
+            case log_float16: return LogHalfToFloat(((const uint16_t*)sample)[i]);
+            default:          return sample[i];
+        }
+    }
+
+    // Hash index (open addressing) over labeled children. Built once the
+    // group has more than a handful of children; small groups are scanned.
+    log_t **index;
+    int index_capacity;
+    int index_count;
+};
+
+namespace log_spill
+{
+    static float *SpillIfFull(log_t *l);
+    static void Read(log_t *l, int64_t first, int count, float *dst);
+}
+
+// Reads the samples of a log in order, including spilled samples
+struct log_reader_t
+{
+    enum { buffer_samples = 4096 };
+    log_t *l;
+    std::vector<float> buffer;
+    int64_t buffer_first;
+    int buffer_count;
+
+    log_reader_t(log_t *l) : l(l), buffer_first(0), buffer_count(0) { }
+    int64_t NumSamples() { return l->spilled + l->NumSamples(); }
+
+    float *Sample(int64_t i)
+    {
+        if (i >= l->spilled)
+            return l->Sample((int)(i - l->spilled));
+        if (i < buffer_first || i >= buffer_first + buffer_count)
+        {
+            buffer_first = i;
+            buffer_count = l->spilled - i < buffer_samples ? (int)(l->spilled - i) : (int)buffer_samples;
+            buffer.resize(buffer_count*l->SampleSize());
+            log_spill::Read(l, buffer_first, buffer_count, buffer.data());
+        }
+        return &buffer[(i - buffer_first)*l->SampleSize()];
+    }
+};
+
+// Direct-mapped cache from (group, label pointer) to the child that was
+// returned by the last lookup. String literals have a fixed address, so
+// repeated vdbLog* calls with the same literal skip the hashing. The label
+// is still compared, since the pointer may be a reused buffer.
+struct log_lookup_t
+{
+    log_t *group;
+    const char *key;
+    log_t *log;
 };
 
 struct logs_t
 {
+    enum { index_threshold = 8 };
     log_t root;
     log_t *curr;
+    unsigned int last_version;
+    unsigned int tree_version; // changes whenever logs are added or removed
+    log_lookup_t lookup_cache[VDB_LOG_LOOKUP_CACHE_SIZE];
+    std::vector<log_t*> views; // logs with a pending view
+
+    // The last sample converted by FloatSample
+    std::vector<float> float_sample;
+    log_t *float_sample_log;
+    unsigned int float_sample_version;
+    int float_sample_index;
+
     logs_t()
     {
         root.type = log_type_group;
         root.label = NULL;
         root.parent = NULL;
+        root.index = NULL;
+        root.index_capacity = 0;
+        root.index_count = 0;
+        root.mapped = NULL;
+        root.mapped_count = 0;
         curr = &root;
+        last_version = 0;
+        tree_version = 0;
+        memset(lookup_cache, 0, sizeof(lookup_cache));
+        float_sample_log = NULL;
     }
 
-    void Push(const char *label)
+    void IndexInsert(log_t *group, log_t *child)
     {
-        assert(curr);
+        assert(child->label);
+        int mask = group->index_capacity - 1;
+        int i = child->label_hash & mask;
+        while (group->index[i])
+            i = (i + 1) & mask;
+        group->index[i] = child;
+        group->index_count++;
+    }
+
+    void RebuildIndex(log_t *group, int capacity)
+    {
+        free(group->index);
+        group->index = (log_t**)calloc(capacity, sizeof(log_t*));
+        assert(group->index);
+        group->index_capacity = capacity;
+        group->index_count = 0;
+        for (size_t i = 0; i < group->children.size(); i++)
+            if (group->children[i]->label)
+                IndexInsert(group, group->children[i]);
+    }
 
-        for (size_t i = 0; i < curr->children.size(); i++)
+    // Finds the child of group with the given label (of length n) and type
+    log_t *FindChild(log_t *group, const char *label, size_t n, unsigned int hash, int type)
+    {
+        if (group->index)
         {
-            if (curr->children[i]->label &&
-                strcmp(curr->children[i]->label, label) == 0)
+            int mask = group->index_capacity - 1;
+            int i = hash & mask;
+            while (log_t *child = group->index[i])
             {
-                curr = curr->children[i];
-                return;
+                if (child->label_hash == hash &&
+                    (type == log_type_any || child->type == type) &&
+                    intern::Equal(label, n, child->label))
+                    return child;
+                i = (i + 1) & mask;
             }
+            return NULL;
+        }
+        for (size_t i = 0; i < group->children.size(); i++)
+        {
+            log_t *child = group->children[i];
+            if (child->label &&
+                child->label_hash == hash &&
+                (type == log_type_any || child->type == type) &&
+                intern::Equal(label, n, child->label))
+                return child;
         }
+        return NULL;
+    }
 
-        log_t *child = new log_t;
+    log_lookup_t *GetLookupCacheEntry(log_t *group, const char *label)
+    {
+        size_t h = ((size_t)label >> 3) ^ ((size_t)group >> 4);
+        return &lookup_cache[h & (VDB_LOG_LOOKUP_CACHE_SIZE - 1)];
+    }
+
+    log_t *AddChild(log_t *group, const char *label, log_type_t type)
+    {
+        log_t *child = new log_t();
         assert(child);
-        child->label = label;
-        child->type = log_type_group;
-        child->parent = curr;
+        if (label)
+        {
+            size_t n = strlen(label);
+            child->label_hash = intern::Hash(label, n);
+            child->label = intern::Intern(label, n, child->label_hash);
+        }
+        child->type = type;
+        child->parent = group;
+        child->version = ++last_version;
+        tree_version++;
+        group->children.push_back(child);
 
-        curr->children.push_back(child);
-        curr = child;
+        if (child->label)
+        {
+            if (group->index)
+            {
+                if (2*(group->index_count + 1) > group->index_capacity)
+                    RebuildIndex(group, 2*group->index_capacity);
+                else
+                    IndexInsert(group, child);
+            }
+            else if (group->children.size() > index_threshold)
+            {
+                RebuildIndex(group, 4*index_threshold);
+            }
+        }
+        return child;
     }
 
-    void Push()
+    // Finds or creates the child of the current group with the given label and type
+    log_t *GetChild(const char *label, log_type_t type)
     {
         assert(curr);
+        assert(label);
 
-        log_t *child = new log_t;
-        assert(child);
-        child->label = NULL;
-        child->type = log_type_group;
-        child->parent = curr;
+        log_lookup_t *entry = GetLookupCacheEntry(curr, label);
+        if (entry->group == curr && entry->key == label &&
+            entry->log->type == type && strcmp(entry->log->label, label) == 0)
+            return entry->log;
+
+        size_t n = strlen(label);
+        log_t *l = FindChild(curr, label, n, intern::Hash(label, n), type);
+        if (!l)
+            l = AddChild(curr, label, type);
+        entry->group = curr;
+        entry->key = label;
+        entry->log = l;
+        return l;
+    }
 
-        curr->children.push_back(child);
-        curr = child;
+    void Push(const char *label)
+    {
+        curr = GetChild(label, log_type_group);
+    }
+
+    void Push()
+    {
+        assert(curr);
+        curr = AddChild(curr, NULL, log_type_group);
     }
 
     void Pop()
@@ -77,186 +598,256 @@ struct logs_t
         curr = curr->parent;
     }
 
-    bool CompareUnterminatedString(const char *s1_begin, const char *s1_end, const char *s2)
+    log_t *GetLog(const char *label, log_type_t type)
     {
-        const char *c1 = s1_begin;
-        const char *c2 = s2;
-        while (c1 < s1_end && *c2)
-        {
-            if (*c1 != *c2)
-                return false;
-            c1++;
-            c2++;
-        }
-        if (c1 == s1_end && *c2 == '\0')
-            return true;
-        return false;
+        return GetChild(label, type);
     }
 
-    log_t *Find(const char *str, int *data_index)
+    // Copies the samples of a loaded log out of the file mapping so they can be modified
+    void Unmap(log_t *l)
     {
-        if (!str)
-            return NULL;
-        log_t *l = &root;
-        const char *c = str;
-        while (*c)
-        {
-            if (*c != '/')
-                return NULL;
-
-            c++;
-
-            // term is an index
-            if ((*c >= '0' && *c <= '9') || *c == '-')
-            {
-                char *end;
-                int i = strtol(c, &end, 0);
-                if (l->type == log_type_group)
-                {
-                    if (i < 0)
-                        i += (int)l->children.size();
-                    if (i < 0 || i >= (int)l->children.size())
-                        return NULL;
-                    l = l->children[i];
-                }
-                else
-                {
-                    if (i < 0)
-                        i += (int)l->data.size();
-                    if (i < 0 || i >= (int)l->data.size())
-                        return NULL;
-                    *data_index = i;
-                    return l;
-                }
-                c = end - 1;
-            }
-            // term is a label
-            else
-            {
-                const char *end = c;
-                while (*end && *end != '/')
-                    end++;
-
-                if (end == c)
-                    return NULL;
+        if (!l->mapped)
+            return;
+        l->data.assign(l->mapped, l->mapped + l->mapped_count*l->SampleSize());
+        l->mapped = NULL;
+        l->mapped_count = 0;
+    }
 
-                int match = -1;
-                for (int i = 0; i < (int)l->children.size(); i++)
-                {
-                    if (!l->children[i]->label)
-                        continue;
-                    if (CompareUnterminatedString(c, end, l->children[i]->label))
-                    {
-                        match = i;
-                        break;
-                    }
-                }
-                if (match < 0)
-                    return NULL;
-                l = l->children[match];
-                c = end - 1;
-            }
-            c++;
-        }
-        return l;
+    // Forgets samples that were moved to the spill file
+    void DropSpilled(log_t *l)
+    {
+        l->spilled = 0;
+        l->spill_offsets.clear();
     }
 
-    log_t *GetLog(const char *label, log_type_t type)
+    // Changes the history length of l, keeping the most recent samples
+    void SetHistory(log_t *l, int history)
     {
-        for (size_t i = 0; i < curr->children.size(); i++)
+        Unmap(l);
+        if (history > 0)
+            DropSpilled(l);
+        delete l->pyramid; // its buckets are over samples or slots depending on the history
+        l->pyramid = NULL;
+        int n = l->SampleSize();
+        if (l->head > 0)
         {
-            if (curr->children[i]->type == type &&
-                strcmp(curr->children[i]->label, label) == 0)
-                return curr->children[i];
+            // unroll the ring buffer so the oldest sample comes first
+            std::rotate(l->data.begin(), l->data.begin() + l->head*n, l->data.end());
+            l->head = 0;
         }
-
-        log_t *l = new log_t;
-        assert(l);
-        l->label = label;
-        l->type = type;
-        l->parent = curr;
-        curr->children.push_back(l);
-        return l;
+        int count = l->NumSamples();
+        if (history > 0 && count > history)
+            l->data.erase(l->data.begin(), l->data.begin() + (count - history)*n);
+        l->history = history;
     }
 
-    void Scalar(const char *label, float x, int history)
+    // Returns a pointer to where the next sample of l should be written.
+    // With a bounded history the oldest sample is overwritten once full, and
+    // so it is once a log spills (see log_spill::SpillIfFull).
+    float *Append(log_t *l, int history)
     {
-        log_t *l = GetLog(label, log_type_scalar);
-        l->history = history;
-        if (l->data.size() < history || history <= 0)
+        FlushView(l);
+        Unmap(l);
+        l->version = ++last_version;
+        if (history != l->history)
+            SetHistory(l, history);
+        int n = l->SampleSize();
+        if (history <= 0)
         {
-            l->data.push_back(x);
+            float *sample = log_spill::SpillIfFull(l);
+            if (sample)
+                return sample;
         }
-        else if (l->data.size() == history)
+        if (history <= 0 || l->NumSamples() < history)
         {
-            for (size_t i = 0; i < l->data.size() - 1; i++)
-                l->data[i] = l->data[i + 1];
-            l->data[l->data.size() - 1] = x;
+            l->data.resize(l->data.size() + n);
+            return &l->data[l->data.size() - n];
         }
-        else
+        float *sample = &l->data[l->head*n];
+        l->head = (l->head + 1) % history;
+        return sample;
+    }
+
+    // Adds samples to the pyramid of a scalar log that it doesn't have yet.
+    // A ring pyramid is rebuilt if the log changed since Scalar last kept it
+    // in sync (Scalar only does so once it exists, i.e. once it was plotted).
+    void UpdatePyramid(log_t *l)
+    {
+        assert(l->type == log_type_scalar);
+        if (l->history > 0)
+        {
+            if (l->pyramid && l->pyramid->version == l->version)
+                return;
+            delete l->pyramid;
+            l->pyramid = new log_pyramid_t();
+            float *values = l->Values();
+            for (int i = 0; i < l->NumSamples(); i++)
+                l->pyramid->Add(values[i]);
+            l->pyramid->version = l->version;
+            return;
+        }
+        if (!l->pyramid)
+            l->pyramid = new log_pyramid_t();
+        log_pyramid_t *p = l->pyramid;
+        if (p->count < l->spilled)
         {
-            assert(false && "Adjusting history is not handled");
+            log_reader_t reader(l);
+            while (p->count < l->spilled)
+                p->Add(*reader.Sample(p->count));
         }
+        int64_t count = l->spilled + l->NumSamples();
+        while (p->count < count)
+            p->Add(*l->Sample((int)(p->count - l->spilled)));
+        if (l->spilled > 0)
+            p->Drop(l->spilled);
     }
 
-    void Matrix(const char *label, float *x, int rows, int columns, int history)
+    void Scalar(const char *label, float x, int history)
     {
-        log_t *l = GetLog(label, log_type_matrix);
-        l->history = history;
-        l->rows = rows;
-        l->columns = columns;
-        int n = rows*columns;
-        if (l->data.size() < n*history || history <= 0)
+        log_t *l = GetLog(label, log_type_scalar);
+        unsigned int version = l->version;
+        float *sample = Append(l, history);
+        *sample = x;
+        if (history <= 0)
         {
-            for (int col = 0; col < columns; col++)
-            for (int row = 0; row < rows; row++)
-                l->data.push_back(x[row + col*rows]);
+            UpdatePyramid(l);
         }
-        else if (l->data.size() == n*history)
+        else if (l->pyramid && l->pyramid->version == version)
         {
-            for (size_t i = 0; i < l->data.size() - n; i++)
-                l->data[i] = l->data[i + n];
-            for (int col = 0; col < columns; col++)
-            for (int row = 0; row < rows; row++)
-            {
-                int i = row + col*rows;
-                l->data[l->data.size() - n + i] = x[i];
-            }
+            l->pyramid->Set(l->data.data(), l->NumSamples(), (int)(sample - l->data.data()));
+            l->pyramid->version = l->version;
         }
-        else
+        if (l->stats)
+            l->stats->Add(x);
+    }
+
+    log_stats_t *GetStats(log_t *l)
+    {
+        assert(l->type == log_type_scalar);
+        if (!l->stats)
         {
-            assert(false && "Adjusting history is not handled");
+            l->stats = new log_stats_t();
+            log_reader_t reader(l);
+            for (int64_t i = 0; i < reader.NumSamples(); i++)
+                l->stats->Add(*reader.Sample(i));
         }
+        return l->stats;
     }
 
-    void Matrix_RowMaj(const char *label, float *x, int rows, int columns, int history)
+    // Returns the estimate of the p'th quantile (0 <= p <= 1) of a scalar log
+    float GetQuantile(log_t *l, float p)
     {
-        log_t *l = GetLog(label, log_type_matrix);
-        l->history = history;
-        l->rows = rows;
-        l->columns = columns;
-        int n = rows*columns;
-        if (l->data.size() < n*history || history <= 0)
+        log_stats_t *stats = GetStats(l);
+        for (size_t i = 0; i < stats->quantiles.size(); i++)
+            if (stats->quantiles[i].p == p)
+                return stats->quantiles[i].Estimate();
+
+        log_quantile_t quantile(p);
+        log_reader_t reader(l);
+        for (int64_t i = 0; i < reader.NumSamples(); i++)
         {
-            for (int col = 0; col < columns; col++)
-            for (int row = 0; row < rows; row++)
-                l->data.push_back(x[col + row*columns]);
+            float x = *reader.Sample(i);
+            if (x == x)
+                quantile.Add(x);
         }
-        else if (l->data.size() == n*history)
+        stats->quantiles.push_back(quantile);
+        return quantile.Estimate();
+    }
+
+    log_t *GetMatrix(const char *label, int rows, int columns, log_type_t type=log_type_matrix, int element=log_float32)
+    {
+        log_t *l = GetLog(label, type);
+        if (l->rows != rows || l->columns != columns || l->element != element)
         {
-            for (size_t i = 0; i < l->data.size() - n; i++)
-                l->data[i] = l->data[i + n];
-            for (int col = 0; col < columns; col++)
-            for (int row = 0; row < rows; row++)
-            {
-                int i = col + row*columns;
-                l->data[l->data.size() - n + i] = x[i];
-            }
+            // samples of different shapes can't share a buffer
+            l->view = NULL;
+            l->data.clear();
+            l->mapped = NULL;
+            l->mapped_count = 0;
+            l->head = 0;
+            DropSpilled(l);
+            l->rows = rows;
+            l->columns = columns;
+            l->element = element;
         }
-        else
+        return l;
+    }
+
+    // Copies the pending view of l (if any) into the sample reserved for it
+    void FlushView(log_t *l)
+    {
+        if (!l->view)
+            return;
+        int count = l->NumSamples();
+        float *slot = l->data.data() + ((l->head + count - 1) % count)*l->SampleSize();
+        memcpy(slot, l->view, l->SampleBytes());
+        l->view = NULL;
+    }
+
+    void FlushViews()
+    {
+        for (size_t i = 0; i < views.size(); i++)
+            FlushView(views[i]);
+        views.clear();
+    }
+
+    // Samples of float type are stored as matrices, and other types as arrays
+    log_t *GetArray(const char *label, int element, int rows, int columns)
+    {
+        if (element == log_float32)
+            return GetMatrix(label, rows, columns);
+        return GetMatrix(label, rows, columns, log_type_array, element);
+    }
+
+    void Array(const char *label, const void *x, int element, int rows, int columns, int history)
+    {
+        log_t *l = GetArray(label, element, rows, columns);
+        memcpy(Append(l, history), x, l->SampleBytes());
+    }
+
+    // Appends a sample that refers to x until FlushViews is called
+    void View(const char *label, const void *x, int element, int rows, int columns, int history)
+    {
+        log_t *l = GetArray(label, element, rows, columns);
+        Append(l, history);
+        l->view = x;
+        views.push_back(l);
+    }
+
+    // Returns sample i of a matrix or array log as floats. Arrays are
+    // converted into a buffer that's reused by the next call.
+    float *FloatSample(log_t *l, int i)
+    {
+        if (l->type != log_type_array)
+            return l->Sample(i);
+        if (float_sample_log != l || float_sample_version != l->version || float_sample_index != i)
         {
-            assert(false && "Adjusting history is not handled");
+            int n = l->rows*l->columns;
+            float *sample = l->Sample(i);
+            float_sample.resize(n);
+            for (int j = 0; j < n; j++)
+                float_sample[j] = (float)l->Element(sample, j);
+            float_sample_log = l;
+            float_sample_version = l->version;
+            float_sample_index = i;
         }
+        return float_sample.data();
+    }
+
+    void Matrix(const char *label, float *x, int rows, int columns, int history)
+    {
+        log_t *l = GetMatrix(label, rows, columns);
+        float *dst = Append(l, history);
+        memcpy(dst, x, rows*columns*sizeof(float));
+    }
+
+    void Matrix_RowMaj(const char *label, float *x, int rows, int columns, int history)
+    {
+        log_t *l = GetMatrix(label, rows, columns);
+        float *dst = Append(l, history);
+        for (int col = 0; col < columns; col++)
+        for (int row = 0; row < rows; row++)
+            dst[row + col*rows] = x[col + row*columns];
     }
 
     void Vector(const char *label, float *x, int elements, int history)
@@ -283,10 +874,10 @@ struct logs_t
             }
             indent
             fprintf(f, open);
-            _Dump(f, l->children[0], indent_level + 1);
-            for (size_t i = 1; i < l->children.size(); i++)
+            for (size_t i = 0; i < l->children.size(); i++)
             {
-                fprintf(f, ",\n");
+                if (i > 0)
+                    fprintf(f, ",\n");
                 _Dump(f, l->children[i], indent_level + 1);
             }
             fprintf(f, "\n");
@@ -295,47 +886,50 @@ struct logs_t
         }
         else
         {
+            log_reader_t reader(l);
             if (l->type == log_type_scalar)
             {
                 indent
                 fprintf(f, "\"%s\": ", l->label);
-                if (l->data.size() == 1)
+                int64_t count = reader.NumSamples();
+                if (count == 1)
                 {
-                    fprintf(f, "%g", l->data[0]);
+                    fprintf(f, "%g", *reader.Sample(0));
                 }
                 else
                 {
-                    fprintf(f, "[%g", l->data[0]);
-                    for (size_t i = 1; i < l->data.size(); i++)
-                        fprintf(f, ", %g", l->data[i]);
+                    fprintf(f, "[%g", *reader.Sample(0));
+                    for (int64_t i = 1; i < count; i++)
+                        fprintf(f, ", %g", *reader.Sample(i));
                     fprintf(f, "]");
                 }
             }
-            else if (l->type == log_type_matrix)
+            else if (l->type == log_type_matrix || l->type == log_type_array)
             {
+                // doubles and 64-bit integers need more digits
+                const char *format = l->type == log_type_array ? ", %.17g" : ", %g";
                 int n = l->rows*l->columns;
-                size_t count = l->data.size() / n;
+                int64_t count = reader.NumSamples();
                 indent
                 fprintf(f, "\"%s\": ", l->label);
                 if (count == 1)
                 {
-                    fprintf(f, "[%g", l->data[0]);
+                    float *data = reader.Sample(0);
+                    fprintf(f, "[");
+                    fprintf(f, format + 2, l->Element(data, 0));
                     for (int i = 1; i < n; i++)
-                        fprintf(f, ", %g", l->data[i]);
+                        fprintf(f, format, l->Element(data, i));
                     fprintf(f, "]");
                 }
                 else
                 {
-                    size_t j = 0;
-                    fprintf(f, "[[%g", l->data[j++]);
-                    for (int i = 1; i < n; i++)
-                        fprintf(f, ", %g", l->data[j++]);
-                    fprintf(f, "]");
-                    for (size_t i = 1; i < count; i++)
+                    for (int64_t j = 0; j < count; j++)
                     {
-                        fprintf(f, ", [%g", l->data[j++]);
+                        float *data = reader.Sample(j);
+                        fprintf(f, j == 0 ? "[[" : ", [");
+                        fprintf(f, format + 2, l->Element(data, 0));
                         for (int i = 1; i < n; i++)
-                            fprintf(f, ", %g", l->data[j++]);
+                            fprintf(f, format, l->Element(data, i));
                         fprintf(f, "]");
                     }
                     fprintf(f, "]");
@@ -347,18 +941,16 @@ struct logs_t
 
     void Dump(const char *filename)
     {
+        FlushViews(); // as in log_file::Write; a pending view would keep reading x after the dump
         FILE *f = fopen(filename, "w+");
+        if (!f)
+        {
+            fprintf(stderr, "Failed to open %s for writing\n", filename);
+            return;
+        }
         _Dump(f, &root, 0);
+        fclose(f);
     }
 };
 
 static logs_t logs;
-
-void vdbLogPush(const char *label) { logs.Push(label); }
-void vdbLogPush() { logs.Push(); }
-void vdbLogPop() { logs.Pop(); }
-void vdbLogScalar(const char *label, float x, int history) { logs.Scalar(label, x, history); }
-void vdbLogMatrix(const char *label, float *x, int rows, int columns, int history) { logs.Matrix(label, x, rows, columns, history); }
-void vdbLogMatrix_RowMaj(const char *label, float *x, int rows, int columns, int history) { logs.Matrix_RowMaj(label, x, rows, columns, history); }
-void vdbLogVector(const char *label, float *x, int elements, int history) { logs.Vector(label, x, elements, history); }
-void vdbLogDump(const char *filename) { logs.Dump(filename); }
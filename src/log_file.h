@@ -0,0 +1,371 @@
+// Binary log files (vdbLogSave/vdbLogLoad). Unlike vdbLogDump, the samples
+// of each log are stored as one contiguous array of raw floats, so saving is
+// a single fwrite per log and loading a file maps it into memory and points
+// the logs at the mapping without parsing or copying anything.
+//
+// Layout (native byte order, checked on load):
+//     log_file_header_t
+//     sample arrays, each aligned to 16 bytes, oldest sample first
+//     one log_file_entry_t per log in depth-first order, each followed by
+//     its label (zero-terminated) and padded to 8 bytes
+// The path of a log is given by its chain of parent entries.
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+#include <stdint.h>
+
+struct log_file_header_t
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint32_t num_entries;
+    uint32_t reserved;
+    uint64_t entries_offset;
+};
+
+struct log_file_entry_t
+{
+    int32_t parent; // index of the parent entry, or -1
+    int32_t type;
+    int32_t rows, columns;
+    int32_t history;
+    int32_t element; // of arrays
+    int64_t count; // number of samples (spilled logs can have more than 2^31)
+    uint64_t data_offset;
+    uint32_t label_size; // including the terminating zero, or 0 for anonymous groups
+    uint32_t entry_size; // including the label and padding
+};
+
+namespace log_file
+{
+    static const char magic[8] = { 'v','d','b','l','o','g',0,0 };
+    enum { version = 3, byte_order = 0x01020304 };
+
+    struct mapping_t
+    {
+        log_t *group;
+        void *base;
+        size_t size;
+    };
+    static std::vector<mapping_t> mappings;
+
+    struct writer_t
+    {
+        FILE *f;
+        uint64_t offset;
+        std::vector<log_file_entry_t> entries;
+        std::vector<log_t*> entry_logs;
+
+        void Write(const void *data, size_t size)
+        {
+            fwrite(data, 1, size, f);
+            offset += size;
+        }
+
+        void Align(size_t alignment)
+        {
+            static const char zeros[16] = {0};
+            size_t padding = (size_t)((alignment - offset % alignment) % alignment);
+            Write(zeros, padding);
+        }
+
+        void WriteLog(log_t *l, int parent)
+        {
+            log_file_entry_t e;
+            memset(&e, 0, sizeof(e));
+            e.parent = parent;
+            e.type = l->type;
+            e.rows = l->rows;
+            e.columns = l->columns;
+            e.history = l->history;
+            e.element = l->element;
+            e.label_size = l->label ? (uint32_t)strlen(l->label) + 1 : 0;
+            if (l->type != log_type_group)
+            {
+                e.count = l->spilled + l->NumSamples();
+                Align(16);
+                e.data_offset = offset;
+                size_t n = l->SampleSize(); // in floats, also for arrays
+                if (l->spilled > 0)
+                {
+                    log_reader_t reader(l);
+                    for (int64_t i = 0; i < l->spilled; i += reader.buffer_count)
+                    {
+                        float *samples = reader.Sample(i); // reads up to buffer_samples samples
+                        Write(samples, reader.buffer_count*n*sizeof(float));
+                    }
+                }
+                float *values = l->Values();
+                if (l->head > 0)
+                {
+                    // linearize the ring buffer
+                    Write(values + l->head*n, (l->NumSamples() - l->head)*n*sizeof(float));
+                    Write(values, l->head*n*sizeof(float));
+                }
+                else
+                {
+                    Write(values, l->NumSamples()*n*sizeof(float));
+                }
+            }
+            int index = (int)entries.size();
+            entries.push_back(e);
+            entry_logs.push_back(l);
+            for (size_t i = 0; i < l->children.size(); i++)
+                WriteLog(l->children[i], index);
+        }
+    };
+
+    // Writes the log tree at the end of f, which is at offset start, with offsets
+    // relative to start (trace files embed a log file this way, see trace.h)
+    static uint64_t Write(FILE *f, uint64_t start)
+    {
+        logs.FlushViews();
+
+        writer_t w;
+        w.f = f;
+        w.offset = 0;
+
+        log_file_header_t header;
+        memset(&header, 0, sizeof(header));
+        w.Write(&header, sizeof(header)); // filled in at the end
+
+        for (size_t i = 0; i < logs.root.children.size(); i++)
+            w.WriteLog(logs.root.children[i], -1);
+
+        w.Align(8);
+        header.entries_offset = w.offset;
+        for (size_t i = 0; i < w.entries.size(); i++)
+        {
+            log_file_entry_t &e = w.entries[i];
+            e.entry_size = (uint32_t)((sizeof(e) + e.label_size + 7) & ~7);
+            w.Write(&e, sizeof(e));
+            if (e.label_size)
+                w.Write(w.entry_logs[i]->label, e.label_size);
+            w.Align(8);
+        }
+
+        memcpy(header.magic, magic, sizeof(magic));
+        header.version = version;
+        header.byte_order = byte_order;
+        header.num_entries = (uint32_t)w.entries.size();
+        log_spill::Seek(f, start);
+        fwrite(&header, sizeof(header), 1, f);
+        log_spill::Seek(f, start + w.offset);
+        return w.offset;
+    }
+
+    static bool Save(const char *filename)
+    {
+        FILE *f = fopen(filename, "wb");
+        if (!f)
+        {
+            fprintf(stderr, "Failed to open %s for writing\n", filename);
+            return false;
+        }
+        Write(f, 0);
+        bool ok = !ferror(f);
+        fclose(f);
+        if (!ok)
+            fprintf(stderr, "Failed to write %s\n", filename);
+        return ok;
+    }
+
+    static void *Map(const char *filename, size_t *size)
+    {
+        #ifdef _WIN32
+        HANDLE file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+        if (file == INVALID_HANDLE_VALUE)
+            return NULL;
+        LARGE_INTEGER file_size;
+        if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart < (LONGLONG)sizeof(log_file_header_t))
+        {
+            CloseHandle(file);
+            return NULL;
+        }
+        HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+        void *base = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : NULL;
+        if (mapping) CloseHandle(mapping); // the view keeps the mapping alive
+        CloseHandle(file);
+        *size = (size_t)file_size.QuadPart;
+        return base;
+        #else
+        int fd = open(filename, O_RDONLY);
+        if (fd < 0)
+            return NULL;
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(log_file_header_t))
+        {
+            close(fd);
+            return NULL;
+        }
+        void *base = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (base == MAP_FAILED)
+            return NULL;
+        *size = (size_t)st.st_size;
+        return base;
+        #endif
+    }
+
+    static void Unmap(void *base, size_t size)
+    {
+        #ifdef _WIN32
+        (void)size;
+        UnmapViewOfFile(base);
+        #else
+        munmap(base, size);
+        #endif
+    }
+
+    static bool IsInside(log_t *l, log_t *group)
+    {
+        for (; l; l = l->parent)
+            if (l == group)
+                return true;
+        return false;
+    }
+
+    static void FreeChildren(log_t *group)
+    {
+        for (size_t i = 0; i < group->children.size(); i++)
+        {
+            log_t *child = group->children[i];
+            FreeChildren(child);
+            delete child->pyramid;
+            delete child->stats;
+            delete child;
+        }
+        group->children.clear();
+        free(group->index);
+        group->index = NULL;
+        group->index_capacity = 0;
+        group->index_count = 0;
+    }
+
+    // Removes the contents of a group that a file was previously loaded into
+    static void Clear(log_t *group)
+    {
+        if (IsInside(logs.curr, group))
+            logs.curr = group;
+        for (log_stream::stream_t *s = log_stream::streams.load(); s; s = s->next_stream)
+            if (IsInside(s->cursor, group))
+                s->cursor = group;
+        FreeChildren(group);
+        logs.tree_version++;
+        memset(logs.lookup_cache, 0, sizeof(logs.lookup_cache));
+        for (size_t i = 0; i < mappings.size(); i++)
+        {
+            if (mappings[i].group == group)
+            {
+                Unmap(mappings[i].base, mappings[i].size);
+                mappings.erase(mappings.begin() + i);
+                break;
+            }
+        }
+    }
+
+    // Maps the log file that starts at the given offset of a file into the group /label
+    static bool Load(const char *filename, const char *label, uint64_t start = 0)
+    {
+        size_t mapped_size = 0;
+        char *mapped = (char*)Map(filename, &mapped_size);
+        if (!mapped)
+        {
+            fprintf(stderr, "Failed to open log file %s\n", filename);
+            return false;
+        }
+
+        #define CHECK(cond) if (!(cond)) { fprintf(stderr, "Invalid log file %s\n", filename); Unmap(mapped, mapped_size); return false; }
+
+        CHECK(start % 16 == 0 && start + sizeof(log_file_header_t) <= mapped_size);
+        char *base = mapped + start;
+        size_t size = mapped_size - (size_t)start;
+
+        log_file_header_t *header = (log_file_header_t*)base;
+        CHECK(memcmp(header->magic, magic, sizeof(magic)) == 0);
+        CHECK(header->version == version);
+        CHECK(header->byte_order == byte_order);
+        CHECK(header->entries_offset <= size);
+
+        // validate everything before touching the log tree
+        std::vector<int32_t> types(header->num_entries);
+        uint64_t offset = header->entries_offset;
+        for (uint32_t i = 0; i < header->num_entries; i++)
+        {
+            CHECK(offset + sizeof(log_file_entry_t) <= size);
+            log_file_entry_t *e = (log_file_entry_t*)(base + offset);
+            CHECK(e->entry_size >= sizeof(log_file_entry_t) + e->label_size && offset + e->entry_size <= size);
+            CHECK(e->parent >= -1 && e->parent < (int32_t)i);
+            CHECK(e->parent == -1 || types[e->parent] == log_type_group);
+            CHECK(e->type == log_type_group || e->type == log_type_scalar || e->type == log_type_matrix || e->type == log_type_array);
+            if (e->label_size)
+                CHECK(base[offset + sizeof(log_file_entry_t) + e->label_size - 1] == '\0');
+            if (e->type != log_type_group)
+            {
+                CHECK(e->label_size > 0);
+                CHECK(e->rows >= 0 && e->columns >= 0 && e->count >= 0);
+                CHECK(e->count <= INT_MAX); // loaded samples are all in memory, where they are counted with an int
+                CHECK(e->type != log_type_array || (e->element > log_float32 && e->element < log_num_elements));
+                uint64_t n = e->type == log_type_scalar ? 1 : (uint64_t)e->rows*(uint64_t)e->columns;
+                if (e->type == log_type_array)
+                    n = (n*LogElementSize(e->element) + 3)/4;
+                CHECK(e->data_offset % 4 == 0 && e->data_offset + n*e->count*sizeof(float) <= size);
+            }
+            types[i] = e->type;
+            offset += e->entry_size;
+        }
+
+        #undef CHECK
+
+        logs.FlushViews(); // Clear may delete logs with pending views
+        log_t *group = logs.FindChild(&logs.root, label, strlen(label), intern::Hash(label), log_type_group);
+        if (group)
+            Clear(group);
+        else
+            group = logs.AddChild(&logs.root, label, log_type_group);
+
+        std::vector<log_t*> nodes(header->num_entries);
+        offset = header->entries_offset;
+        for (uint32_t i = 0; i < header->num_entries; i++)
+        {
+            log_file_entry_t *e = (log_file_entry_t*)(base + offset);
+            log_t *parent = e->parent >= 0 ? nodes[e->parent] : group;
+            const char *child_label = e->label_size ? base + offset + sizeof(log_file_entry_t) : NULL;
+            log_t *l = logs.AddChild(parent, child_label, e->type);
+            l->rows = e->rows;
+            l->columns = e->columns;
+            l->history = e->history;
+            l->element = e->type == log_type_array ? e->element : log_float32;
+            if (e->type != log_type_group && e->count > 0)
+            {
+                l->mapped = (float*)(base + e->data_offset);
+                l->mapped_count = (int)e->count;
+            }
+            nodes[i] = l;
+            offset += e->entry_size;
+        }
+
+        mapping_t mapping = { group, mapped, mapped_size };
+        mappings.push_back(mapping);
+        return true;
+    }
+}
+
+bool vdbLogSave(const char *filename)
+{
+    log_stream::TakeOwnershipIfNone();
+    return log_file::Save(filename);
+}
+
+bool vdbLogLoad(const char *filename, const char *label)
+{
+    // like vdbBeginBreak, this makes the calling thread the owner of the log tree
+    log_stream::TakeOwnership();
+    return log_file::Load(filename, label);
+}
@@ -0,0 +1,125 @@
+// Heatmaps of matrix logs (see ui::ShowLogWindow). The matrix is uploaded to
+// a single-channel float texture and colormapped into an RGBA texture with
+// the image shader (the same path as vdbDrawImage), which ImGui then draws
+// as a single quad. This is only redone when the log changes version, or
+// when a different sample or colormap is shown.
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define VDB_LOG_HEATMAP_SSE
+#endif
+
+struct log_heatmap_t
+{
+    log_t *log;
+    unsigned int version;
+    int sample;
+    vdbColormapData *cmap;
+
+    int rows, columns;
+    GLuint data; // width = rows and height = columns, since the matrix is column-major
+    framebuffer_t colors; // same layout as data
+    float min_value, max_value;
+};
+
+namespace log_heatmap
+{
+    // Min and max of the values in x, ignoring NaNs (min_value > max_value if all are NaN)
+    static void MinMax(const float *x, int n, float *min_value, float *max_value)
+    {
+        float lo = FLT_MAX;
+        float hi = -FLT_MAX;
+        int i = 0;
+        #ifdef VDB_LOG_HEATMAP_SSE
+        if (n >= 4)
+        {
+            // _mm_min_ps(a,b) returns b if a is NaN
+            __m128 lo4 = _mm_set1_ps(FLT_MAX);
+            __m128 hi4 = _mm_set1_ps(-FLT_MAX);
+            for (; i + 4 <= n; i += 4)
+            {
+                __m128 x4 = _mm_loadu_ps(x + i);
+                lo4 = _mm_min_ps(x4, lo4);
+                hi4 = _mm_max_ps(x4, hi4);
+            }
+            float lo_lanes[4], hi_lanes[4];
+            _mm_storeu_ps(lo_lanes, lo4);
+            _mm_storeu_ps(hi_lanes, hi4);
+            for (int j = 0; j < 4; j++)
+            {
+                if (lo_lanes[j] < lo) lo = lo_lanes[j];
+                if (hi_lanes[j] > hi) hi = hi_lanes[j];
+            }
+        }
+        #endif
+        for (; i < n; i++)
+        {
+            if (x[i] < lo) lo = x[i];
+            if (x[i] > hi) hi = x[i];
+        }
+        *min_value = lo;
+        *max_value = hi;
+    }
+
+    static void Free(log_heatmap_t *h)
+    {
+        if (h->data)
+            glDeleteTextures(1, &h->data);
+        FreeFramebuffer(&h->colors);
+        h->data = 0;
+        h->log = NULL;
+    }
+
+    // Returns false if the matrix doesn't fit in a texture
+    static bool Update(log_heatmap_t *h, log_t *l, int sample)
+    {
+        vdbColormapData *cmap = colormap::GetColormapData();
+        if (h->data && h->log == l && h->version == l->version && h->sample == sample && h->cmap == cmap)
+            return true;
+
+        static GLint max_size = 0;
+        if (!max_size)
+            glGetIntegerv(GL_MAX_TEXTURE_SIZE, &max_size);
+        if (l->rows > max_size || l->columns > max_size)
+            return false;
+
+        float *x = logs.FloatSample(l, sample);
+        MinMax(x, l->rows*l->columns, &h->min_value, &h->max_value);
+
+        if (!h->data || h->rows != l->rows || h->columns != l->columns)
+        {
+            Free(h);
+            h->rows = l->rows;
+            h->columns = l->columns;
+            h->data = TexImage2D(x, h->rows, h->columns, GL_RED, GL_FLOAT,
+                GL_NEAREST, GL_NEAREST, GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE, GL_R32F);
+            h->colors = MakeFramebuffer(h->rows, h->columns, GL_NEAREST, GL_NEAREST);
+        }
+        else
+        {
+            glBindTexture(GL_TEXTURE_2D, h->data);
+            glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, h->rows, h->columns, GL_RED, GL_FLOAT, x);
+            glBindTexture(GL_TEXTURE_2D, 0);
+        }
+
+        float v_min = h->min_value;
+        float v_max = h->max_value;
+        if (!(v_max > v_min)) // constant or all NaN
+        {
+            v_min = h->min_value <= h->max_value ? h->min_value : 0.0f;
+            v_max = v_min + 1.0f;
+        }
+
+        static float identity[4*4] = { 1,0,0,0, 0,1,0,0, 0,0,1,0, 0,0,0,1 };
+        EnableFramebuffer(&h->colors);
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, h->data);
+        DrawImageQuad(true, identity, -1.0f, -1.0f, 2.0f, 2.0f, vdbVec4(v_min), vdbVec4(v_max));
+        DisableFramebuffer(&h->colors);
+
+        h->log = l;
+        h->version = l->version;
+        h->sample = sample;
+        h->cmap = cmap;
+        return true;
+    }
+}
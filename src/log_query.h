@@ -0,0 +1,313 @@
+// Log queries select logs by path, e.g. /iter/3/loss, and are what the log
+// windows show. A query is parsed once into a list of steps, and resolved
+// into the logs it matches only when the query text or the log tree changes
+// (logs_t::tree_version), rather than every frame.
+//
+// Each step is one of
+//     label     a child with that label
+//     3, -1     a child by index (negative counts from the end), or for the
+//               last step, a sample of a scalar or matrix log
+//     *         all children
+//     a:b       children a up to (not including) b, where either may be
+//               left out or negative, e.g. -100: for the last 100
+// and the query may end with an aggregate over each matched scalar log:
+//     @count @mean @min @max @ema @p50 @p90 @p99 (any percentile)
+// Aggregates are maintained incrementally as samples are appended (see
+// log_stats_t), so showing them for thousands of logs doesn't rescan them.
+enum log_query_step_type_t
+{
+    log_query_label = 0,
+    log_query_index,
+    log_query_all,
+    log_query_range
+};
+
+enum log_aggregate_t
+{
+    log_aggregate_none = 0,
+    log_aggregate_count,
+    log_aggregate_mean,
+    log_aggregate_min,
+    log_aggregate_max,
+    log_aggregate_ema,
+    log_aggregate_quantile
+};
+
+struct log_query_step_t
+{
+    log_query_step_type_t type;
+    const char *label; // points into log_query_t::text
+    size_t label_length;
+    unsigned int label_hash;
+    int index; // or the start of a range
+    int end;
+    bool has_index, has_end; // for ranges
+};
+
+struct log_match_t
+{
+    log_t *log;
+    int sample; // index given for a sample (may be negative), or INT_MIN
+    int path; // offset of the path in log_query_t::paths
+};
+
+struct log_query_t
+{
+    char source[1024]; // as given
+    char text[1024]; // the steps' labels point into this
+    bool compiled;
+    bool valid;
+    std::vector<log_query_step_t> steps;
+    log_aggregate_t aggregate;
+    float quantile;
+
+    unsigned int tree_version; // when matches were resolved
+    std::vector<log_match_t> matches;
+    std::vector<char> paths;
+};
+
+namespace log_query
+{
+    static bool ParseInt(const char **c, int *x)
+    {
+        char *end;
+        long value = strtol(*c, &end, 10);
+        if (end == *c)
+            return false;
+        *x = (int)value;
+        *c = end;
+        return true;
+    }
+
+    static bool ParseStep(log_query_step_t *step, const char *begin, const char *end)
+    {
+        memset(step, 0, sizeof(*step));
+        if (begin == end)
+            return false;
+        if (end - begin == 1 && *begin == '*')
+        {
+            step->type = log_query_all;
+            return true;
+        }
+        if ((*begin >= '0' && *begin <= '9') || *begin == '-' || *begin == ':')
+        {
+            const char *c = begin;
+            step->has_index = ParseInt(&c, &step->index);
+            if (c == end && step->has_index)
+            {
+                step->type = log_query_index;
+                return true;
+            }
+            if (*c != ':')
+                return false;
+            c++;
+            step->has_end = c < end && ParseInt(&c, &step->end);
+            step->type = log_query_range;
+            return c == end;
+        }
+        step->type = log_query_label;
+        step->label = begin;
+        step->label_length = end - begin;
+        step->label_hash = intern::Hash(begin, end - begin);
+        return true;
+    }
+
+    static bool ParseAggregate(log_query_t *q, const char *name)
+    {
+        q->quantile = 0.0f;
+        if      (strcmp(name, "count") == 0) q->aggregate = log_aggregate_count;
+        else if (strcmp(name, "mean") == 0)  q->aggregate = log_aggregate_mean;
+        else if (strcmp(name, "min") == 0)   q->aggregate = log_aggregate_min;
+        else if (strcmp(name, "max") == 0)   q->aggregate = log_aggregate_max;
+        else if (strcmp(name, "ema") == 0)   q->aggregate = log_aggregate_ema;
+        else if (name[0] == 'p')
+        {
+            char *end;
+            float percent = strtof(name + 1, &end);
+            if (end == name + 1 || *end || percent < 0.0f || percent > 100.0f)
+                return false;
+            q->aggregate = log_aggregate_quantile;
+            q->quantile = percent/100.0f;
+        }
+        else
+            return false;
+        return true;
+    }
+
+    static void Compile(log_query_t *q, const char *text)
+    {
+        ImStrncpy(q->source, text, sizeof(q->source));
+        strcpy(q->text, q->source);
+        q->compiled = true;
+        q->steps.clear();
+        q->aggregate = log_aggregate_none;
+        q->tree_version = logs.tree_version - 1; // resolve on next Update
+        q->valid = true;
+
+        char *at = strrchr(q->text, '@');
+        if (at)
+        {
+            *at = '\0'; // the steps end here
+            q->valid = ParseAggregate(q, at + 1);
+        }
+
+        // note: the empty query matches the root, like a path with no steps
+        const char *c = q->text;
+        while (*c && q->valid)
+        {
+            if (*c != '/')
+            {
+                q->valid = false;
+                break;
+            }
+            c++;
+            const char *end = c;
+            while (*end && *end != '/')
+                end++;
+            log_query_step_t step;
+            q->valid = ParseStep(&step, c, end);
+            q->steps.push_back(step);
+            c = end;
+        }
+    }
+
+    // Adds a match whose path is the path of its parent followed by name
+    static void AddMatch(log_query_t *q, std::vector<log_match_t> &matches, log_t *l, int sample, int parent_path, const char *name)
+    {
+        log_match_t m;
+        m.log = l;
+        m.sample = sample;
+        m.path = (int)q->paths.size();
+        matches.push_back(m);
+
+        const char *parent = parent_path >= 0 ? &q->paths[parent_path] : "";
+        size_t parent_length = strlen(parent);
+        size_t name_length = strlen(name);
+        q->paths.resize(q->paths.size() + parent_length + 1 + name_length + 1);
+        char *path = &q->paths[m.path];
+        parent = parent_path >= 0 ? &q->paths[parent_path] : ""; // paths may have moved
+        memcpy(path, parent, parent_length);
+        path[parent_length] = '/';
+        memcpy(path + parent_length + 1, name, name_length + 1);
+    }
+
+    static void AddChild(log_query_t *q, std::vector<log_match_t> &matches, log_t *group, int index, int parent_path)
+    {
+        log_t *child = group->children[index];
+        char name[16];
+        if (!child->label)
+            sprintf(name, "%d", index);
+        AddMatch(q, matches, child, INT_MIN, parent_path, child->label ? child->label : name);
+    }
+
+    static void Resolve(log_query_t *q)
+    {
+        q->tree_version = logs.tree_version;
+        q->matches.clear();
+        q->paths.clear();
+        if (!q->valid)
+            return;
+
+        std::vector<log_match_t> current;
+        std::vector<log_match_t> next;
+        log_match_t root = { &logs.root, INT_MIN, -1 };
+        current.push_back(root);
+        for (size_t s = 0; s < q->steps.size(); s++)
+        {
+            log_query_step_t &step = q->steps[s];
+            bool is_last = s + 1 == q->steps.size();
+            next.clear();
+            for (size_t j = 0; j < current.size(); j++)
+            {
+                log_t *l = current[j].log;
+                int path = current[j].path;
+                if (current[j].sample != INT_MIN)
+                    continue;
+                int n = (int)l->children.size();
+                if (l->type != log_type_group)
+                {
+                    // indexing into samples is resolved when the value is read (see Sample)
+                    if (is_last && step.type == log_query_index)
+                    {
+                        char name[16];
+                        sprintf(name, "%d", step.index);
+                        AddMatch(q, next, l, step.index, path, name);
+                    }
+                    continue;
+                }
+                if (step.type == log_query_label)
+                {
+                    log_t *child = logs.FindChild(l, step.label, step.label_length, step.label_hash, log_type_any);
+                    if (child)
+                        AddMatch(q, next, child, INT_MIN, path, child->label);
+                }
+                else if (step.type == log_query_index)
+                {
+                    int i = step.index < 0 ? step.index + n : step.index;
+                    if (i >= 0 && i < n)
+                        AddChild(q, next, l, i, path);
+                }
+                else
+                {
+                    int first = 0;
+                    int end = n;
+                    if (step.type == log_query_range)
+                    {
+                        if (step.has_index) first = step.index < 0 ? step.index + n : step.index;
+                        if (step.has_end)   end = step.end < 0 ? step.end + n : step.end;
+                        if (first < 0) first = 0;
+                        if (end > n) end = n;
+                    }
+                    for (int i = first; i < end; i++)
+                        AddChild(q, next, l, i, path);
+                }
+            }
+            current.swap(next);
+        }
+        q->matches = current;
+    }
+
+    // Recompiles and resolves the query if needed
+    static void Update(log_query_t *q, const char *text)
+    {
+        if (!q->compiled || strcmp(q->source, text) != 0)
+            Compile(q, text);
+        if (q->tree_version != logs.tree_version)
+            Resolve(q);
+    }
+
+    static const char *Path(log_query_t *q, log_match_t *m)
+    {
+        return m->path >= 0 ? &q->paths[m->path] : "/";
+    }
+
+    // Returns the sample index of a match into a scalar or matrix log, or -1
+    static int Sample(log_match_t *m)
+    {
+        if (m->sample == INT_MIN)
+            return -1;
+        int count = m->log->NumSamples();
+        int i = m->sample < 0 ? m->sample + count : m->sample;
+        return i >= 0 && i < count ? i : -2; // -2: out of range
+    }
+
+    // Returns the aggregate of a scalar log, or NAN
+    static float Aggregate(log_query_t *q, log_t *l)
+    {
+        if (l->type != log_type_scalar)
+            return NAN;
+        log_stats_t *stats = logs.GetStats(l);
+        if (stats->count == 0)
+            return NAN;
+        switch (q->aggregate)
+        {
+            case log_aggregate_count:    return (float)stats->count;
+            case log_aggregate_mean:     return (float)(stats->sum/stats->count);
+            case log_aggregate_min:      return stats->min;
+            case log_aggregate_max:      return stats->max;
+            case log_aggregate_ema:      return stats->ema;
+            case log_aggregate_quantile: return logs.GetQuantile(l, q->quantile);
+            default:                     return NAN;
+        }
+    }
+}
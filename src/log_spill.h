@@ -0,0 +1,236 @@
+// Logs without a history limit keep every sample, so a long-running program
+// eventually runs out of memory. With vdbLogSpill, once such a log has more
+// than a window of values in memory (VDB_LOG_SPILL_WINDOW unless given to
+// vdbLogSpill), its oldest values are moved to
+// a file in chunks of VDB_LOG_SPILL_CHUNK values. The samples in memory are
+// then a ring buffer, so spilling doesn't move them. The file is written on
+// a background thread; chunks are queued until written, and the queue is
+// bounded, so logging only waits on the disk if the disk can't keep up.
+//
+// A spilled log keeps the file offset of each chunk (log_t::spill_offsets).
+// Its spilled samples come before the samples in memory, and are read back
+// on demand (Read), e.g. when a log window is scrolled back in time.
+namespace log_spill
+{
+    struct job_t
+    {
+        uint64_t offset;
+        size_t size;
+        float *data;
+    };
+
+    static FILE *write_file;
+    static FILE *read_file;
+    static uint64_t file_end; // offset of the next chunk
+    static SDL_Thread *thread;
+    static SDL_mutex *mutex;
+    static SDL_cond *work;
+    static SDL_cond *done;
+    static std::vector<job_t> queue; // the front is being written
+    static size_t queued_bytes;
+    static bool write_error;
+    static int window = VDB_LOG_SPILL_WINDOW; // values, fixed once spilling starts
+
+    static void Seek(FILE *f, uint64_t offset)
+    {
+        #ifdef _WIN32
+        _fseeki64(f, (__int64)offset, SEEK_SET);
+        #else
+        fseeko(f, (off_t)offset, SEEK_SET);
+        #endif
+    }
+
+    static int WriterThread(void *)
+    {
+        SDL_LockMutex(mutex);
+        for (;;)
+        {
+            while (queue.empty())
+                SDL_CondWait(work, mutex);
+
+            // the job stays in the queue while it's written, so Read can find it
+            job_t job = queue.front();
+            SDL_UnlockMutex(mutex);
+            bool ok = fwrite(job.data, 1, job.size, write_file) == job.size;
+            ok = fflush(write_file) == 0 && ok;
+            SDL_LockMutex(mutex);
+
+            if (!ok && !write_error)
+            {
+                fprintf(stderr, "Failed to write to log spill file\n");
+                write_error = true;
+            }
+            queue.erase(queue.begin());
+            queued_bytes -= job.size;
+            free(job.data);
+            SDL_CondBroadcast(done);
+        }
+        return 0;
+    }
+
+    // Waits until the queued chunks are written (at exit, since the writer
+    // thread doesn't outlive the program)
+    static void Flush()
+    {
+        if (!thread)
+            return;
+        SDL_LockMutex(mutex);
+        while (!queue.empty())
+            SDL_CondWait(done, mutex);
+        SDL_UnlockMutex(mutex);
+    }
+
+    static bool Open(const char *filename, int window_values)
+    {
+        if (write_file)
+        {
+            fprintf(stderr, "vdbLogSpill was already called, ignoring %s\n", filename);
+            return false;
+        }
+        write_file = fopen(filename, "wb");
+        read_file = write_file ? fopen(filename, "rb") : NULL;
+        if (!write_file || !read_file)
+        {
+            fprintf(stderr, "Failed to open log spill file %s\n", filename);
+            if (write_file) fclose(write_file);
+            write_file = NULL;
+            return false;
+        }
+        mutex = SDL_CreateMutex();
+        work = SDL_CreateCond();
+        done = SDL_CreateCond();
+        if (window_values > 0)
+            window = window_values;
+        thread = SDL_CreateThread(WriterThread, "vdb log spill", NULL);
+        assert(mutex && work && done && thread);
+        atexit(Flush);
+        return true;
+    }
+
+    static int ChunkSamples(log_t *l)
+    {
+        int n = VDB_LOG_SPILL_CHUNK/l->SampleSize();
+        return n > 0 ? n : 1;
+    }
+
+    static int WindowSamples(log_t *l)
+    {
+        int n = window/l->SampleSize();
+        return n > 0 ? n : 1;
+    }
+
+    // Number of samples a spilling log keeps in memory, a whole number of
+    // chunks so that the oldest chunk in the ring buffer is contiguous
+    static int RingSamples(log_t *l)
+    {
+        int chunk = ChunkSamples(l);
+        return ((WindowSamples(l) + chunk - 1)/chunk + 1)*chunk;
+    }
+
+    // Called before a sample is appended to a log without a history limit.
+    // Once the log has RingSamples in memory, its data is a ring buffer
+    // (like a bounded history): this returns the slot of the oldest sample
+    // for the new one to overwrite, and when that starts a chunk, the chunk
+    // is queued to be written first (its samples are still read from memory
+    // until they are overwritten). Returns NULL if the sample should be
+    // appended.
+    static float *SpillIfFull(log_t *l)
+    {
+        if (!write_file || l->mapped)
+            return NULL;
+        int chunk = ChunkSamples(l);
+        int ring = RingSamples(l);
+        int count = l->NumSamples();
+        if (count < ring)
+            return NULL;
+
+        int n = l->SampleSize();
+        if (l->spilled % chunk == 0)
+        {
+            // a log that had a longer bounded history has more than a ring
+            // (see SetHistory), and is trimmed a chunk at a time
+            bool trim = count > ring;
+            assert(!trim || l->head == 0);
+            job_t job;
+            job.size = chunk*n*sizeof(float);
+            job.data = (float*)malloc(job.size);
+            assert(job.data && "Failed to allocate memory for log spill");
+            memcpy(job.data, &l->data[l->head*n], job.size);
+            if (trim)
+                l->data.erase(l->data.begin(), l->data.begin() + chunk*n);
+
+            SDL_LockMutex(mutex);
+            while (queued_bytes >= VDB_LOG_SPILL_QUEUE_LIMIT)
+                SDL_CondWait(done, mutex);
+            job.offset = file_end;
+            file_end += job.size;
+            queue.push_back(job);
+            queued_bytes += job.size;
+            SDL_CondSignal(work);
+            SDL_UnlockMutex(mutex);
+            l->spill_offsets.push_back(job.offset);
+
+            if (trim)
+            {
+                l->spilled += chunk;
+                return NULL;
+            }
+        }
+
+        float *sample = &l->data[l->head*n];
+        l->head = (l->head + 1) % count;
+        l->spilled++;
+        return sample;
+    }
+
+    static void ReadSpilled(uint64_t offset, size_t size, float *dst)
+    {
+        SDL_LockMutex(mutex);
+        for (size_t i = 0; i < queue.size(); i++)
+        {
+            job_t &job = queue[i];
+            if (offset >= job.offset && offset + size <= job.offset + job.size)
+            {
+                memcpy(dst, (char*)job.data + (offset - job.offset), size);
+                SDL_UnlockMutex(mutex);
+                return;
+            }
+        }
+        SDL_UnlockMutex(mutex);
+
+        // not queued, so it has been written and flushed
+        Seek(read_file, offset);
+        if (fread(dst, 1, size, read_file) != size)
+            memset(dst, 0, size);
+    }
+
+    // Reads count samples starting at sample first, where samples are
+    // numbered from the oldest spilled sample (the samples in memory start
+    // at l->spilled).
+    static void Read(log_t *l, int64_t first, int count, float *dst)
+    {
+        assert(first >= 0 && first + count <= l->spilled + l->NumSamples());
+        int n = l->SampleSize();
+        int chunk = ChunkSamples(l);
+        while (count > 0 && first < l->spilled)
+        {
+            int64_t k = first/chunk;
+            int i = (int)(first - k*chunk);
+            int m = chunk - i < count ? chunk - i : count;
+            ReadSpilled(l->spill_offsets[k] + (uint64_t)i*n*sizeof(float), m*n*sizeof(float), dst);
+            dst += m*n;
+            first += m;
+            count -= m;
+        }
+        if (count > 0 && l->head == 0 && !l->view)
+            memcpy(dst, l->Sample((int)(first - l->spilled)), count*n*sizeof(float));
+        else
+            for (int i = 0; i < count; i++)
+                memcpy(dst + i*n, l->Sample((int)(first - l->spilled) + i), n*sizeof(float));
+    }
+}
+
+void vdbLogSpill(const char *filename, int window)
+{
+    log_spill::Open(filename, window);
+}
@@ -0,0 +1,348 @@
+// The log tree (logs_t) is only touched by the thread that runs vdbBeginBreak
+// (the owner). Other threads append compact binary records to their own log
+// stream instead, which the owner drains into the tree in vdbBeginBreak and
+// vdbEndBreak. Each stream has its own cursor, so vdbLogPush/vdbLogPop work
+// independently per thread.
+//
+// A stream is a single-producer single-consumer queue: a chain of blocks
+// that the producer appends to and the consumer frees once read. Producers
+// never wait on the owner (a new block is allocated if the current one is
+// full), and the only synchronization is a release-store of the block's
+// write position. Streams are registered in a lock-free list and are reused
+// after their thread exits and the stream has been drained.
+//
+// Until some thread calls vdbBeginBreak, all threads log through streams
+// (so nothing is lost), and the owner's own stream is drained when it takes
+// ownership. A program that logs without ever breaking has no owner, so
+// vdbLogDump and vdbLogSave make the calling thread the owner if there is
+// none yet (see TakeOwnershipIfNone).
+#include <atomic>
+
+namespace log_stream
+{
+    enum record_op_t
+    {
+        op_push_label = 0,
+        op_push,
+        op_pop,
+        op_scalar,
+        op_matrix,
+        op_matrix_row_major,
+        op_array,
+        op_end_of_block
+    };
+
+    struct record_t
+    {
+        unsigned int size; // in bytes, including this header and the padding
+        unsigned short op;
+        unsigned short label_size; // including terminating zero (0 if no label)
+        int history;
+        int rows, columns;
+        int element; // of the data
+        float scalar;
+        // followed by label_size bytes, and rows*columns elements (aligned to 4)
+    };
+
+    struct block_t
+    {
+        std::atomic<size_t> write_pos; // written by the producer
+        size_t read_pos; // only accessed by the consumer
+        std::atomic<block_t*> next;
+        size_t size;
+        // followed by size bytes
+        char *Data() { return (char*)(this + 1); }
+    };
+
+    enum stream_state_t { state_active = 0, state_closed, state_free };
+
+    struct stream_t
+    {
+        std::atomic<int> state;
+        block_t *head; // consumer end
+        block_t *tail; // producer end
+        log_t *cursor; // owned by the consumer
+        stream_t *next_stream;
+    };
+
+    static std::atomic<stream_t*> streams(NULL);
+    static thread_local bool is_owner_thread = false;
+    static std::atomic<bool> has_owner(false);
+
+    // Marks the thread's stream as closed when the thread exits
+    struct thread_stream_t
+    {
+        stream_t *stream;
+        ~thread_stream_t() { if (stream) stream->state.store(state_closed, std::memory_order_release); }
+    };
+    static thread_local thread_stream_t thread_stream = { NULL };
+
+    static block_t *NewBlock(size_t min_size)
+    {
+        size_t size = VDB_LOG_STREAM_BLOCK_SIZE;
+        if (size < min_size)
+            size = min_size;
+        block_t *block = (block_t*)malloc(sizeof(block_t) + size);
+        assert(block && "Failed to allocate log stream block");
+        block->write_pos.store(0, std::memory_order_relaxed);
+        block->read_pos = 0;
+        block->next.store(NULL, std::memory_order_relaxed);
+        block->size = size;
+        return block;
+    }
+
+    static stream_t *GetThreadStream()
+    {
+        if (thread_stream.stream)
+            return thread_stream.stream;
+
+        // reuse the stream of an exited thread if possible
+        for (stream_t *s = streams.load(std::memory_order_acquire); s; s = s->next_stream)
+        {
+            int expected = state_free;
+            if (s->state.compare_exchange_strong(expected, state_active, std::memory_order_acquire))
+            {
+                thread_stream.stream = s;
+                return s;
+            }
+        }
+
+        stream_t *s = new stream_t;
+        s->state.store(state_active, std::memory_order_relaxed);
+        s->head = s->tail = NewBlock(0);
+        s->cursor = NULL;
+        s->next_stream = streams.load(std::memory_order_relaxed);
+        while (!streams.compare_exchange_weak(s->next_stream, s, std::memory_order_release, std::memory_order_relaxed))
+            ;
+        thread_stream.stream = s;
+        return s;
+    }
+
+    // Reserves space for a record of the given size in the calling thread's stream
+    static record_t *BeginRecord(stream_t *s, size_t size)
+    {
+        size = (size + 7) & ~(size_t)7;
+        block_t *block = s->tail;
+        size_t pos = block->write_pos.load(std::memory_order_relaxed);
+        if (pos + size > block->size)
+        {
+            // the consumer stops reading a block at an end-of-block record (or its end)
+            if (pos + sizeof(record_t) <= block->size)
+            {
+                record_t *end = (record_t*)(block->Data() + pos);
+                end->size = (unsigned int)sizeof(record_t);
+                end->op = op_end_of_block;
+                block->write_pos.store(pos + sizeof(record_t), std::memory_order_release);
+            }
+            block_t *next = NewBlock(size);
+            block->next.store(next, std::memory_order_release);
+            s->tail = next;
+            block = next;
+            pos = 0;
+        }
+        record_t *r = (record_t*)(block->Data() + pos);
+        r->size = (unsigned int)size;
+        return r;
+    }
+
+    static void EndRecord(stream_t *s, record_t *r)
+    {
+        block_t *block = s->tail;
+        size_t pos = block->write_pos.load(std::memory_order_relaxed);
+        block->write_pos.store(pos + r->size, std::memory_order_release);
+    }
+
+    static void Write(int op, const char *label, int rows, int columns, int history, float scalar, const void *data, int element=log_float32)
+    {
+        stream_t *s = GetThreadStream();
+        size_t label_size = label ? strlen(label) + 1 : 0;
+        assert(label_size <= 0xffff && "Log label is too long");
+        size_t data_offset = (sizeof(record_t) + label_size + 3) & ~(size_t)3;
+        size_t data_size = data ? (size_t)LogElementSize(element)*rows*columns : 0;
+        record_t *r = BeginRecord(s, data_offset + data_size);
+        r->op = (unsigned short)op;
+        r->label_size = (unsigned short)label_size;
+        r->history = history;
+        r->rows = rows;
+        r->columns = columns;
+        r->element = element;
+        r->scalar = scalar;
+        if (label_size) memcpy((char*)r + sizeof(record_t), label, label_size);
+        if (data_size) memcpy((char*)r + data_offset, data, data_size);
+        EndRecord(s, r);
+    }
+
+    static void Apply(record_t *r)
+    {
+        const char *label = r->label_size ? (const char*)r + sizeof(record_t) : NULL;
+        size_t data_offset = (sizeof(record_t) + r->label_size + 3) & ~(size_t)3;
+        float *data = (float*)((char*)r + data_offset);
+        switch (r->op)
+        {
+            case op_push_label:       logs.Push(label); break;
+            case op_push:             logs.Push(); break;
+            case op_pop:              logs.Pop(); break;
+            case op_scalar:           logs.Scalar(label, r->scalar, r->history); break;
+            case op_matrix:           logs.Matrix(label, data, r->rows, r->columns, r->history); break;
+            case op_matrix_row_major: logs.Matrix_RowMaj(label, data, r->rows, r->columns, r->history); break;
+            case op_array:            logs.Array(label, data, r->element, r->rows, r->columns, r->history); break;
+        }
+    }
+
+    static void DrainStream(stream_t *s)
+    {
+        // records are applied relative to the stream's own cursor
+        log_t *owner_cursor = logs.curr;
+        logs.curr = s->cursor ? s->cursor : &logs.root;
+        block_t *block = s->head;
+        for (;;)
+        {
+            size_t end = block->write_pos.load(std::memory_order_acquire);
+            while (block->read_pos < end)
+            {
+                record_t *r = (record_t*)(block->Data() + block->read_pos);
+                block->read_pos += r->size;
+                if (r->op != op_end_of_block)
+                    Apply(r);
+            }
+            block_t *next = block->next.load(std::memory_order_acquire);
+            if (!next)
+                break;
+            // the producer is done with this block (it wrote everything before linking next)
+            if (block->read_pos < block->write_pos.load(std::memory_order_acquire))
+                continue;
+            free(block);
+            block = next;
+        }
+        s->head = block;
+        s->cursor = logs.curr;
+        logs.curr = owner_cursor;
+    }
+
+    // Applies all pending records from other threads to the log tree
+    static void Drain()
+    {
+        for (stream_t *s = streams.load(std::memory_order_acquire); s; s = s->next_stream)
+        {
+            int state = s->state.load(std::memory_order_acquire);
+            if (state == state_free)
+                continue;
+            DrainStream(s);
+            if (state == state_closed)
+            {
+                // the thread has exited and we've read everything, so the stream can be reused
+                assert(s->head == s->tail);
+                s->head->read_pos = 0;
+                s->head->write_pos.store(0, std::memory_order_relaxed);
+                s->cursor = NULL;
+                s->state.store(state_free, std::memory_order_release);
+            }
+        }
+    }
+
+    // The calling thread becomes the owner of the log tree
+    static void TakeOwnership()
+    {
+        if (is_owner_thread)
+        {
+            Drain();
+            return;
+        }
+        is_owner_thread = true;
+        has_owner.store(true, std::memory_order_release);
+        Drain();
+        // continue where this thread's queued records left off
+        if (thread_stream.stream && thread_stream.stream->cursor)
+            logs.curr = thread_stream.stream->cursor;
+    }
+
+    static void BeginBreak()
+    {
+        TakeOwnership();
+    }
+
+    static void EndBreak()
+    {
+        Drain();
+    }
+
+    // For functions that read the whole log tree outside of a break. If no
+    // thread owns the tree yet, the calling thread takes it, since nothing
+    // else would drain the streams.
+    static void TakeOwnershipIfNone()
+    {
+        bool expected = false;
+        if (is_owner_thread || has_owner.compare_exchange_strong(expected, true))
+            TakeOwnership();
+    }
+}
+
+void vdbLogPush(const char *label)
+{
+    if (vdb_disabled) return;
+    if (log_stream::is_owner_thread) logs.Push(label);
+    else log_stream::Write(log_stream::op_push_label, label, 0, 0, 0, 0.0f, NULL);
+}
+
+void vdbLogPush()
+{
+    if (vdb_disabled) return;
+    if (log_stream::is_owner_thread) logs.Push();
+    else log_stream::Write(log_stream::op_push, NULL, 0, 0, 0, 0.0f, NULL);
+}
+
+void vdbLogPop()
+{
+    if (vdb_disabled) return;
+    if (log_stream::is_owner_thread) logs.Pop();
+    else log_stream::Write(log_stream::op_pop, NULL, 0, 0, 0, 0.0f, NULL);
+}
+
+void vdbLogScalar(const char *label, float x, int history)
+{
+    if (vdb_disabled) return;
+    if (log_stream::is_owner_thread) logs.Scalar(label, x, history);
+    else log_stream::Write(log_stream::op_scalar, label, 0, 0, history, x, NULL);
+}
+
+void vdbLogMatrix(const char *label, float *x, int rows, int columns, int history)
+{
+    if (vdb_disabled) return;
+    if (log_stream::is_owner_thread) logs.Matrix(label, x, rows, columns, history);
+    else log_stream::Write(log_stream::op_matrix, label, rows, columns, history, 0.0f, x);
+}
+
+void vdbLogMatrix_RowMaj(const char *label, float *x, int rows, int columns, int history)
+{
+    if (vdb_disabled) return;
+    if (log_stream::is_owner_thread) logs.Matrix_RowMaj(label, x, rows, columns, history);
+    else log_stream::Write(log_stream::op_matrix_row_major, label, rows, columns, history, 0.0f, x);
+}
+
+void vdbLogVector(const char *label, float *x, int elements, int history)
+{
+    vdbLogMatrix(label, x, elements, 1, history);
+}
+
+void vdbLogArray(const char *label, const void *x, vdbDataType type, int rows, int columns, int history)
+{
+    if (vdb_disabled) return;
+    if (log_stream::is_owner_thread) logs.Array(label, x, type, rows, columns, history);
+    else log_stream::Write(log_stream::op_array, label, rows, columns, history, 0.0f, x, type);
+}
+
+void vdbLogView(const char *label, const void *x, size_t bytes, vdbDataType type, int rows, int columns, int history)
+{
+    if (vdb_disabled) return;
+    assert(bytes == (size_t)LogElementSize(type)*rows*columns && "vdbLogView: bytes doesn't match the type and shape");
+    (void)bytes;
+    // other threads may free x before the owner gets to it, so their views are copied now
+    if (log_stream::is_owner_thread) logs.View(label, x, type, rows, columns, history);
+    else log_stream::Write(log_stream::op_array, label, rows, columns, history, 0.0f, x, type);
+}
+
+void vdbLogDump(const char *filename)
+{
+    log_stream::TakeOwnershipIfNone();
+    logs.Dump(filename);
+}
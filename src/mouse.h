@@ -1,18 +1,18 @@
-namespace mouse_over
+namespace mouse_over // per thread, like transform
 {
-    static int index;
-    static int closest_index;
-    static int prev_closest_index;
-    static float closest_distance;
-    static float closest_x;
-    static float closest_y;
-    static float closest_z;
+    static thread_local int index;
+    static thread_local int closest_index;
+    static thread_local int prev_closest_index;
+    static thread_local float closest_distance;
+    static thread_local float closest_x;
+    static thread_local float closest_y;
+    static thread_local float closest_z;
 }
 
 namespace mouse
 {
     static int x,y; // The position of the mouse in the client area in screen coordinates where (0,0):top-left
-    static vdbVec2 ndc; // -||- in normalized device coordinates where (-1,-1):bottom-left (+1,+1):top-right
+    static thread_local vdbVec2 ndc; // -||- in normalized device coordinates where (-1,-1):bottom-left (+1,+1):top-right (of the thread's viewport)
     static float wheel;
     static struct button_t
     {
@@ -0,0 +1,464 @@
+// Remote viewing (vdbRemote, vdbRemoteView). The client is the instrumented
+// program: like when recording a trace, it runs without a window or OpenGL
+// context (see window::headless) and each break runs once. What it draws is
+// sent as trace chunks (trace.h), one message per hit, through a ring buffer
+// in shared memory to a viewer process, which does all the OpenGL work and
+// adds the hits to its breakpoint history, showing the newest (see
+// tools/vdbreplay).
+//
+// The ring has one producer (the client) and one consumer (the viewer), and
+// the only synchronization is a release-store of their positions, so neither
+// waits on the other. If a message doesn't fit, the hit is dropped: the next
+// message doesn't refer to blobs sent before it (see trace::ResetBlobs), and
+// images that weren't sent are sent again with it. While no viewer is
+// attached, or the last message didn't fit, breaks are skipped altogether.
+//
+// Either side may start first and restart: the shared memory is created by
+// whichever opens it first, and each side sets its bit in remote_header_t::sides
+// while it uses it. The last side to leave (at exit) unlinks it, after marking
+// it closing, so a side that opened it meanwhile opens a new one instead. A
+// viewer that crashed can't leave, so the client also takes the viewer as
+// gone if it hasn't read anything for VDB_REMOTE_TIMEOUT ms (a viewer that
+// was only stalled attaches again). A viewer that attaches skips what is in
+// the ring and bumps a counter, which tells the client to send everything
+// again. The viewer's camera is written to the shared memory under a
+// sequence lock, and the client draws with it.
+//
+// Logs stay in the client (see vdbLogSave), and only one client and one
+// viewer can use a name at a time.
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+struct remote_header_t
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    std::atomic<uint32_t> state; // see remote::Open
+    std::atomic<uint32_t> sides; // see remote::Join
+    std::atomic<uint32_t> viewers; // counts viewers that have attached
+    std::atomic<uint32_t> camera_seq; // odd while the camera is written
+    uint64_t capacity; // of the ring, in bytes
+    std::atomic<uint64_t> write_pos; // bytes written since the start (moved by the client)
+    std::atomic<uint64_t> read_pos; // bytes read since the start (moved by the viewer)
+    std::atomic<uint64_t> dropped; // hits that the client couldn't send
+    float projection[16];
+    float view_model[16];
+    uint32_t depth_test;
+    uint32_t reserved[3];
+};
+
+namespace remote
+{
+    static const char magic[8] = { 'v','d','b','r','i','n','g', 0 };
+    enum { version = 2, byte_order = 0x01020304 };
+    enum { state_empty = 0, state_initializing, state_ready };
+    enum { side_client = 1, side_viewer = 2, side_closing = 4 };
+    enum { ring_offset = (sizeof(remote_header_t) + 63) & ~63 };
+
+    static remote_header_t *header;
+    static size_t mapped_size;
+    static char *ring;
+    static char name[208]; // of the shared memory (at most 200 characters, see Open)
+    static bool is_client;
+    static bool is_viewer;
+
+    // client
+    static uint32_t seen_viewers; // see BeginBlock
+    static uint32_t seen_camera_seq;
+    static bool has_camera;
+    static bool has_viewer; // see ViewerIsStuck
+    static uint64_t last_read_pos;
+    static uint32_t last_read_time;
+    static vdbMat4 projection, view_model; // the viewer's
+    static bool depth_test;
+    static size_t last_size; // of the last message sent
+    static std::vector<char> message;
+    static std::vector<char> image_chunks[MAX_IMAGES];
+    static bool image_dirty[MAX_IMAGES];
+
+    // viewer
+    static trace::reader_t reader;
+
+    static void CopyIn(uint64_t pos, const void *data, size_t size)
+    {
+        size_t at = (size_t)(pos % header->capacity);
+        size_t first = size < header->capacity - at ? size : (size_t)(header->capacity - at);
+        memcpy(ring + at, data, first);
+        memcpy(ring, (const char*)data + first, size - first);
+    }
+
+    static void CopyOut(uint64_t pos, void *data, size_t size)
+    {
+        size_t at = (size_t)(pos % header->capacity);
+        size_t first = size < header->capacity - at ? size : (size_t)(header->capacity - at);
+        memcpy(data, ring + at, first);
+        memcpy((char*)data + first, ring, size - first);
+    }
+
+    static void *Map(size_t size)
+    {
+        mapped_size = size;
+        #ifdef _WIN32
+        char path[256];
+        snprintf(path, sizeof(path), "Local\\vdb-%s", name);
+        HANDLE mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE,
+            (DWORD)((uint64_t)size >> 32), (DWORD)size, path); // opens it if it exists
+        if (!mapping)
+            return NULL;
+        void *base = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, 0);
+        // the mapping is kept open, and is closed by the system when neither
+        // process has it open, so it's never unlinked (see Unlink)
+        return base;
+        #else
+        char path[256];
+        snprintf(path, sizeof(path), "/vdb-%s", name);
+        int fd = shm_open(path, O_RDWR|O_CREAT, 0600);
+        if (fd < 0)
+            return NULL;
+        struct stat st;
+        if (fstat(fd, &st) != 0 || (st.st_size == 0 && ftruncate(fd, (off_t)size) != 0))
+        {
+            close(fd);
+            return NULL;
+        }
+        if (st.st_size != 0)
+            size = (size_t)st.st_size; // created by the other side
+        mapped_size = size;
+        void *base = size >= ring_offset ? mmap(NULL, size, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+        close(fd);
+        return base == MAP_FAILED ? NULL : base;
+        #endif
+    }
+
+    static void Unmap()
+    {
+        #ifdef _WIN32
+        UnmapViewOfFile(header);
+        #else
+        munmap(header, mapped_size);
+        #endif
+        header = NULL;
+        ring = NULL;
+    }
+
+    // Removes the name, so that the next side to open it creates it anew
+    static void Unlink()
+    {
+        #ifndef _WIN32
+        char path[256];
+        snprintf(path, sizeof(path), "/vdb-%s", name);
+        shm_unlink(path);
+        #endif
+    }
+
+    // Returns false if the shared memory isn't ready (yet)
+    static bool IsReady()
+    {
+        return header && header->state.load(std::memory_order_acquire) == state_ready;
+    }
+
+    // Sets the bit of this side in header->sides. Returns false if the last
+    // side is leaving, and the shared memory is being unlinked.
+    static bool Join(uint32_t side)
+    {
+        uint32_t sides = header->sides.load(std::memory_order_acquire);
+        do
+        {
+            if (sides & side_closing)
+                return false;
+        } while (!header->sides.compare_exchange_weak(sides, sides | side));
+        return true;
+    }
+
+    // Clears the bit of this side, and unlinks the shared memory if no other
+    // side is using it
+    static void Leave(uint32_t side)
+    {
+        uint32_t sides = header->sides.load(std::memory_order_acquire);
+        uint32_t rest;
+        do
+        {
+            rest = sides & ~side;
+        } while (!header->sides.compare_exchange_weak(sides, rest ? rest : (uint32_t)side_closing));
+        if (!rest)
+            Unlink();
+    }
+
+    static void Close()
+    {
+        if (header)
+            Leave(is_client ? side_client : side_viewer);
+    }
+
+    static bool Open(const char *new_name, uint32_t side)
+    {
+        if (strchr(new_name, '/') || strchr(new_name, '\\') || strlen(new_name) > 200)
+        {
+            fprintf(stderr, "Invalid name for vdbRemote: %s\n", new_name);
+            return false;
+        }
+        if (name != new_name)
+            snprintf(name, sizeof(name), "%s", new_name);
+        size_t capacity = VDB_REMOTE_BUFFER_SIZE;
+        for (int tries = 0; ; tries++)
+        {
+            header = (remote_header_t*)Map(ring_offset + capacity);
+            if (!header)
+            {
+                fprintf(stderr, "Failed to open shared memory for vdbRemote: %s\n", name);
+                return false;
+            }
+            ring = (char*)header + ring_offset;
+
+            // the memory starts out zeroed; whoever gets here first fills in the header
+            uint32_t expected = state_empty;
+            if (header->state.compare_exchange_strong(expected, state_initializing))
+            {
+                memcpy(header->magic, magic, sizeof(magic));
+                header->version = version;
+                header->byte_order = byte_order;
+                header->capacity = capacity;
+                header->state.store(state_ready, std::memory_order_release);
+            }
+            else
+            {
+                for (int i = 0; i < 1000 && !IsReady(); i++)
+                    SDL_Delay(1);
+            }
+            if (IsReady() && (memcmp(header->magic, magic, sizeof(magic)) != 0 ||
+                              header->version != version ||
+                              header->byte_order != byte_order))
+            {
+                fprintf(stderr, "vdbRemote: %s is used by an incompatible version of vdb\n", name);
+                Unmap();
+                return false;
+            }
+            if (Join(side))
+                break;
+            Unmap(); // the name will refer to a new one once it's unlinked
+            if (tries == 1000)
+            {
+                fprintf(stderr, "vdbRemote: %s is still being closed\n", name);
+                return false;
+            }
+            SDL_Delay(1);
+        }
+
+        static bool registered = false;
+        if (!registered)
+            atexit(Close);
+        registered = true;
+        return true;
+    }
+
+    // Called by vdbLoadImage* on the client
+    static void QueueImage(int slot, const void *data, int width, int height, int channels, bool is_float)
+    {
+        if (!is_client)
+            return;
+        std::vector<char> &chunk = image_chunks[slot];
+        chunk.clear();
+        trace::out = &chunk;
+        trace::offset = 0;
+        trace::WriteImage(slot, data, width, height, channels, is_float);
+        trace::out = NULL;
+        image_dirty[slot] = true;
+    }
+
+    static void ReadCamera()
+    {
+        uint32_t seq = header->camera_seq.load(std::memory_order_acquire);
+        if (seq == seen_camera_seq || (seq & 1))
+            return;
+        float p[16], v[16];
+        memcpy(p, header->projection, sizeof(p));
+        memcpy(v, header->view_model, sizeof(v));
+        bool d = header->depth_test != 0;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (header->camera_seq.load(std::memory_order_relaxed) != seq)
+            return; // written meanwhile, try again next time
+        memcpy(projection.data, p, sizeof(p));
+        memcpy(view_model.data, v, sizeof(v));
+        depth_test = d;
+        has_camera = true;
+        seen_camera_seq = seq;
+    }
+
+    // Returns true if the viewer hasn't read any of what's in the ring for
+    // VDB_REMOTE_TIMEOUT ms (e.g. it crashed, and couldn't leave). The time
+    // starts over when a viewer joins, since it skips the ring in Attach.
+    static bool ViewerIsStuck(uint64_t write_pos, uint64_t read_pos)
+    {
+        uint32_t now = SDL_GetTicks();
+        if (!has_viewer || read_pos == write_pos || read_pos != last_read_pos)
+        {
+            has_viewer = true;
+            last_read_pos = read_pos;
+            last_read_time = now;
+            return false;
+        }
+        return now - last_read_time > VDB_REMOTE_TIMEOUT;
+    }
+
+    // Returns false if the client should skip the break
+    static bool BeginBlock()
+    {
+        if (!IsReady())
+            return false;
+        if (!(header->sides.load(std::memory_order_acquire) & side_viewer))
+        {
+            has_viewer = false;
+            return false;
+        }
+        uint32_t viewers = header->viewers.load(std::memory_order_acquire);
+        if (viewers != seen_viewers)
+        {
+            // a viewer (re)attached: it has none of what was sent before
+            seen_viewers = viewers;
+            trace::ResetBlobs();
+            for (int i = 0; i < MAX_IMAGES; i++)
+                image_dirty[i] = !image_chunks[i].empty();
+            last_size = 0;
+        }
+        uint64_t w = header->write_pos.load(std::memory_order_relaxed);
+        uint64_t r = header->read_pos.load(std::memory_order_acquire);
+        if (ViewerIsStuck(w, r))
+        {
+            header->sides.fetch_and(~(uint32_t)side_viewer); // until it attaches again
+            return false;
+        }
+        if (header->capacity - (w - r) < sizeof(uint64_t) + last_size)
+        {
+            header->dropped++;
+            return false;
+        }
+        ReadCamera();
+        return true;
+    }
+
+    static bool Send()
+    {
+        uint64_t size = message.size();
+        uint64_t w = header->write_pos.load(std::memory_order_relaxed);
+        uint64_t r = header->read_pos.load(std::memory_order_acquire);
+        if (header->capacity - (w - r) < sizeof(size) + size)
+            return false;
+        CopyIn(w, &size, sizeof(size));
+        CopyIn(w + sizeof(size), message.data(), (size_t)size);
+        header->write_pos.store(w + sizeof(size) + size, std::memory_order_release);
+        return true;
+    }
+
+    // Sends what the client recorded in the break (and images not sent yet)
+    static void EndBlock(const char *label)
+    {
+        message.clear();
+        for (int i = 0; i < MAX_IMAGES; i++)
+            if (image_dirty[i])
+                message.insert(message.end(), image_chunks[i].begin(), image_chunks[i].end());
+        trace::out = &message;
+        trace::offset = message.size();
+        trace::WriteFrame(label);
+        trace::out = NULL;
+
+        last_size = message.size();
+        if (Send())
+        {
+            memset(image_dirty, 0, sizeof(image_dirty));
+            return;
+        }
+        header->dropped++;
+        trace::ResetBlobs(); // the next message can't refer to this one
+        if (sizeof(uint64_t) + last_size > header->capacity)
+        {
+            static bool warned = false;
+            if (!warned)
+                fprintf(stderr, "vdbRemote: a hit (%llu bytes) is larger than VDB_REMOTE_BUFFER_SIZE\n", (unsigned long long)last_size);
+            warned = true;
+            last_size = 0; // don't skip every break because of it
+        }
+    }
+
+    // Called by the viewer after Open. It skips what the ring holds, since
+    // that refers to earlier messages.
+    static void Attach()
+    {
+        is_viewer = true;
+        history::follow = true;
+        header->read_pos.store(header->write_pos.load(std::memory_order_acquire), std::memory_order_release);
+        header->viewers++;
+    }
+
+    static void Process(const std::vector<char> &m)
+    {
+        size_t at = 0;
+        while (at + sizeof(trace_chunk_t) <= m.size())
+        {
+            trace_chunk_t chunk;
+            memcpy(&chunk, &m[at], sizeof(chunk));
+            at += sizeof(chunk);
+            if (chunk.size > m.size() - at)
+                return;
+            if (!reader.Chunk(chunk, &m[at]))
+                return; // e.g. it refers to a blob sent before the viewer attached
+            at += (size_t)chunk.size;
+            at += (16 - at % 16) % 16;
+        }
+    }
+
+    // Called by the viewer when it begins a frame
+    static void Poll()
+    {
+        if (!is_viewer)
+            return;
+        window::DontWaitNextFrameEvents(); // keep checking for messages
+        if (header && !(header->sides.load(std::memory_order_acquire) & side_viewer))
+        {
+            // the client took this viewer as gone (see ViewerIsStuck), and may
+            // have left since, so the name is opened again
+            Unmap();
+            if (Open(name, side_viewer))
+                Attach();
+        }
+        if (!IsReady())
+            return;
+        static std::vector<char> m;
+        for (;;)
+        {
+            uint64_t w = header->write_pos.load(std::memory_order_acquire);
+            uint64_t r = header->read_pos.load(std::memory_order_relaxed);
+            uint64_t size;
+            if (w - r < sizeof(size))
+                break;
+            CopyOut(r, &size, sizeof(size));
+            if (size > w - r - sizeof(size))
+            {
+                header->read_pos.store(w, std::memory_order_release); // garbage, start over
+                break;
+            }
+            m.resize((size_t)size);
+            CopyOut(r + sizeof(size), m.data(), (size_t)size);
+            header->read_pos.store(r + sizeof(size) + size, std::memory_order_release);
+            Process(m);
+        }
+    }
+
+    // Called by the viewer after its BeginCamera
+    static void SaveCamera(bool is_3D)
+    {
+        if (!is_viewer || !IsReady())
+            return;
+        uint32_t seq = header->camera_seq.load(std::memory_order_relaxed);
+        header->camera_seq.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        memcpy(header->projection, transform::projection.data, sizeof(header->projection));
+        memcpy(header->view_model, transform::view_model.data, sizeof(header->view_model));
+        header->depth_test = is_3D ? 1 : 0;
+        header->camera_seq.store(seq + 2, std::memory_order_release);
+    }
+}
@@ -24,6 +24,19 @@
 //                                   -----------------
 // In this example, it would take 4 frames before the output settles,
 // assuming a static scene.
+//
+// In coarse mode (used by the adaptive render scale while the user is
+// interacting), the low-resolution frame is instead sampled at the pixel
+// centers and written to all the pixels of the high-res framebuffer:
+//                                   _________________
+//                 ___________      | 0 0 | 0 0 | 0 0 |
+//                | 0 | 0 | 0 |     | 0 0 | 0 0 | 0 0 |
+//                | --+---+---| --> |-----+-----+-----|
+//                | 0 | 0 | 0 |     | 0 0 | 0 0 | 0 0 |
+//                 -----------      | 0 0 | 0 0 | 0 0 |
+//                                   -----------------
+// and the subpixel sequence restarts, such that the output is refined
+// through the regular interleaving once the interaction stops.
 namespace render_scaler
 {
     static framebuffer_t output;
@@ -37,13 +50,31 @@ namespace render_scaler
     static float frag_offset_y;
     static float sample_pos_ndc_x;
     static float sample_pos_ndc_y;
+    static bool coarse;
+    static vdbTextureFilter output_filter = VDB_NEAREST; // used when compositing onto the window
 
-    void Begin(int w, int h, int n_up)
+    // Whether the user is (probably) changing the view
+    static bool IsInteracting()
+    {
+        if (vdbIsCameraMoving())
+            return true;
+        if (mouse::left.down || mouse::right.down || mouse::middle.down || mouse::wheel != 0.0f)
+            return true;
+        for (int i = 0; i < VDB_NUM_KEYS; i++)
+            if (keys::down[i])
+                return true;
+        return false;
+    }
+
+    void Begin(int w, int h, int n_up, bool is_coarse=false)
     {
         window::SetMinimumNumSettleFrames(3 + (1<<n_up)*(1<<n_up));
 
         scale_up = n_up;
         has_begun = true;
+        coarse = is_coarse;
+        if (coarse)
+            subpixel = 0;
 
         if (lowres.width != w || lowres.height != h)
         {
@@ -115,6 +146,14 @@ namespace render_scaler
             float pixel_height_ndc = 2.0f / (h<<scale_up);
             sample_pos_ndc_x = (-0.5f*num_samples + 0.5f + sample_pos_idx)*pixel_width_ndc;
             sample_pos_ndc_y = (-0.5f*num_samples + 0.5f + sample_pos_idy)*pixel_height_ndc;
+
+            if (coarse)
+            {
+                frag_offset_x = 0.0f;
+                frag_offset_y = 0.0f;
+                sample_pos_ndc_x = 0.0f;
+                sample_pos_ndc_y = 0.0f;
+            }
         }
     }
     void End()
@@ -219,9 +258,18 @@ namespace render_scaler
             glActiveTexture(GL_TEXTURE0);
             glUniform1i(uniform_sampler0, 0);
             glBindTexture(GL_TEXTURE_2D, lowres.color[0]);
-            glUniform1f(uniform_dx, (float)sample_pos_idx);
-            glUniform1f(uniform_dy, (float)sample_pos_idy);
-            glUniform1f(uniform_nx, (float)(1<<scale_up));
+            if (coarse)
+            {
+                glUniform1f(uniform_dx, 0.0f);
+                glUniform1f(uniform_dy, 0.0f);
+                glUniform1f(uniform_nx, 1.0f);
+            }
+            else
+            {
+                glUniform1f(uniform_dx, (float)sample_pos_idx);
+                glUniform1f(uniform_dy, (float)sample_pos_idy);
+                glUniform1f(uniform_nx, (float)(1<<scale_up));
+            }
             glVertexAttribPointer(attrib_position, 2, GL_FLOAT, GL_FALSE, 0, 0);
             glEnableVertexAttribArray(attrib_position);
             glDrawArrays(GL_TRIANGLES, 0, 6);
@@ -235,14 +283,15 @@ namespace render_scaler
         // composite full resolution framebuffer onto window framebuffer
         // note: we re-enable user's draw state (e.g. depth test/write).
         immediate::SetState(last_state);
-        DrawRenderTargetWithDepth(output, VDB_NEAREST, VDB_CLAMP);
+        DrawRenderTargetWithDepth(output, output_filter, VDB_CLAMP);
 
         vdbPopMatrix();
         vdbPopProjection();
 
         // just a linear sampling order. want something nicer in the future
         int num_subpixels = (1<<scale_up)*(1<<scale_up);
-        subpixel = (subpixel+1)%num_subpixels;
+        if (!coarse)
+            subpixel = (subpixel+1)%num_subpixels;
     }
 }
 
@@ -280,6 +329,8 @@ vdbVec2 vdbGetRenderScale()
 
 void vdbBeginRenderScale(int width, int height, int up)
 {
+    if (window::IsHeadless()) // not traced
+        return;
     assert(!render_scaler::has_begun && "You have to disable the built-in render scaler (set to 1/1 in settings).");
     assert(up >= 0);
     render_scaler::Begin(width, height, up);
@@ -298,6 +349,8 @@ void vdbBeginRenderScale(int down, int up)
 
 void vdbEndRenderScale()
 {
+    if (window::IsHeadless())
+        return;
     assert(render_scaler::has_begun);
     render_scaler::End();
     immediate::SetRenderOffsetNDC(vdbGetRenderOffset());
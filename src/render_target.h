@@ -5,12 +5,16 @@ static framebuffer_t render_targets[MAX_RENDER_TARGETS];
 
 void vdbBeginRenderTarget(int slot, vdbRenderTargetDesc desc)
 {
+    if (window::IsHeadless()) // not traced
+        return;
+    GLCallSite(NULL);
     assert(slot >= 0 && slot < MAX_RENDER_TARGETS && "You are trying to use a render texture beyond the available slots.");
 
     assert(desc.format == VDB_RGBA32F || desc.format == VDB_RGBA8);
     assert(desc.stencil_bits == 0 && "Stencil in RenderTarget is not implemented yet.");
     assert(desc.width > 0 && desc.height > 0 && "RenderTarget must have non-zero width and height.");
 
+    damage::Touch(); // the contents of render targets aren't hashed
     render_target_t *rt = render_targets + slot;
     bool should_create = false;
     if (rt->fbo)
@@ -44,6 +48,9 @@ void vdbBeginRenderTarget(int slot, vdbRenderTargetDesc desc)
 
 void vdbEndRenderTarget()
 {
+    if (window::IsHeadless())
+        return;
+    GLCallSite(NULL);
     assert(current_framebuffer && "vdbEndRenderTarget was called but no render target was bound.");
     DisableFramebuffer(current_framebuffer);
 
@@ -53,6 +60,13 @@ void vdbEndRenderTarget()
 void vdbBindRenderTarget(int slot, vdbTextureFilter filter, vdbTextureWrap wrap)
 {
     assert(slot >= 0 && slot < MAX_RENDER_TARGETS && "You are trying to use a render texture beyond the available slots.");
+    if (active_texture_unit == 0)
+    {
+        bound_image = -1;
+        bound_texture = 0; // render targets may not outlive the frame, so they aren't recorded
+    }
+    if (window::IsHeadless())
+        return;
     glBindTexture(GL_TEXTURE_2D, render_targets[slot].color[0]);
     vdbSetTextureParameters(filter, wrap);
 }
@@ -60,6 +74,13 @@ void vdbBindRenderTarget(int slot, vdbTextureFilter filter, vdbTextureWrap wrap)
 void vdbBindRenderTargetDepth(int slot, vdbTextureFilter filter, vdbTextureWrap wrap)
 {
     assert(slot >= 0 && slot < MAX_RENDER_TARGETS && "You are trying to use a render texture beyond the available slots.");
+    if (active_texture_unit == 0)
+    {
+        bound_image = -1;
+        bound_texture = 0; // render targets may not outlive the frame, so they aren't recorded
+    }
+    if (window::IsHeadless())
+        return;
     glBindTexture(GL_TEXTURE_2D, render_targets[slot].depth);
     vdbSetTextureParameters(filter, wrap);
 }
@@ -131,12 +152,16 @@ void DrawRenderTargetWithDepth(render_target_t rt, vdbTextureFilter filter, vdbT
 void vdbDrawRenderTargetWithDepth(int slot, vdbTextureFilter filter, vdbTextureWrap wrap)
 {
     assert(slot >= 0 && slot < MAX_RENDER_TARGETS && "You are trying to use a render texture beyond the available slots.");
+    if (window::IsHeadless())
+        return;
     DrawRenderTargetWithDepth(render_targets[slot], filter, wrap);
 }
 
 void vdbDrawRenderTarget(int slot, vdbTextureFilter filter, vdbTextureWrap wrap)
 {
     assert(slot >= 0 && slot < MAX_RENDER_TARGETS && "You are trying to use a render texture beyond the available slots.");
+    if (window::IsHeadless())
+        return;
 
     glActiveTexture(GL_TEXTURE0);
     glBindTexture(GL_TEXTURE_2D, render_targets[slot].color[0]);
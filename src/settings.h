@@ -1,5 +1,8 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string>
+#include <vector>
+#include <unordered_map>
 
 vdbHintKey VDB_CAMERA_TYPE = 0;
 vdbHintKey VDB_ORIENTATION = 1;
@@ -23,7 +26,6 @@ vdbOrientation VDB_X_DOWN   = 5;
 vdbTheme VDB_DARK_THEME     = 0;
 vdbTheme VDB_BRIGHT_THEME   = 1;
 
-enum { MAX_FRAME_SETTINGS = 1024 };
 enum { VDB_MAX_RENDER_SCALE_DOWN = 3 };
 enum { VDB_MAX_RENDER_SCALE_UP = 3 };
 
@@ -88,6 +90,37 @@ struct render_scaler_settings_t
     bool dirty;
     int down;
     int up;
+    bool adaptive; // render at 1/(1<<down) while interacting, refine to 1/1 when idle
+    float budget_ms; // if > 0, overrides down/up with a scale chosen to fit the frame time budget
+};
+
+enum break_mode_t
+{
+    break_always = 0,
+    break_never,
+    break_every, // every count'th hit
+    break_after, // every hit after the first count hits
+    break_crossing // when the newest sample of a scalar log crosses threshold
+};
+
+struct log_t;
+
+// See breakpoints.h
+struct break_settings_t
+{
+    bool dirty;
+    int mode; // break_mode_t
+    int count;
+    char log[256]; // path of the log, e.g. /iter/loss
+    float threshold;
+    int direction; // break when the value rises above the threshold (+1), falls below it (-1) or either (0)
+
+    // not saved
+    uint64_t hits;
+    bool was_above, has_value; // the value at the last hit
+    log_t *resolved; // the log found at log
+    bool is_resolved;
+    unsigned int resolved_tree_version;
 };
 
 struct camera_settings_t
@@ -103,11 +136,12 @@ struct camera_settings_t
 
 struct frame_settings_t
 {
-    char *name;
+    const char *name; // interned (see intern.h)
     camera_settings_t camera;
     render_scaler_settings_t render_scaler;
     grid_settings_t grid;
     widget_settings_t widgets;
+    break_settings_t breaks;
 };
 
 struct global_camera_settings_t
@@ -127,16 +161,18 @@ struct settings_t
 {
     global_camera_settings_t camera;
     window_settings_t window;
-    frame_settings_t frames[MAX_FRAME_SETTINGS];
-    int num_frames;
+    std::vector<frame_settings_t*> frames; // in the order they were added (and are saved)
+    std::unordered_map<const char*, frame_settings_t*> frames_by_name; // keyed by the interned name
     bool never_ask_on_exit;
     bool show_main_menu;
     int font_size;
     bool can_idle;
     int auto_step_delay_ms;
+    int target_fps; // when vsync is off (0 is unlimited, see frame_clock.h)
     int dpi_scale;
     vdbTheme global_theme;
 
+    frame_settings_t *FindFrame(const char *name, size_t n);
     void LoadOrDefault(const char *filename);
     void Save(const char *filename);
 };
@@ -196,8 +232,29 @@ void DefaultFrameSettings(frame_settings_t *fs)
     fs->render_scaler.dirty = false;
     fs->render_scaler.down = 0;
     fs->render_scaler.up = 0;
+    fs->render_scaler.adaptive = false;
+    fs->render_scaler.budget_ms = 0.0f;
     fs->widgets.widgets = NULL;
     fs->widgets.num_widgets = 0;
+    memset(&fs->breaks, 0, sizeof(fs->breaks));
+    fs->breaks.count = 2;
+}
+
+// Returns the settings of a label, added with default values if there are
+// none. Names are interned, so equal labels share one entry however they
+// were built, and entries are found by pointer.
+frame_settings_t *settings_t::FindFrame(const char *name, size_t n)
+{
+    const char *key = intern::Intern(name, n, intern::Hash(name, n));
+    frame_settings_t *&fs = frames_by_name[key];
+    if (!fs)
+    {
+        fs = new frame_settings_t();
+        fs->name = key;
+        DefaultFrameSettings(fs);
+        frames.push_back(fs);
+    }
+    return fs;
 }
 
 namespace settings_parser
@@ -362,6 +419,27 @@ namespace settings_parser
         return false;
     }
 
+    static bool ParseBreakMode(const char **c, int *mode)
+    {
+        ParseBlank(c);
+        if      (ParseMatch(c, "always"))   { *mode = break_always; return true; }
+        else if (ParseMatch(c, "never"))    { *mode = break_never; return true; }
+        else if (ParseMatch(c, "every"))    { *mode = break_every; return true; }
+        else if (ParseMatch(c, "after"))    { *mode = break_after; return true; }
+        else if (ParseMatch(c, "crossing")) { *mode = break_crossing; return true; }
+        return false;
+    }
+
+    static bool ParseString(const char **c, char *dst, size_t size)
+    {
+        char *s;
+        if (!ParseString(c, &s)) return false;
+        strncpy(dst, s, size - 1);
+        dst[size - 1] = '\0';
+        delete[] s;
+        return true;
+    }
+
     static bool ParseTheme(const char **c, vdbTheme *theme)
     {
         ParseBlank(c);
@@ -488,8 +566,8 @@ void settings_t::LoadOrDefault(const char *filename)
     never_ask_on_exit = false;
     show_main_menu = true;
     can_idle = false;
-    num_frames = 0;
     auto_step_delay_ms = 250;
+    target_fps = 60;
     font_size = (int)(VDB_DEFAULT_FONT_SIZE);
     global_theme = VDB_DARK_THEME;
 
@@ -516,23 +594,10 @@ void settings_t::LoadOrDefault(const char *filename)
         using namespace settings_parser;
         if (ParseKey(c, "[frame]"))
         {
-            if (num_frames == MAX_FRAME_SETTINGS)
-            {
-                frame = NULL;
-                fprintf(stderr, "vdb: Reached max number of stored per-block settings. You should clean up your vdb.ini file!\n");
-                continue;
-            }
-            assert(num_frames < MAX_FRAME_SETTINGS);
-            frame = frames + (num_frames++);
             const char *name_begin = *c;
             while (**c && !(**c == '\n' || **c == '\r'))
                 *c = *c + 1;
-            const char *name_end = *c;
-            size_t len = name_end - name_begin;
-            frame->name = (char*)malloc(len + 1);
-            memcpy(frame->name, name_begin, len);
-            frame->name[len] = '\0';
-            DefaultFrameSettings(frame);
+            frame = FindFrame(name_begin, *c - name_begin);
         }
         else if (frame)
         {
@@ -557,6 +622,13 @@ void settings_t::LoadOrDefault(const char *filename)
             else if (ParseKey(c, "cube_visible"))       { ParseBool(c,       &frame->grid.cube_visible);           frame->grid.dirty = true; }
             else if (ParseKey(c, "render_scale_down"))  { ParseInt(c,        &frame->render_scaler.down, 0, VDB_MAX_RENDER_SCALE_DOWN); frame->render_scaler.dirty = true; }
             else if (ParseKey(c, "render_scale_up"))    { ParseInt(c,        &frame->render_scaler.up, 0, VDB_MAX_RENDER_SCALE_UP); frame->render_scaler.dirty = true; }
+            else if (ParseKey(c, "render_scale_adaptive")) { ParseBool(c,    &frame->render_scaler.adaptive);      frame->render_scaler.dirty = true; }
+            else if (ParseKey(c, "render_scale_budget_ms")) { ParseFloat(c,  &frame->render_scaler.budget_ms);     frame->render_scaler.dirty = true; }
+            else if (ParseKey(c, "break_mode"))         { ParseBreakMode(c,  &frame->breaks.mode);                 frame->breaks.dirty = true; }
+            else if (ParseKey(c, "break_count"))        { ParseInt(c,        &frame->breaks.count, 1, INT_MAX);    frame->breaks.dirty = true; }
+            else if (ParseKey(c, "break_log"))          { ParseString(c,     frame->breaks.log, sizeof(frame->breaks.log)); frame->breaks.dirty = true; }
+            else if (ParseKey(c, "break_threshold"))    { ParseFloat(c,      &frame->breaks.threshold);            frame->breaks.dirty = true; }
+            else if (ParseKey(c, "break_direction"))    { ParseInt(c,        &frame->breaks.direction, -1, 1);     frame->breaks.dirty = true; }
             else if (ParseKey(c, "widgets"))            { ParseWidgets(c,    &frame->widgets); }
             else *c = *c + 1;
         }
@@ -572,6 +644,7 @@ void settings_t::LoadOrDefault(const char *filename)
         else if (ParseKey(c, "dpi_scale"))          ParseFloatToInt(c, &dpi_scale, 100, 200);
         else if (ParseKey(c, "can_idle"))           ParseBool(c,       &can_idle);
         else if (ParseKey(c, "auto_step_delay_ms")) ParseInt(c,        &auto_step_delay_ms);
+        else if (ParseKey(c, "target_fps"))         ParseInt(c,        &target_fps);
         else if (ParseKey(c, "global_theme"))       ParseTheme(c,      &global_theme);
         else *c = *c + 1;
     }
@@ -579,38 +652,71 @@ void settings_t::LoadOrDefault(const char *filename)
     free(data);
 }
 
+namespace settings_saver { static void Queue(const char *filename, std::string *text); } // see settings_saver.h
+
 namespace settings_writer
 {
-    static void WriteCameraType(FILE *f, const char *key, vdbCameraType type)
+    static void Print(std::string *f, const char *format, ...)
     {
-             if (type == VDB_CUSTOM)    fprintf(f, "%s=disabled\n", key);
-        else if (type == VDB_PLANAR)    fprintf(f, "%s=planar\n", key);
-        else if (type == VDB_TRACKBALL) fprintf(f, "%s=trackball\n", key);
-        else if (type == VDB_TURNTABLE) fprintf(f, "%s=turntable\n", key);
-        else                            fprintf(f, "%s=disabled\n", key);
+        char buffer[1024];
+        va_list args;
+        va_start(args, format);
+        int n = vsnprintf(buffer, sizeof(buffer), format, args);
+        va_end(args);
+        if (n < 0)
+            return;
+        if (n < (int)sizeof(buffer))
+        {
+            f->append(buffer, n);
+            return;
+        }
+        size_t size = f->size();
+        f->resize(size + n + 1);
+        va_start(args, format);
+        vsnprintf(&(*f)[size], n + 1, format, args);
+        va_end(args);
+        f->resize(size + n);
     }
 
-    static void WriteCameraUp(FILE *f, const char *key, vdbOrientation mode)
+    static void WriteCameraType(std::string *f, const char *key, vdbCameraType type)
     {
-        if      (mode == VDB_Z_UP)   fprintf(f, "%s=z_up\n", key);
-        else if (mode == VDB_Y_UP)   fprintf(f, "%s=y_up\n", key);
-        else if (mode == VDB_X_UP)   fprintf(f, "%s=x_up\n", key);
-        else if (mode == VDB_Z_DOWN) fprintf(f, "%s=z_down\n", key);
-        else if (mode == VDB_Y_DOWN) fprintf(f, "%s=y_down\n", key);
-        else if (mode == VDB_X_DOWN) fprintf(f, "%s=x_down\n", key);
-        else                         fprintf(f, "%s=z_up\n", key);
+             if (type == VDB_CUSTOM)    Print(f, "%s=disabled\n", key);
+        else if (type == VDB_PLANAR)    Print(f, "%s=planar\n", key);
+        else if (type == VDB_TRACKBALL) Print(f, "%s=trackball\n", key);
+        else if (type == VDB_TURNTABLE) Print(f, "%s=turntable\n", key);
+        else                            Print(f, "%s=disabled\n", key);
     }
 
-    static void WriteTheme(FILE *f, const char *key, vdbTheme theme)
+    static void WriteCameraUp(std::string *f, const char *key, vdbOrientation mode)
     {
-        if      (theme == VDB_DARK_THEME)   fprintf(f, "%s=dark\n", key);
-        else if (theme == VDB_BRIGHT_THEME)  fprintf(f, "%s=bright\n", key);
-        else                                fprintf(f, "%s=dark\n", key);
+        if      (mode == VDB_Z_UP)   Print(f, "%s=z_up\n", key);
+        else if (mode == VDB_Y_UP)   Print(f, "%s=y_up\n", key);
+        else if (mode == VDB_X_UP)   Print(f, "%s=x_up\n", key);
+        else if (mode == VDB_Z_DOWN) Print(f, "%s=z_down\n", key);
+        else if (mode == VDB_Y_DOWN) Print(f, "%s=y_down\n", key);
+        else if (mode == VDB_X_DOWN) Print(f, "%s=x_down\n", key);
+        else                         Print(f, "%s=z_up\n", key);
     }
 
-    static void WriteMat4(FILE *f, const char *key, vdbMat4 m)
+    static void WriteTheme(std::string *f, const char *key, vdbTheme theme)
     {
-        fprintf(f, "%s=%g, %g, %g, %g, %g, %g, %g, %g, %g, %g, %g, %g, %g, %g, %g, %g\n",
+        if      (theme == VDB_DARK_THEME)   Print(f, "%s=dark\n", key);
+        else if (theme == VDB_BRIGHT_THEME)  Print(f, "%s=bright\n", key);
+        else                                Print(f, "%s=dark\n", key);
+    }
+
+    static void WriteBreakMode(std::string *f, const char *key, int mode)
+    {
+        if      (mode == break_never)    Print(f, "%s=never\n", key);
+        else if (mode == break_every)    Print(f, "%s=every\n", key);
+        else if (mode == break_after)    Print(f, "%s=after\n", key);
+        else if (mode == break_crossing) Print(f, "%s=crossing\n", key);
+        else                             Print(f, "%s=always\n", key);
+    }
+
+    static void WriteMat4(std::string *f, const char *key, vdbMat4 m)
+    {
+        Print(f, "%s=%g, %g, %g, %g, %g, %g, %g, %g, %g, %g, %g, %g, %g, %g, %g, %g\n",
             key,
             m(0,0), m(1,0), m(2,0), m(3,0),  // 1st column
             m(0,1), m(1,1), m(2,1), m(3,1),  // 2nd column
@@ -618,48 +724,47 @@ namespace settings_writer
             m(0,3), m(1,3), m(2,3), m(3,3)); // 4th column
     }
 
-    static void WriteVec4(FILE *f, const char *key, vdbVec4 v)
+    static void WriteVec4(std::string *f, const char *key, vdbVec4 v)
     {
-        fprintf(f, "%s=%g, %g, %g, %g\n", key, v.x, v.y, v.z, v.w);
+        Print(f, "%s=%g, %g, %g, %g\n", key, v.x, v.y, v.z, v.w);
     }
 
-    static void WriteWidgets(FILE *f, const char *key, widget_settings_t w)
+    static void WriteWidgets(std::string *f, const char *key, widget_settings_t w)
     {
         if (w.num_widgets <= 0)
             return;
-        fprintf(f, "%s=", key);
+        Print(f, "%s=", key);
         for (int i = 0; i < w.num_widgets; i++)
-            fprintf(f, "\"%s\",%d,%g", w.widgets[i].name, w.widgets[i].position, w.widgets[i].value);
+            Print(f, "\"%s\",%d,%g", w.widgets[i].name, w.widgets[i].position, w.widgets[i].value);
     }
 }
 
+// Formats the settings in memory and hands them to the writer thread (see
+// settings_saver.h), so that stepping doesn't wait on the disk
 void settings_t::Save(const char *filename)
 {
     using namespace settings_writer;
-    FILE *f = fopen(filename, "wb+");
-    if (!f)
-    {
-        fprintf(stderr, "Failed to save settings.\n");
-        return;
-    }
-    fprintf(f, "[vdb]\n");
-    fprintf(f, "window_pos=%d,%d\n", window.x, window.y);
-    fprintf(f, "window_size=%d,%d\n", window.width, window.height);
-    fprintf(f, "never_ask_on_exit=%d\n", never_ask_on_exit);
-    fprintf(f, "show_main_menu=%d\n", show_main_menu);
-    fprintf(f, "mouse_sensitivity=%g\n", camera.mouse_sensitivity);
-    fprintf(f, "scroll_sensitivity=%g\n", camera.scroll_sensitivity);
-    fprintf(f, "move_speed_normal=%g\n", camera.move_speed_normal);
-    fprintf(f, "move_speed_slow=%g\n", camera.move_speed_slow);
-    fprintf(f, "font_size=%d\n", font_size);
-    fprintf(f, "dpi_scale=%d\n", dpi_scale);
-    fprintf(f, "can_idle=%d\n", can_idle);
-    fprintf(f, "auto_step_delay_ms=%d\n", auto_step_delay_ms);
+    std::string text;
+    std::string *f = &text;
+    Print(f, "[vdb]\n");
+    Print(f, "window_pos=%d,%d\n", window.x, window.y);
+    Print(f, "window_size=%d,%d\n", window.width, window.height);
+    Print(f, "never_ask_on_exit=%d\n", never_ask_on_exit);
+    Print(f, "show_main_menu=%d\n", show_main_menu);
+    Print(f, "mouse_sensitivity=%g\n", camera.mouse_sensitivity);
+    Print(f, "scroll_sensitivity=%g\n", camera.scroll_sensitivity);
+    Print(f, "move_speed_normal=%g\n", camera.move_speed_normal);
+    Print(f, "move_speed_slow=%g\n", camera.move_speed_slow);
+    Print(f, "font_size=%d\n", font_size);
+    Print(f, "dpi_scale=%d\n", dpi_scale);
+    Print(f, "can_idle=%d\n", can_idle);
+    Print(f, "auto_step_delay_ms=%d\n", auto_step_delay_ms);
+    Print(f, "target_fps=%d\n", target_fps);
     WriteTheme(f, "global_theme", global_theme);
-    for (int i = 0; i < num_frames; i++)
+    for (size_t i = 0; i < frames.size(); i++)
     {
-        frame_settings_t *frame = frames + i;
-        fprintf(f, "\n[frame]=%s\n", frame->name);
+        frame_settings_t *frame = frames[i];
+        Print(f, "\n[frame]=%s\n", frame->name);
 
         if (frame->camera.dirty)
         {
@@ -667,17 +772,17 @@ void settings_t::Save(const char *filename)
 
             if (frame->camera.planar.dirty)
             {
-                fprintf(f, "planar_position=%g,%g\n", frame->camera.planar.position.x, frame->camera.planar.position.y);
-                fprintf(f, "planar_zoom=%g\n", frame->camera.planar.zoom);
-                fprintf(f, "planar_angle=%g\n", frame->camera.planar.angle);
+                Print(f, "planar_position=%g,%g\n", frame->camera.planar.position.x, frame->camera.planar.position.y);
+                Print(f, "planar_zoom=%g\n", frame->camera.planar.zoom);
+                Print(f, "planar_angle=%g\n", frame->camera.planar.angle);
                 WriteCameraUp(f, "planar_up", frame->camera.planar.up);
             }
 
             if (frame->camera.turntable.dirty)
             {
-                fprintf(f, "turntable_angle_x=%g\n", frame->camera.turntable.angle_x);
-                fprintf(f, "turntable_angle_y=%g\n", frame->camera.turntable.angle_y);
-                fprintf(f, "turntable_radius=%g\n", frame->camera.turntable.radius);
+                Print(f, "turntable_angle_x=%g\n", frame->camera.turntable.angle_x);
+                Print(f, "turntable_angle_y=%g\n", frame->camera.turntable.angle_y);
+                Print(f, "turntable_radius=%g\n", frame->camera.turntable.radius);
                 WriteCameraUp(f, "turntable_up", frame->camera.turntable.up);
             }
 
@@ -685,32 +790,43 @@ void settings_t::Save(const char *filename)
             {
                 WriteMat4(f, "trackball_R", frame->camera.trackball.R);
                 WriteVec4(f, "trackball_T", frame->camera.trackball.T);
-                fprintf(f, "trackball_zoom=%g\n", frame->camera.trackball.zoom);
+                Print(f, "trackball_zoom=%g\n", frame->camera.trackball.zoom);
                 WriteCameraUp(f, "trackball_up", frame->camera.trackball.up);
             }
 
             if (frame->camera.projection.dirty)
             {
-                fprintf(f, "y_fov=%g\n", frame->camera.projection.y_fov);
-                fprintf(f, "min_depth=%g\n", frame->camera.projection.min_depth);
-                fprintf(f, "max_depth=%g\n", frame->camera.projection.max_depth);
+                Print(f, "y_fov=%g\n", frame->camera.projection.y_fov);
+                Print(f, "min_depth=%g\n", frame->camera.projection.min_depth);
+                Print(f, "max_depth=%g\n", frame->camera.projection.max_depth);
             }
         }
 
         if (frame->grid.dirty)
         {
-            fprintf(f, "grid_visible=%d\n", frame->grid.grid_visible ? 1 : 0);
-            fprintf(f, "grid_scale=%g\n", frame->grid.grid_scale);
-            fprintf(f, "cube_visible=%d\n", frame->grid.cube_visible ? 1 : 0);
+            Print(f, "grid_visible=%d\n", frame->grid.grid_visible ? 1 : 0);
+            Print(f, "grid_scale=%g\n", frame->grid.grid_scale);
+            Print(f, "cube_visible=%d\n", frame->grid.cube_visible ? 1 : 0);
         }
 
         if (frame->render_scaler.dirty)
         {
-            fprintf(f, "render_scale_down=%d\n", frame->render_scaler.down);
-            fprintf(f, "render_scale_up=%d\n", frame->render_scaler.up);
+            Print(f, "render_scale_down=%d\n", frame->render_scaler.down);
+            Print(f, "render_scale_up=%d\n", frame->render_scaler.up);
+            Print(f, "render_scale_adaptive=%d\n", frame->render_scaler.adaptive ? 1 : 0);
+            Print(f, "render_scale_budget_ms=%g\n", frame->render_scaler.budget_ms);
+        }
+
+        if (frame->breaks.dirty)
+        {
+            WriteBreakMode(f, "break_mode", frame->breaks.mode);
+            Print(f, "break_count=%d\n", frame->breaks.count);
+            Print(f, "break_log=\"%s\"\n", frame->breaks.log);
+            Print(f, "break_threshold=%g\n", frame->breaks.threshold);
+            Print(f, "break_direction=%d\n", frame->breaks.direction);
         }
 
         WriteWidgets(f, "widgets", frame->widgets);
     }
-    fclose(f);
+    settings_saver::Queue(filename, &text);
 }
@@ -0,0 +1,108 @@
+// Settings are saved on every step, so that they survive if the program
+// crashes or is killed. Save (settings.h) formats them in memory, and Queue
+// hands the text to a background thread, so stepping doesn't wait on the
+// disk. The thread writes a temporary file and renames it over the settings
+// file, so that a save cut short leaves the old file intact.
+//
+// Saves that are queued while one is written are coalesced (only the newest
+// text is written), and text that is the same as what was last written isn't
+// written again. Flush waits for the thread to finish (on quit and at exit).
+namespace settings_saver
+{
+    static SDL_Thread *thread;
+    static SDL_mutex *mutex;
+    static SDL_cond *work;
+    static SDL_cond *done;
+    static std::string pending_text; // newest text that the thread hasn't taken yet
+    static std::string pending_filename;
+    static bool has_pending;
+    static bool writing;
+
+    static bool WriteFile(const char *filename, const std::string &text)
+    {
+        std::string temp = std::string(filename) + ".tmp";
+        FILE *f = fopen(temp.c_str(), "wb");
+        if (!f)
+            return false;
+        bool ok = fwrite(text.data(), 1, text.size(), f) == text.size();
+        ok = fclose(f) == 0 && ok;
+        if (ok)
+        {
+            #ifdef _WIN32
+            ok = MoveFileExA(temp.c_str(), filename, MOVEFILE_REPLACE_EXISTING) != 0;
+            #else
+            ok = rename(temp.c_str(), filename) == 0;
+            #endif
+        }
+        if (!ok)
+            remove(temp.c_str());
+        return ok;
+    }
+
+    static int WriterThread(void *)
+    {
+        std::string text, filename;
+        std::string written_text, written_filename; // the last save that was written
+        SDL_LockMutex(mutex);
+        for (;;)
+        {
+            while (!has_pending)
+                SDL_CondWait(work, mutex);
+            text.swap(pending_text);
+            filename.swap(pending_filename);
+            has_pending = false;
+            writing = true;
+            SDL_UnlockMutex(mutex);
+
+            if (text != written_text || filename != written_filename)
+            {
+                if (WriteFile(filename.c_str(), text))
+                {
+                    written_text.swap(text);
+                    written_filename.swap(filename);
+                }
+                else
+                {
+                    fprintf(stderr, "Failed to save settings.\n");
+                }
+            }
+
+            SDL_LockMutex(mutex);
+            writing = false;
+            SDL_CondBroadcast(done);
+        }
+        return 0;
+    }
+
+    // Waits until the last queued save is written
+    static void Flush()
+    {
+        if (!thread)
+            return;
+        SDL_LockMutex(mutex);
+        while (has_pending || writing)
+            SDL_CondWait(done, mutex);
+        SDL_UnlockMutex(mutex);
+    }
+
+    // Takes the text (leaving it empty) and writes it to filename on the
+    // writer thread, replacing any save that is still queued
+    static void Queue(const char *filename, std::string *text)
+    {
+        if (!thread)
+        {
+            mutex = SDL_CreateMutex();
+            work = SDL_CreateCond();
+            done = SDL_CreateCond();
+            thread = SDL_CreateThread(WriterThread, "vdb settings", NULL);
+            assert(mutex && work && done && thread);
+            atexit(Flush);
+        }
+        SDL_LockMutex(mutex);
+        pending_text.swap(*text);
+        pending_filename = filename;
+        has_pending = true;
+        SDL_CondSignal(work);
+        SDL_UnlockMutex(mutex);
+    }
+}
@@ -94,6 +94,9 @@ static GLuint vdb_gl_shaders[vdb_max_shaders];
 bool vdbLoadShader(int slot, const char *user_fs_source)
 {
     assert(slot >= 0 && slot < vdb_max_shaders && "You are trying to set a pixel shader beyond the available number of slots.");
+    if (window::IsHeadless()) // shaders are not traced
+        return true;
+    GLCallSite(NULL);
 
     const char *vs_source =
         "#version 150\n"
@@ -136,7 +139,11 @@ bool vdbLoadShader(int slot, const char *user_fs_source)
 void vdbBeginShader(int slot)
 {
     assert(slot >= 0 && slot < vdb_max_shaders && "Attempted to use a shader slot outside the valid range.");
+    if (window::IsHeadless())
+        return;
+    GLCallSite(NULL);
     assert(glIsProgram(vdb_gl_shaders[slot]) && "Shader at specified slot is invalid.");
+    damage::Touch(); // uniforms and textures aren't hashed
     vdb_gl_current_program = vdb_gl_shaders[slot];
     glUseProgram(vdb_gl_shaders[slot]);
     float pvm[4*4]; vdbGetPVM(pvm);
@@ -150,6 +157,9 @@ void vdbBeginShader(int slot)
 
 void vdbEndShader()
 {
+    if (window::IsHeadless())
+        return;
+    GLCallSite(NULL);
     static GLuint vao = 0;
     static GLuint vbo = 0;
     if (!vao)
@@ -175,15 +185,28 @@ void vdbEndShader()
     glBindVertexArray(0);
     vdb_gl_current_program = 0;
 }
-void vdbUniform1f(const char *name, float x)                            { GLint program; glGetIntegerv(GL_CURRENT_PROGRAM, &program); glUniform1f(glGetUniformLocation(program, name), x);  AssertGL("vdbUniform1f failed with name '%s'\n", name); }
-void vdbUniform2f(const char *name, float x, float y)                   { GLint program; glGetIntegerv(GL_CURRENT_PROGRAM, &program); glUniform2f(glGetUniformLocation(program, name), x,y);  AssertGL("vdbUniform2f failed with name '%s'\n", name); }
-void vdbUniform3f(const char *name, float x, float y, float z)          { GLint program; glGetIntegerv(GL_CURRENT_PROGRAM, &program); glUniform3f(glGetUniformLocation(program, name), x,y,z);  AssertGL("vdbUniform3f failed with name '%s'\n", name); }
-void vdbUniform4f(const char *name, float x, float y, float z, float w) { GLint program; glGetIntegerv(GL_CURRENT_PROGRAM, &program); glUniform4f(glGetUniformLocation(program, name), x,y,z,w);  AssertGL("vdbUniform4f failed with name '%s'\n", name); }
-void vdbUniform1i(const char *name, int x)                              { GLint program; glGetIntegerv(GL_CURRENT_PROGRAM, &program); glUniform1i(glGetUniformLocation(program, name), x);  AssertGL("vdbUniform1i failed with name '%s'\n", name); }
-void vdbUniform2i(const char *name, int x, int y)                       { GLint program; glGetIntegerv(GL_CURRENT_PROGRAM, &program); glUniform2i(glGetUniformLocation(program, name), x,y);  AssertGL("vdbUniform2i failed with name '%s'\n", name); }
-void vdbUniform3i(const char *name, int x, int y, int z)                { GLint program; glGetIntegerv(GL_CURRENT_PROGRAM, &program); glUniform3i(glGetUniformLocation(program, name), x,y,z);  AssertGL("vdbUniform3i failed with name '%s'\n", name); }
-void vdbUniform4i(const char *name, int x, int y, int z, int w)         { GLint program; glGetIntegerv(GL_CURRENT_PROGRAM, &program); glUniform4i(glGetUniformLocation(program, name), x,y,z,w);  AssertGL("vdbUniform4i failed with name '%s'\n", name); }
-void vdbUniformMatrix4fv(const char *name, float *x)                    { GLint program; glGetIntegerv(GL_CURRENT_PROGRAM, &program); glUniformMatrix4fv(glGetUniformLocation(program, name), 1, false, x); AssertGL("vdbUniformMatrix4fv failed with name '%s'\n", name); }
-void vdbUniformMatrix3fv(const char *name, float *x)                    { GLint program; glGetIntegerv(GL_CURRENT_PROGRAM, &program); glUniformMatrix3fv(glGetUniformLocation(program, name), 1, false, x); AssertGL("vdbUniformMatrix3fv failed with name '%s'\n", name); }
-void vdbUniformMatrix4fv_RowMaj(const char *name, float *x)             { GLint program; glGetIntegerv(GL_CURRENT_PROGRAM, &program); glUniformMatrix4fv(glGetUniformLocation(program, name), 1, true, x); AssertGL("vdbUniformMatrix4fv_RowMaj failed with name '%s'\n", name); }
-void vdbUniformMatrix3fv_RowMaj(const char *name, float *x)             { GLint program; glGetIntegerv(GL_CURRENT_PROGRAM, &program); glUniformMatrix3fv(glGetUniformLocation(program, name), 1, true, x); AssertGL("vdbUniformMatrix3fv_RowMaj failed with name '%s'\n", name); }
+
+// Looks up a uniform of the current program, or returns false when there is
+// no OpenGL context to set it in (see window::IsHeadless)
+static bool FindUniform(const char *name, GLint *location)
+{
+    if (window::IsHeadless())
+        return false;
+    GLCallSite(name);
+    GLint program; glGetIntegerv(GL_CURRENT_PROGRAM, &program);
+    *location = glGetUniformLocation(program, name);
+    return true;
+}
+
+void vdbUniform1f(const char *name, float x)                            { GLint location; if (FindUniform(name, &location)) glUniform1f(location, x); }
+void vdbUniform2f(const char *name, float x, float y)                   { GLint location; if (FindUniform(name, &location)) glUniform2f(location, x,y); }
+void vdbUniform3f(const char *name, float x, float y, float z)          { GLint location; if (FindUniform(name, &location)) glUniform3f(location, x,y,z); }
+void vdbUniform4f(const char *name, float x, float y, float z, float w) { GLint location; if (FindUniform(name, &location)) glUniform4f(location, x,y,z,w); }
+void vdbUniform1i(const char *name, int x)                              { GLint location; if (FindUniform(name, &location)) glUniform1i(location, x); }
+void vdbUniform2i(const char *name, int x, int y)                       { GLint location; if (FindUniform(name, &location)) glUniform2i(location, x,y); }
+void vdbUniform3i(const char *name, int x, int y, int z)                { GLint location; if (FindUniform(name, &location)) glUniform3i(location, x,y,z); }
+void vdbUniform4i(const char *name, int x, int y, int z, int w)         { GLint location; if (FindUniform(name, &location)) glUniform4i(location, x,y,z,w); }
+void vdbUniformMatrix4fv(const char *name, float *x)                    { GLint location; if (FindUniform(name, &location)) glUniformMatrix4fv(location, 1, false, x); }
+void vdbUniformMatrix3fv(const char *name, float *x)                    { GLint location; if (FindUniform(name, &location)) glUniformMatrix3fv(location, 1, false, x); }
+void vdbUniformMatrix4fv_RowMaj(const char *name, float *x)             { GLint location; if (FindUniform(name, &location)) glUniformMatrix4fv(location, 1, true, x); }
+void vdbUniformMatrix3fv_RowMaj(const char *name, float *x)             { GLint location; if (FindUniform(name, &location)) glUniformMatrix3fv(location, 1, true, x); }
@@ -109,7 +109,7 @@ namespace sketch_mode
                 float dy2 = new_y - begin_y;
                 float dx3 = new_x - prev_x;
                 float dy3 = new_y - prev_y;
-                float speed = sqrtf(dx3*dx3 + dy3*dy3) / (1.0f/60.0f);
+                float speed = sqrtf(dx3*dx3 + dy3*dy3) / frame_clock::delta;
                 float delta = (dx1*dx2 + dy1*dy2) / sqrtf(dx1*dx1 + dy1*dy1);
                 float threshold = sqrtf(speed)/1.5f;
                 if (threshold < 2.0f) threshold = 2.0f;
@@ -0,0 +1,371 @@
+// A minimal PNG writer that accepts the image one row at a time, such that
+// the full image never has to be in memory. stb_image_write requires the
+// whole image up-front (and compresses it in memory), so we write the pixel
+// data as uncompressed (stored) deflate blocks instead. Each block becomes
+// its own IDAT chunk, which is valid since the zlib stream may be split at
+// arbitrary points between chunks. The files are larger than stb's, but can
+// be recompressed by any image tool afterwards.
+namespace png_stream
+{
+    enum { max_block_size = 65535 }; // maximum length of a stored deflate block
+    enum { block_header_size = 2+5 }; // zlib header + stored block header
+
+    struct png_stream_t
+    {
+        FILE *f;
+        unsigned int adler_a;
+        unsigned int adler_b;
+        unsigned char *buffer; // block_header_size + max_block_size + 4 (adler32)
+        int block_used;
+        bool wrote_zlib_header;
+    };
+
+    static unsigned int Crc32(unsigned int crc, const unsigned char *data, size_t n)
+    {
+        static unsigned int table[256];
+        static bool has_table = false;
+        if (!has_table)
+        {
+            for (unsigned int i = 0; i < 256; i++)
+            {
+                unsigned int c = i;
+                for (int k = 0; k < 8; k++)
+                    c = (c & 1) ? (0xedb88320u ^ (c >> 1)) : (c >> 1);
+                table[i] = c;
+            }
+            has_table = true;
+        }
+        for (size_t i = 0; i < n; i++)
+            crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+        return crc;
+    }
+
+    static void PutU32(unsigned char *p, unsigned int x)
+    {
+        p[0] = (unsigned char)(x >> 24);
+        p[1] = (unsigned char)(x >> 16);
+        p[2] = (unsigned char)(x >> 8);
+        p[3] = (unsigned char)(x);
+    }
+
+    static void WriteChunk(FILE *f, const char *type, const unsigned char *data, unsigned int n)
+    {
+        unsigned char header[8];
+        PutU32(header, n);
+        memcpy(header + 4, type, 4);
+        unsigned int crc = Crc32(0xffffffffu, header + 4, 4);
+        crc = Crc32(crc, data, n) ^ 0xffffffffu;
+        unsigned char footer[4];
+        PutU32(footer, crc);
+        fwrite(header, 1, sizeof(header), f);
+        if (n > 0)
+            fwrite(data, 1, n, f);
+        fwrite(footer, 1, sizeof(footer), f);
+    }
+
+    static void FlushBlock(png_stream_t *png, bool final)
+    {
+        unsigned char *p = png->buffer;
+        int n = png->block_used;
+        int begin = 2;
+        if (!png->wrote_zlib_header)
+        {
+            p[0] = 0x78; // deflate, 32K window
+            p[1] = 0x01; // no preset dictionary, fastest compression (FCHECK makes 0x7801 divisible by 31)
+            begin = 0;
+            png->wrote_zlib_header = true;
+        }
+        p[2] = final ? 1 : 0; // BFINAL, BTYPE=00 (stored)
+        p[3] = (unsigned char)(n & 0xff);
+        p[4] = (unsigned char)((n >> 8) & 0xff);
+        p[5] = (unsigned char)(~n & 0xff);
+        p[6] = (unsigned char)((~n >> 8) & 0xff);
+        int end = block_header_size + n;
+        if (final)
+        {
+            PutU32(p + end, (png->adler_b << 16) | png->adler_a);
+            end += 4;
+        }
+        WriteChunk(png->f, "IDAT", p + begin, (unsigned int)(end - begin));
+        png->block_used = 0;
+    }
+
+    static void Write(png_stream_t *png, const unsigned char *data, size_t n)
+    {
+        while (n > 0)
+        {
+            size_t count = max_block_size - png->block_used;
+            if (count > n)
+                count = n;
+            memcpy(png->buffer + block_header_size + png->block_used, data, count);
+
+            // Adler-32 (5552 is the largest count for which b does not overflow before the modulo)
+            for (size_t i = 0; i < count; )
+            {
+                size_t end = i + 5552 < count ? i + 5552 : count;
+                for (; i < end; i++)
+                {
+                    png->adler_a += data[i];
+                    png->adler_b += png->adler_a;
+                }
+                png->adler_a %= 65521;
+                png->adler_b %= 65521;
+            }
+
+            png->block_used += (int)count;
+            data += count;
+            n -= count;
+            if (png->block_used == max_block_size)
+                FlushBlock(png, false);
+        }
+    }
+
+    static bool Open(png_stream_t *png, const char *filename, int width, int height)
+    {
+        memset(png, 0, sizeof(*png));
+        png->f = fopen(filename, "wb");
+        if (!png->f)
+        {
+            fprintf(stderr, "Failed to open '%s' for writing\n", filename);
+            return false;
+        }
+        png->buffer = (unsigned char*)malloc(block_header_size + max_block_size + 4);
+        assert(png->buffer);
+        png->adler_a = 1;
+        png->adler_b = 0;
+
+        static const unsigned char signature[] = { 137, 80, 78, 71, 13, 10, 26, 10 };
+        fwrite(signature, 1, sizeof(signature), png->f);
+
+        unsigned char ihdr[13];
+        PutU32(ihdr + 0, (unsigned int)width);
+        PutU32(ihdr + 4, (unsigned int)height);
+        ihdr[8] = 8;  // bit depth
+        ihdr[9] = 6;  // color type: RGBA
+        ihdr[10] = 0; // compression: deflate
+        ihdr[11] = 0; // filter method: adaptive
+        ihdr[12] = 0; // no interlacing
+        WriteChunk(png->f, "IHDR", ihdr, sizeof(ihdr));
+        return true;
+    }
+
+    // Rows must be written from top to bottom
+    static void WriteRow(png_stream_t *png, const unsigned char *rgba, int width)
+    {
+        static const unsigned char filter_none = 0;
+        Write(png, &filter_none, 1);
+        Write(png, rgba, (size_t)width*4);
+    }
+
+    static void Close(png_stream_t *png)
+    {
+        FlushBlock(png, true);
+        WriteChunk(png->f, "IEND", NULL, 0);
+        fclose(png->f);
+        free(png->buffer);
+        png->f = NULL;
+        png->buffer = NULL;
+    }
+}
+
+// The tiled screenshot renders an image whose resolution can exceed both
+// the window and the maximum framebuffer size supported by the driver. The
+// block is re-rendered once per tile over the following frames, each time
+// with a projection that maps one tile of the view frustum onto the whole
+// (tile-sized) framebuffer. Here for example is a 3x3 tiling:
+//                  ________________________
+//                 | (0,0)  | (1,0)  | (2,0)  |
+//                 |--------+--------+--------|
+//                 | (0,1)  | (1,1)  | (2,1)  |
+//                 |--------+--------+--------|
+//                 | (0,2)  | (1,2)  | (2,2)  |
+//                  ------------------------
+// All tiles are tile_width x tile_height pixels and start at multiples of
+// that size, so each covers an exact pixel span of the image (the last row
+// and column extend past it, and the extra pixels are dropped). The tile
+// projection maps that span of the full view onto the tile framebuffer, and
+// is left-multiplied onto the user's projection (see transform::tile). Like
+// vdbPerspective's x_offset/y_offset and the render scaler's ndc_offset, the
+// shift is applied in clip space (i.e. scaled by w) so it is independent of
+// depth and works for both orthographic and perspective projections. Tiles
+// are read back into a buffer holding one row of tiles, which is appended to
+// the PNG file as soon as the row is complete.
+// Peak memory is therefore one row of tiles rather than the full image.
+namespace tiled_screenshot
+{
+    static bool active;
+    static bool tile_begun;
+    static png_stream::png_stream_t png;
+    static framebuffer_t tile;
+    static unsigned char *strip; // one row of tiles, bottom-up as read by glReadPixels
+    static int width, height; // resolution of output image
+    static int tile_width, tile_height;
+    static int num_tiles; // along each axis (tiles have the same aspect ratio as the image)
+    static int tile_x, tile_y; // index of the tile being rendered, (0,0) is upper-left
+
+    static void Start(const char *filename, int w, int h)
+    {
+        if (active)
+        {
+            fprintf(stderr, "Ignoring vdbSaveScreenshotTiled(\"%s\"): a tiled screenshot is already in progress\n", filename);
+            return;
+        }
+        assert(w > 0 && h > 0 && "Screenshot dimensions must be positive");
+
+        GLint max_renderbuffer_size; glGetIntegerv(GL_MAX_RENDERBUFFER_SIZE, &max_renderbuffer_size);
+        GLint max_texture_size; glGetIntegerv(GL_MAX_TEXTURE_SIZE, &max_texture_size);
+        int max_tile_size = VDB_SCREENSHOT_TILE_SIZE;
+        if (max_tile_size > max_renderbuffer_size) max_tile_size = max_renderbuffer_size;
+        if (max_tile_size > max_texture_size) max_tile_size = max_texture_size;
+
+        int nx = (w + max_tile_size - 1)/max_tile_size;
+        int ny = (h + max_tile_size - 1)/max_tile_size;
+        num_tiles = nx > ny ? nx : ny;
+        tile_width = (w + num_tiles - 1)/num_tiles;
+        tile_height = (h + num_tiles - 1)/num_tiles;
+        width = w;
+        height = h;
+
+        strip = (unsigned char*)malloc((size_t)num_tiles*tile_width*tile_height*4);
+        if (!strip)
+        {
+            fprintf(stderr, "Failed to allocate memory for tiled screenshot (%dx%d)\n", w, h);
+            return;
+        }
+        if (!png_stream::Open(&png, filename, w, h))
+        {
+            free(strip);
+            strip = NULL;
+            return;
+        }
+
+        tile_x = 0;
+        tile_y = 0;
+        active = true;
+        window::DontWaitNextFrameEvents();
+    }
+
+    static void Finish()
+    {
+        png_stream::Close(&png);
+        FreeFramebuffer(&tile);
+        free(strip);
+        strip = NULL;
+        active = false;
+    }
+
+    // Called in vdbBeginBreak after the window framebuffer is cleared
+    static void BeginTile()
+    {
+        if (!active)
+            return;
+
+        // The view must stay fixed until all tiles are rendered
+        mouse::wheel = 0.0f;
+        mouse::left.pressed = mouse::left.released = mouse::left.down = false;
+        mouse::right.pressed = mouse::right.released = mouse::right.down = false;
+        mouse::middle.pressed = mouse::middle.released = mouse::middle.down = false;
+        memset(keys::pressed, 0, sizeof(keys::pressed));
+        memset(keys::down, 0, sizeof(keys::down));
+
+        if (tile.width != tile_width || tile.height != tile_height)
+        {
+            FreeFramebuffer(&tile);
+            tile = MakeFramebuffer(tile_width, tile_height, GL_LINEAR, GL_LINEAR, true);
+        }
+
+        EnableFramebuffer(&tile);
+        {
+            GLboolean depth_test = glIsEnabled(GL_DEPTH_TEST);
+            GLboolean depth_mask; glGetBooleanv(GL_DEPTH_WRITEMASK, &depth_mask);
+            vdbDepthWrite(true);
+            vdbDepthTest(true);
+            glClear(GL_COLOR_BUFFER_BIT|GL_DEPTH_BUFFER_BIT);
+            vdbDepthWrite(depth_mask);
+            vdbDepthTest(depth_test);
+        }
+
+        // Map the tile's pixels [x0, x0+tile_width) x [y0, y0+tile_height) of the
+        // full image (y0 counted from the top) onto the tile framebuffer. The
+        // last row and column of tiles extend past the image; that part is left
+        // empty and cropped when the rows are written.
+        int x0 = tile_x*tile_width;
+        int y0 = tile_y*tile_height;
+        float sx = (float)width/tile_width;
+        float sy = (float)height/tile_height;
+        float ndc_x0 = -1.0f + 2.0f*x0/width;
+        float ndc_y0 = +1.0f - 2.0f*y0/height;
+        vdbMat4 m = vdbMatIdentity();
+        m(0,0) = sx;
+        m(1,1) = sy;
+        m(0,3) = -sx*ndc_x0 - 1.0f;
+        m(1,3) = -sy*ndc_y0 + 1.0f;
+        transform::SetTile(m);
+
+        tile_begun = true;
+    }
+
+    // Called in vdbEndBreak before vdb draws its own overlays (grid, etc.)
+    static void EndTile()
+    {
+        if (!tile_begun)
+            return;
+        tile_begun = false;
+        transform::SetTile(vdbMatIdentity());
+
+        // read tile into its column of the strip
+        {
+            GLint pack_alignment; glGetIntegerv(GL_PACK_ALIGNMENT, &pack_alignment);
+            GLint pack_row_length; glGetIntegerv(GL_PACK_ROW_LENGTH, &pack_row_length);
+            glPixelStorei(GL_PACK_ALIGNMENT, 1);
+            glPixelStorei(GL_PACK_ROW_LENGTH, num_tiles*tile_width);
+            glReadBuffer(GL_COLOR_ATTACHMENT0);
+            int x0 = tile_x*tile_width;
+            int span = width - x0 < tile_width ? width - x0 : tile_width; // [x0, min(x0+tile_width, width))
+            if (span > 0) // a very tall image can leave the last column of tiles empty
+                glReadPixels(0, 0, span, tile_height, GL_RGBA, GL_UNSIGNED_BYTE, strip + 4*x0);
+            glPixelStorei(GL_PACK_ALIGNMENT, pack_alignment);
+            glPixelStorei(GL_PACK_ROW_LENGTH, pack_row_length);
+        }
+        DisableFramebuffer(&tile);
+
+        // show the tile at its location in the window as progress feedback
+        {
+            int w = window::framebuffer_width;
+            int h = window::framebuffer_height;
+            int x0 = (int)((int64_t)tile_x*tile_width*w/width);
+            int y1 = (int)((int64_t)(tile_y + 1)*tile_height*h/height);
+            vdbViewporti(x0, h - y1, (int)((int64_t)tile_width*w/width), (int)((int64_t)tile_height*h/height));
+            vdbBlendNone();
+            vdbDepthTest(false);
+            DrawRenderTargetWithDepth(tile, VDB_LINEAR, VDB_CLAMP);
+            vdbViewporti(0, 0, w, h);
+        }
+
+        tile_x++;
+        if (tile_x == num_tiles)
+        {
+            // crop to the output resolution (the last tiles cover a few extra pixels)
+            size_t stride = 4*(size_t)num_tiles*tile_width;
+            for (int row = tile_height - 1; row >= 0; row--)
+            {
+                int y = tile_y*tile_height + (tile_height - 1 - row);
+                if (y < height)
+                    png_stream::WriteRow(&png, strip + row*stride, width);
+            }
+            tile_x = 0;
+            tile_y++;
+            if (tile_y == num_tiles)
+                Finish();
+        }
+
+        window::DontWaitNextFrameEvents();
+    }
+}
+
+void vdbSaveScreenshotTiled(const char *filename, int width, int height)
+{
+    if (window::IsHeadless()) // not traced
+        return;
+    tiled_screenshot::Start(filename, width, height);
+}
@@ -0,0 +1,546 @@
+// Trace files (vdbTraceRecord, vdbTraceLoad). While a trace is recorded there
+// is no window or OpenGL context (see window::headless): every break runs
+// once, its drawing is recorded like in the breakpoint history (history.h),
+// and then appended to the file, along with the images loaded, the values of
+// the widgets and, when the program exits, the log tree. Loading a trace puts
+// its hits in the breakpoint history, to be looked through in Tools > History
+// (tools/vdbreplay is a small program that does just that).
+//
+// Layout (native byte order, checked on load):
+//     trace_file_header_t
+//     chunks, each a trace_chunk_t followed by its payload, aligned to 16 bytes:
+//         blob   vertices or text, referred to by index by the commands of frames
+//         image  trace_image_t followed by the pixels
+//         frame  trace_frame_t, num_cmds trace_cmd_t and the label
+//         logs   a log file (see log_file.h)
+// A blob that is equal to one of the previous hit is not written again, so
+// geometry that doesn't change between hits is stored once. A trace that was
+// cut short (e.g. by a crash) is read up to its last complete chunk.
+//
+// The same chunks are sent to a viewer process by vdbRemote (see remote.h),
+// one hit per message.
+//
+// Custom shaders, render targets and volume images are not recorded.
+
+struct trace_file_header_t
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+};
+
+enum trace_chunk_type_t
+{
+    trace_chunk_blob = 0,
+    trace_chunk_image,
+    trace_chunk_frame,
+    trace_chunk_logs
+};
+
+struct trace_chunk_t
+{
+    uint32_t type;
+    uint32_t index; // of a blob
+    uint64_t size; // of the payload, excluding padding
+};
+
+struct trace_image_t
+{
+    int32_t slot;
+    int32_t width, height;
+    int32_t channels;
+    int32_t is_float;
+    int32_t reserved;
+};
+
+struct trace_frame_t
+{
+    int32_t hit;
+    uint32_t num_cmds;
+    uint32_t label_size; // including the terminating zero
+    uint32_t reserved;
+};
+
+// history_cmd_t with fixed-size fields
+struct trace_cmd_t
+{
+    int32_t type;
+    int32_t prim_type;
+    int32_t image;
+    uint32_t blend_src_rgb, blend_dst_rgb, blend_src_alpha, blend_dst_alpha;
+    uint32_t blend_equation_rgb, blend_equation_alpha;
+    uint32_t depth_func;
+    float line_width;
+    float point_size;
+    int32_t point_segments;
+    float projection[16];
+    float view_model[16];
+    float pvm[16];
+    int32_t viewport[4];
+    int32_t filter, wrap;
+    float v_min[4], v_max[4];
+    float x, y, w, h;
+    uint32_t count;
+    uint32_t blob; // index of the blob, or no_blob
+    uint8_t depth_writemask, enable_blend, enable_cull_face, enable_depth_test;
+    uint8_t enable_scissor_test, enable_color_logic_op, line_width_is_3D, point_size_is_3D;
+    uint8_t texel_specified, is_mono;
+    uint8_t reserved[6];
+};
+
+namespace trace
+{
+    static const char magic[8] = { 'v','d','b','t','r','a','c','e' };
+    enum { version = 2, byte_order = 0x01020304 };
+    static const uint32_t no_blob = 0xffffffff;
+
+    struct written_blob_t
+    {
+        uint32_t index;
+        size_t offset, size; // of the copy in written_t::data
+    };
+
+    // The blobs written for a hit, to compare the next hit's against
+    struct written_t
+    {
+        std::unordered_map<uint64_t, written_blob_t> blobs;
+        std::vector<char> data;
+    };
+
+    static FILE *file;
+    static std::vector<char> *out; // written to instead of the file, if set (see remote.h)
+    static uint64_t offset; // of the end of the file (or out)
+    static uint32_t num_blobs;
+    static int hits;
+    static written_t prev, curr;
+
+    static void Write(const void *data, size_t size)
+    {
+        if (out) out->insert(out->end(), (const char*)data, (const char*)data + size);
+        else     fwrite(data, 1, size, file);
+        offset += size;
+    }
+
+    static void BeginChunk(trace_chunk_type_t type, uint64_t size, uint32_t index=0)
+    {
+        trace_chunk_t chunk;
+        memset(&chunk, 0, sizeof(chunk));
+        chunk.type = type;
+        chunk.index = index;
+        chunk.size = size;
+        Write(&chunk, sizeof(chunk));
+    }
+
+    static void EndChunk()
+    {
+        static const char zeros[16] = {0};
+        Write(zeros, (size_t)((16 - offset % 16) % 16));
+    }
+
+    static bool Equal(written_t &w, written_blob_t &b, const void *data, size_t size)
+    {
+        return b.size == size && memcmp(&w.data[b.offset], data, size) == 0;
+    }
+
+    static void Remember(uint64_t hash, uint32_t index, const void *data, size_t size)
+    {
+        written_blob_t b;
+        b.index = index;
+        b.offset = curr.data.size();
+        b.size = size;
+        curr.data.insert(curr.data.end(), (const char*)data, (const char*)data + size);
+        curr.blobs.insert(std::make_pair(hash, b));
+    }
+
+    // Returns the index of the blob with this content, writing it if needed
+    static uint32_t WriteBlob(const void *data, size_t size)
+    {
+        uint64_t hash = history::Hash(data, size);
+        std::unordered_map<uint64_t, written_blob_t>::iterator it = curr.blobs.find(hash);
+        if (it != curr.blobs.end() && Equal(curr, it->second, data, size))
+            return it->second.index;
+        it = prev.blobs.find(hash);
+        if (it != prev.blobs.end() && Equal(prev, it->second, data, size))
+        {
+            Remember(hash, it->second.index, data, size);
+            return it->second.index;
+        }
+        BeginChunk(trace_chunk_blob, size, num_blobs);
+        Write(data, size);
+        EndChunk();
+        Remember(hash, num_blobs, data, size);
+        return num_blobs++;
+    }
+
+    // The next hit doesn't refer to blobs written before, e.g. because the
+    // reader may not have received them
+    static void ResetBlobs()
+    {
+        prev.blobs.clear();
+        prev.data.clear();
+        curr.blobs.clear();
+        curr.data.clear();
+    }
+
+    static trace_cmd_t ToTrace(history_cmd_t &cmd)
+    {
+        trace_cmd_t t;
+        memset(&t, 0, sizeof(t));
+        t.type = cmd.type;
+        t.prim_type = cmd.prim_type;
+        t.image = cmd.image;
+        t.blend_src_rgb = cmd.state.blend_src_rgb;
+        t.blend_dst_rgb = cmd.state.blend_dst_rgb;
+        t.blend_src_alpha = cmd.state.blend_src_alpha;
+        t.blend_dst_alpha = cmd.state.blend_dst_alpha;
+        t.blend_equation_rgb = cmd.state.blend_equation_rgb;
+        t.blend_equation_alpha = cmd.state.blend_equation_alpha;
+        t.depth_func = cmd.state.depth_func;
+        t.line_width = cmd.state.line_width;
+        t.point_size = cmd.state.point_size;
+        t.point_segments = cmd.state.point_segments;
+        memcpy(t.projection, cmd.projection.data, sizeof(t.projection));
+        memcpy(t.view_model, cmd.view_model.data, sizeof(t.view_model));
+        memcpy(t.pvm, cmd.pvm, sizeof(t.pvm));
+        memcpy(t.viewport, cmd.viewport, sizeof(t.viewport));
+        t.filter = cmd.filter;
+        t.wrap = cmd.wrap;
+        t.v_min[0] = cmd.v_min.x; t.v_min[1] = cmd.v_min.y; t.v_min[2] = cmd.v_min.z; t.v_min[3] = cmd.v_min.w;
+        t.v_max[0] = cmd.v_max.x; t.v_max[1] = cmd.v_max.y; t.v_max[2] = cmd.v_max.z; t.v_max[3] = cmd.v_max.w;
+        t.x = cmd.x; t.y = cmd.y; t.w = cmd.w; t.h = cmd.h;
+        t.count = (uint32_t)cmd.count;
+        t.blob = no_blob;
+        t.depth_writemask = cmd.state.depth_writemask;
+        t.enable_blend = cmd.state.enable_blend;
+        t.enable_cull_face = cmd.state.enable_cull_face;
+        t.enable_depth_test = cmd.state.enable_depth_test;
+        t.enable_scissor_test = cmd.state.enable_scissor_test;
+        t.enable_color_logic_op = cmd.state.enable_color_logic_op;
+        t.line_width_is_3D = cmd.state.line_width_is_3D;
+        t.point_size_is_3D = cmd.state.point_size_is_3D;
+        t.texel_specified = cmd.texel_specified;
+        t.is_mono = cmd.is_mono;
+        return t;
+    }
+
+    static history_cmd_t FromTrace(trace_cmd_t &t)
+    {
+        history_cmd_t cmd;
+        memset(&cmd, 0, sizeof(cmd));
+        cmd.type = (history_cmd_type_t)t.type;
+        cmd.prim_type = (imm_prim_type_t)t.prim_type;
+        cmd.image = t.image;
+        cmd.list = -1;
+        cmd.state.blend_src_rgb = t.blend_src_rgb;
+        cmd.state.blend_dst_rgb = t.blend_dst_rgb;
+        cmd.state.blend_src_alpha = t.blend_src_alpha;
+        cmd.state.blend_dst_alpha = t.blend_dst_alpha;
+        cmd.state.blend_equation_rgb = t.blend_equation_rgb;
+        cmd.state.blend_equation_alpha = t.blend_equation_alpha;
+        cmd.state.depth_func = t.depth_func;
+        cmd.state.line_width = t.line_width;
+        cmd.state.point_size = t.point_size;
+        cmd.state.point_segments = t.point_segments;
+        memcpy(cmd.projection.data, t.projection, sizeof(t.projection));
+        memcpy(cmd.view_model.data, t.view_model, sizeof(t.view_model));
+        memcpy(cmd.pvm, t.pvm, sizeof(t.pvm));
+        memcpy(cmd.viewport, t.viewport, sizeof(t.viewport));
+        cmd.filter = t.filter;
+        cmd.wrap = t.wrap;
+        cmd.v_min = vdbVec4(t.v_min[0], t.v_min[1], t.v_min[2], t.v_min[3]);
+        cmd.v_max = vdbVec4(t.v_max[0], t.v_max[1], t.v_max[2], t.v_max[3]);
+        cmd.x = t.x; cmd.y = t.y; cmd.w = t.w; cmd.h = t.h;
+        cmd.count = t.count;
+        cmd.state.depth_writemask = t.depth_writemask;
+        cmd.state.enable_blend = t.enable_blend;
+        cmd.state.enable_cull_face = t.enable_cull_face;
+        cmd.state.enable_depth_test = t.enable_depth_test;
+        cmd.state.enable_scissor_test = t.enable_scissor_test;
+        cmd.state.enable_color_logic_op = t.enable_color_logic_op;
+        cmd.state.line_width_is_3D = t.line_width_is_3D != 0;
+        cmd.state.point_size_is_3D = t.point_size_is_3D != 0;
+        cmd.texel_specified = t.texel_specified != 0;
+        cmd.is_mono = t.is_mono != 0;
+        return cmd;
+    }
+
+    // Called by vdbLoadImage* while recording
+    static void WriteImage(int slot, const void *data, int width, int height, int channels, bool is_float)
+    {
+        if (!file && !out)
+            return;
+        trace_image_t image;
+        memset(&image, 0, sizeof(image));
+        image.slot = slot;
+        image.width = width;
+        image.height = height;
+        image.channels = channels;
+        image.is_float = is_float ? 1 : 0;
+        size_t size = (size_t)width*height*channels*(is_float ? sizeof(float) : 1);
+        BeginChunk(trace_chunk_image, sizeof(image) + size);
+        Write(&image, sizeof(image));
+        Write(data, size);
+        EndChunk();
+    }
+
+    // Writes the frame recorded by the history, when the break has ended
+    static void WriteFrame(const char *label)
+    {
+        if (!file && !out)
+            return;
+        std::vector<trace_cmd_t> cmds(history::cmds.size());
+        for (size_t i = 0; i < cmds.size(); i++)
+        {
+            history_cmd_t &cmd = history::cmds[i];
+            cmds[i] = ToTrace(cmd);
+            if (cmd.list >= 0)
+                cmds[i].blob = WriteBlob(history::list_vertices[cmd.list].data(), cmd.count*sizeof(imm_vertex_t));
+            else if (cmd.type != history_cmd_clear && cmd.type != history_cmd_image)
+                cmds[i].blob = WriteBlob(&history::arena[cmd.offset], cmd.size);
+        }
+        history::cmds.clear();
+        history::arena.clear();
+
+        trace_frame_t frame;
+        memset(&frame, 0, sizeof(frame));
+        frame.hit = hits++;
+        frame.num_cmds = (uint32_t)cmds.size();
+        frame.label_size = (uint32_t)strlen(label) + 1;
+        BeginChunk(trace_chunk_frame, sizeof(frame) + cmds.size()*sizeof(trace_cmd_t) + frame.label_size);
+        Write(&frame, sizeof(frame));
+        Write(cmds.data(), cmds.size()*sizeof(trace_cmd_t));
+        Write(label, frame.label_size);
+        EndChunk();
+
+        std::swap(prev, curr);
+        curr.blobs.clear();
+        curr.data.clear();
+    }
+
+    // Writes the log tree and closes the file (at exit)
+    static void Close()
+    {
+        if (!file)
+            return;
+        log_stream::TakeOwnershipIfNone();
+        uint64_t chunk_offset = offset;
+        BeginChunk(trace_chunk_logs, 0); // the size is filled in below
+        uint64_t size = log_file::Write(file, offset);
+        offset += size;
+        EndChunk();
+        trace_chunk_t chunk;
+        memset(&chunk, 0, sizeof(chunk));
+        chunk.type = trace_chunk_logs;
+        chunk.size = size;
+        log_spill::Seek(file, chunk_offset);
+        fwrite(&chunk, sizeof(chunk), 1, file);
+        if (ferror(file))
+            fprintf(stderr, "Failed to write trace file\n");
+        fclose(file);
+        file = NULL;
+    }
+
+    static bool Open(const char *filename)
+    {
+        file = fopen(filename, "wb");
+        if (!file)
+        {
+            fprintf(stderr, "Failed to open %s for writing\n", filename);
+            return false;
+        }
+        trace_file_header_t header;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, magic, sizeof(magic));
+        header.version = version;
+        header.byte_order = byte_order;
+        offset = 0;
+        Write(&header, sizeof(header));
+        atexit(Close);
+        return true;
+    }
+
+    // Turns chunks back into history frames. Blob indices refer to the blobs
+    // of the chunk's own hit or of the previous one, which are kept referenced.
+    struct reader_t
+    {
+        std::unordered_map<uint32_t, history_blob_t*> blobs;
+
+        history_blob_t *Find(uint32_t index)
+        {
+            std::unordered_map<uint32_t, history_blob_t*>::iterator it = blobs.find(index);
+            return it != blobs.end() ? it->second : NULL;
+        }
+
+        void Release()
+        {
+            std::unordered_map<uint32_t, history_blob_t*>::iterator it;
+            for (it = blobs.begin(); it != blobs.end(); ++it)
+                history::ReleaseBlob(it->second);
+            blobs.clear();
+        }
+
+        bool Image(const char *data, uint64_t size)
+        {
+            trace_image_t image;
+            if (size < sizeof(image))
+                return false;
+            memcpy(&image, data, sizeof(image));
+            size_t element = image.is_float ? sizeof(float) : 1;
+            if (image.slot < 0 || image.slot >= MAX_IMAGES ||
+                image.channels < 1 || image.channels > 4 ||
+                image.width <= 0 || image.height <= 0 ||
+                size != sizeof(image) + (uint64_t)image.width*image.height*image.channels*element)
+                return false;
+            if (image.is_float) vdbLoadImageFloat32(image.slot, data + sizeof(image), image.width, image.height, image.channels);
+            else                vdbLoadImageUint8(image.slot, data + sizeof(image), image.width, image.height, image.channels);
+            return true;
+        }
+
+        bool Frame(const char *data, uint64_t size)
+        {
+            trace_frame_t t;
+            if (size < sizeof(t))
+                return false;
+            memcpy(&t, data, sizeof(t));
+            if (t.label_size == 0 || size != sizeof(t) + (uint64_t)t.num_cmds*sizeof(trace_cmd_t) + t.label_size)
+                return false;
+            const char *label = data + sizeof(t) + t.num_cmds*sizeof(trace_cmd_t);
+            if (label[t.label_size - 1] != '\0')
+                return false;
+
+            history_frame_t *frame = new history_frame_t;
+            frame->label = intern::Intern(label);
+            frame->hit = t.hit;
+            std::unordered_map<uint32_t, history_blob_t*> used;
+            bool valid = true;
+            for (uint32_t i = 0; i < t.num_cmds && valid; i++)
+            {
+                trace_cmd_t tc;
+                memcpy(&tc, data + sizeof(t) + i*sizeof(trace_cmd_t), sizeof(tc));
+                history_cmd_t cmd = FromTrace(tc);
+                bool has_blob = cmd.type != history_cmd_clear && cmd.type != history_cmd_image;
+                valid = cmd.type >= history_cmd_clear && cmd.type <= history_cmd_widgets &&
+                        cmd.image >= -1 && cmd.image < MAX_IMAGES &&
+                        (!has_blob || Find(tc.blob));
+                if (!valid) break;
+                if (has_blob)
+                {
+                    cmd.blob = Find(tc.blob);
+                    if (cmd.type == history_cmd_draw)
+                        valid = cmd.blob->size == cmd.count*sizeof(imm_vertex_t) && cmd.prim_type >= IMM_PRIM_POINTS && cmd.prim_type <= IMM_PRIM_TRIANGLES;
+                    else
+                        valid = cmd.blob->size > 0 && cmd.blob->Data()[cmd.blob->size - 1] == '\0';
+                    if (!valid) break;
+                    cmd.blob->refs++;
+                    used[tc.blob] = cmd.blob;
+                }
+                if (cmd.image >= 0 && !images[cmd.image].volume)
+                    cmd.texture = images[cmd.image].handle;
+                frame->cmds.push_back(cmd);
+            }
+            if (!valid)
+            {
+                for (size_t i = 0; i < frame->cmds.size(); i++)
+                    if (frame->cmds[i].blob)
+                        history::ReleaseBlob(frame->cmds[i].blob);
+                delete frame;
+                return false;
+            }
+            history::AddFrame(frame);
+
+            // the next hit may only refer to the blobs of this one
+            std::unordered_map<uint32_t, history_blob_t*>::iterator it;
+            for (it = used.begin(); it != used.end(); ++it)
+                it->second->refs++;
+            Release();
+            blobs.swap(used);
+            return true;
+        }
+
+        // Returns false if the chunk is invalid
+        bool Chunk(const trace_chunk_t &chunk, const char *data)
+        {
+            if (chunk.type == trace_chunk_blob)
+            {
+                history_blob_t *&b = blobs[chunk.index];
+                if (b)
+                    history::ReleaseBlob(b); // e.g. the writer restarted
+                b = history::AddBlob(data, (size_t)chunk.size);
+                return true;
+            }
+            if (chunk.type == trace_chunk_image) return Image(data, chunk.size);
+            if (chunk.type == trace_chunk_frame) return Frame(data, chunk.size);
+            return true; // handled by the caller
+        }
+    };
+
+    static uint64_t FileSize(FILE *f)
+    {
+        #ifdef _WIN32
+        _fseeki64(f, 0, SEEK_END);
+        uint64_t size = (uint64_t)_ftelli64(f);
+        #else
+        fseeko(f, 0, SEEK_END);
+        uint64_t size = (uint64_t)ftello(f);
+        #endif
+        log_spill::Seek(f, 0);
+        return size;
+    }
+
+    static bool Load(const char *filename)
+    {
+        FILE *f = fopen(filename, "rb");
+        if (!f)
+        {
+            fprintf(stderr, "Failed to open trace file %s\n", filename);
+            return false;
+        }
+        uint64_t file_size = FileSize(f);
+        trace_file_header_t header;
+        if (fread(&header, sizeof(header), 1, f) != 1 ||
+            memcmp(header.magic, magic, sizeof(magic)) != 0 ||
+            header.version != version ||
+            header.byte_order != byte_order)
+        {
+            fprintf(stderr, "Invalid trace file %s\n", filename);
+            fclose(f);
+            return false;
+        }
+
+        reader_t reader;
+        std::vector<char> payload;
+        uint64_t at = sizeof(header);
+        uint64_t logs_offset = 0;
+        bool valid = true;
+        for (;;)
+        {
+            trace_chunk_t chunk;
+            if (fread(&chunk, sizeof(chunk), 1, f) != 1 ||
+                chunk.size > file_size - at - sizeof(chunk))
+                break; // cut short
+            payload.resize((size_t)chunk.size);
+            if (chunk.size > 0 && fread(payload.data(), (size_t)chunk.size, 1, f) != 1)
+                break;
+            valid = reader.Chunk(chunk, payload.data());
+            if (!valid)
+                break;
+            if (chunk.type == trace_chunk_logs)
+                logs_offset = at + sizeof(chunk);
+
+            at += sizeof(chunk) + chunk.size;
+            at += (16 - at % 16) % 16;
+            log_spill::Seek(f, at);
+        }
+        fclose(f);
+        reader.Release();
+
+        if (!valid)
+            fprintf(stderr, "Invalid trace file %s (read up to offset %llu)\n", filename, (unsigned long long)at);
+        if (logs_offset)
+        {
+            log_stream::TakeOwnership();
+            log_file::Load(filename, "trace", logs_offset);
+        }
+        return true;
+    }
+}
@@ -1,22 +1,40 @@
+// The transform is set up anew by every frame, so each thread has its own, and
+// a watched block can draw while the viewer does (see watch.h). The stacks are
+// too big to be per thread, so a block points these at its own.
 namespace transform
 {
-    static vdbMat4 projection = vdbMatIdentity();
-    static vdbMat4 view_model = vdbMatIdentity();
-    static vdbMat4 pvm = vdbMatIdentity();
-    static matrix_stack_t matrix_stack = {0};
-    static matrix_stack_t projection_stack = {0};
-    int viewport_left;
-    int viewport_bottom;
-    int viewport_width;
-    int viewport_height;
+    static thread_local vdbMat4 projection = vdbMatIdentity();
+    static thread_local vdbMat4 view_model = vdbMatIdentity();
+    static thread_local vdbMat4 pvm = vdbMatIdentity();
+    static matrix_stack_t shared_matrix_stack;
+    static matrix_stack_t shared_projection_stack;
+    static thread_local matrix_stack_t *matrix_stack = &shared_matrix_stack;
+    static thread_local matrix_stack_t *projection_stack = &shared_projection_stack;
+    static thread_local vdbMat4 tile = vdbMatIdentity(); // left-multiplied onto the projection (see tiled_screenshot.h)
+    static thread_local int viewport_left;
+    static thread_local int viewport_bottom;
+    static thread_local int viewport_width;
+    static thread_local int viewport_height;
+
+    static void UpdateProjection()
+    {
+        projection = vdbMul4x4(tile, projection_stack->Top());
+        pvm = vdbMul4x4(projection, view_model);
+    }
+
+    static void SetTile(vdbMat4 m)
+    {
+        tile = m;
+        UpdateProjection();
+    }
 
     static void BeginFrame()
     {
-        projection = vdbMatIdentity();
+        projection = tile;
         view_model = vdbMatIdentity();
-        pvm = vdbMatIdentity();
-        matrix_stack.Reset();
-        projection_stack.Reset();
+        pvm = tile;
+        matrix_stack->Reset();
+        projection_stack->Reset();
         vdbViewporti(0, 0, window::framebuffer_width, window::framebuffer_height);
     }
 }
@@ -24,58 +42,55 @@ namespace transform
 void vdbPushMatrix()
 {
     using namespace transform;
-    matrix_stack.Push();
-    view_model = matrix_stack.Top();
+    matrix_stack->Push();
+    view_model = matrix_stack->Top();
 }
 
 void vdbPopMatrix()
 {
     using namespace transform;
-    matrix_stack.Pop();
-    view_model = matrix_stack.Top();
+    matrix_stack->Pop();
+    view_model = matrix_stack->Top();
     pvm = vdbMul4x4(projection, view_model);
 }
 
 void vdbPushProjection()
 {
     using namespace transform;
-    projection_stack.Push();
-    projection = projection_stack.Top();
+    projection_stack->Push();
+    UpdateProjection();
 }
 
 void vdbPopProjection()
 {
     using namespace transform;
-    projection_stack.Pop();
-    projection = projection_stack.Top();
-    pvm = vdbMul4x4(projection, view_model);
+    projection_stack->Pop();
+    UpdateProjection();
 }
 
 void vdbLoadProjection(vdbMat4 m)
 {
-    transform::projection_stack.Load(m);
-    transform::projection = transform::projection_stack.Top();
-    transform::pvm = vdbMul4x4(m, transform::view_model);
+    transform::projection_stack->Load(m);
+    transform::UpdateProjection();
 }
 
 void vdbMultProjection(vdbMat4 m)
 {
-    transform::projection_stack.Multiply(m);
-    transform::projection = transform::projection_stack.Top();
-    transform::pvm = vdbMul4x4(transform::projection, transform::view_model);
+    transform::projection_stack->Multiply(m);
+    transform::UpdateProjection();
 }
 
 void vdbLoadMatrix(vdbMat4 m)
 {
-    transform::matrix_stack.Load(m);
-    transform::view_model = transform::matrix_stack.Top();
+    transform::matrix_stack->Load(m);
+    transform::view_model = transform::matrix_stack->Top();
     transform::pvm = vdbMul4x4(transform::projection, transform::view_model);
 }
 
 void vdbMultMatrix(vdbMat4 m)
 {
-    transform::matrix_stack.Multiply(m);
-    transform::view_model = transform::matrix_stack.Top();
+    transform::matrix_stack->Multiply(m);
+    transform::view_model = transform::matrix_stack->Top();
     transform::pvm = vdbMul4x4(transform::projection, transform::view_model);
 }
 
@@ -94,8 +109,8 @@ void vdbMultMatrix_RowMaj(float *m)    { if (m) vdbMultMatrix(vdbMatTranspose(*(
 void vdbGetMatrix(float *m)            { assert(m); *(vdbMat4*)m = transform::view_model; }
 void vdbGetMatrix_RowMaj(float *m)     { assert(m); *(vdbMat4*)m = vdbMatTranspose(transform::view_model); }
 
-void vdbGetProjection(float *m)        { assert(m); *(vdbMat4*)m = transform::projection; }
-void vdbGetProjection_RowMaj(float *m) { assert(m); *(vdbMat4*)m = vdbMatTranspose(transform::projection); }
+void vdbGetProjection(float *m)        { assert(m); *(vdbMat4*)m = transform::projection_stack->Top(); }
+void vdbGetProjection_RowMaj(float *m) { assert(m); *(vdbMat4*)m = vdbMatTranspose(transform::projection_stack->Top()); }
 
 void vdbGetPVM(float *m)               { assert(m); *(vdbMat4*)m = transform::pvm; }
 void vdbGetPVM_RowMaj(float *m)        { assert(m); *(vdbMat4*)m = vdbMatTranspose(transform::pvm); }
@@ -157,7 +172,8 @@ float vdbGetAspectRatio()
 
 void vdbViewporti(int left, int bottom, int width, int height)
 {
-    glViewport(left, bottom, (GLsizei)width, (GLsizei)height);
+    if (!window::IsHeadless())
+        glViewport(left, bottom, (GLsizei)width, (GLsizei)height);
     transform::viewport_left = left;
     transform::viewport_bottom = bottom;
     transform::viewport_width = width;
@@ -5,8 +5,10 @@ namespace ui
     static bool take_screenshot_should_open;
     static bool record_video_should_open;
     static bool save_logs_should_open;
+    static bool load_logs_should_open;
     static bool ruler_should_open;
     static bool hide_logs;
+    static bool show_history;
 
     static ImFont *regular_font;
     static ImFont *big_font;
@@ -16,6 +18,7 @@ namespace ui
     static float main_menu_bar_height = 0.0f;
 
     static bool auto_step;
+    static bool live; // see vdbLiveView
 
     enum { query_buffer_size = 1024 };
     struct log_window_t
@@ -26,6 +29,10 @@ namespace ui
         char query_buffer[query_buffer_size];
         bool plot_as_histogram;
         bool plot_as_heatmap;
+        double view_width; // number of samples shown in a scalar plot (0 shows all)
+        double view_back; // number of samples after the right edge of the plot
+        log_heatmap_t heatmap;
+        log_query_t *query; // compiled from query_buffer
         log_window_t *next;
     };
 
@@ -36,12 +43,16 @@ namespace ui
     }
 
     static void MainMenuBar(frame_settings_t *fs);
+    static void BreakMenu(frame_settings_t *fs);
     static void ExitDialog();
     static void WindowSizeDialog();
     static void FramegrabDialog();
     static log_window_t *NewLogWindow();
     static void ShowLogWindow(log_window_t *window);
+    static void PlotScalarLog(log_window_t *window, log_t *l, ImVec2 size);
+    static void ShowLogQueryTable(log_window_t *window, log_query_t *query);
     static void ShowLogWindows();
+    static void HistoryWindow();
 }
 
 namespace ImGui
@@ -112,12 +123,262 @@ void vdbLogShow(const char *label, const char *query)
     }
 }
 
+// Plots a scalar log at screen resolution: each pixel column shows the min
+// and max of the samples under it, taken from the level of the log's pyramid
+// that matches the zoom (a ring pyramid for logs with a history limit).
+// The mouse wheel zooms the time axis, dragging pans, and clicking toggles
+// between lines and histogram. Double-click to show all samples again.
+static void ui::PlotScalarLog(log_window_t *window, log_t *l, ImVec2 size)
+{
+    using namespace ImGui;
+    ImGuiStyle &style = ImGui::GetStyle();
+    ImGuiIO &io = GetIO();
+
+    logs.UpdatePyramid(l); // loaded and bounded logs get their pyramid here
+    int64_t count = l->spilled + l->NumSamples();
+
+    ImVec2 frame_min = GetCursorScreenPos();
+    ImVec2 frame_max = ImVec2(frame_min.x + size.x, frame_min.y + size.y);
+    InvisibleButton("##plot", size);
+    ImDrawList *draw_list = GetWindowDrawList();
+    draw_list->AddRectFilled(frame_min, frame_max, GetColorU32(ImGuiCol_FrameBg), style.FrameRounding);
+    ImVec2 inner_min = ImVec2(frame_min.x + style.FramePadding.x, frame_min.y + style.FramePadding.y);
+    ImVec2 inner_max = ImVec2(frame_max.x - style.FramePadding.x, frame_max.y - style.FramePadding.y);
+    float inner_width = inner_max.x - inner_min.x;
+    int columns = (int)inner_width;
+    if (columns < 1 || count < 2)
+        return;
+
+    //
+    // view range (samples [begin, end))
+    //
+    const double min_width = 8.0;
+    double width = window->view_width > 0.0 ? window->view_width : (double)count;
+    if (width > count) width = count;
+    if (width < min_width && count > min_width) width = min_width;
+    double end = count - window->view_back;
+    if (end > count) end = count;
+    if (end < width) end = width;
+    double begin = end - width;
+
+    if (IsItemHovered() && io.MouseWheel != 0.0f)
+    {
+        double t = (io.MousePos.x - inner_min.x)/inner_width;
+        double anchor = begin + t*width; // keep the sample under the mouse fixed
+        width *= pow(0.8, (double)io.MouseWheel);
+        if (width < min_width) width = min_width;
+        if (width > count) width = count;
+        begin = anchor - t*width;
+    }
+    if (IsItemActive() && io.MouseDelta.x != 0.0f)
+        begin -= io.MouseDelta.x*width/inner_width;
+    if (IsItemHovered() && IsMouseDoubleClicked(0))
+    {
+        begin = 0.0;
+        width = count;
+    }
+    if (IsItemDeactivated() && io.MouseDragMaxDistanceSqr[0] < io.MouseDragThreshold*io.MouseDragThreshold)
+        window->plot_as_histogram = !window->plot_as_histogram;
+    if (begin > count - width) begin = count - width;
+    if (begin < 0.0) begin = 0.0;
+    end = begin + width;
+
+    // showing all samples (or the newest) keeps doing so as samples are added
+    window->view_width = width >= count ? 0.0 : width;
+    window->view_back = count - end;
+
+    //
+    // min and max per column
+    //
+    static std::vector<float> column_min;
+    static std::vector<float> column_max;
+    column_min.resize(columns);
+    column_max.resize(columns);
+    double per_column = width/columns;
+    int level = -1; // -1: read samples
+    while (level + 1 < log_pyramid_t::levels && l->pyramid->BucketSize(level + 1) <= per_column)
+        level++;
+
+    // A narrow view of spilled samples reads them, since the fine levels only
+    // cover the samples in memory (coarser ones would show a blocky plot)
+    if (level >= 0 && (int64_t)begin < l->pyramid->Covered(level) && width <= VDB_LOG_SPILL_CHUNK)
+        level = -1;
+
+    log_reader_t reader(l);
+    float scale_min = FLT_MAX;
+    float scale_max = -FLT_MAX;
+    for (int c = 0; c < columns; c++)
+    {
+        int64_t first = (int64_t)(begin + c*per_column);
+        int64_t last = (int64_t)(begin + (c + 1)*per_column);
+        if (first > count - 1) first = count - 1;
+        if (last <= first) last = first + 1;
+        if (last > count) last = count;
+        float min_value = FLT_MAX;
+        float max_value = -FLT_MAX;
+        if (level >= 0)
+        {
+            if (l->history > 0)
+                l->pyramid->QueryRing(level, l->head, (int)count, (int)first, (int)last, &min_value, &max_value);
+            else
+                l->pyramid->Query(level, first, last, &min_value, &max_value);
+        }
+        else
+        {
+            for (int64_t i = first; i < last; i++)
+            {
+                float x = *reader.Sample(i);
+                if (x < min_value) min_value = x;
+                if (x > max_value) max_value = x;
+            }
+        }
+        column_min[c] = min_value;
+        column_max[c] = max_value;
+        if (min_value < scale_min) scale_min = min_value;
+        if (max_value > scale_max) scale_max = max_value;
+    }
+    if (scale_min > scale_max) // all NaN
+        return;
+    if (scale_min == scale_max)
+    {
+        scale_min -= 0.5f;
+        scale_max += 0.5f;
+    }
+
+    //
+    // draw
+    //
+    float inner_height = inner_max.y - inner_min.y;
+    float y_scale = inner_height/(scale_max - scale_min);
+    #define Y(value) (inner_max.y - ((value) - scale_min)*y_scale)
+    if (window->plot_as_histogram)
+    {
+        ImU32 color = GetColorU32(ImGuiCol_PlotHistogram);
+        float base = scale_min > 0.0f ? scale_min : (scale_max < 0.0f ? scale_max : 0.0f);
+        for (int c = 0; c < columns; c++)
+        {
+            if (column_min[c] > column_max[c])
+                continue;
+            float top = column_max[c] > base ? column_max[c] : base;
+            float bottom = column_min[c] < base ? column_min[c] : base;
+            draw_list->AddRectFilled(ImVec2(inner_min.x + c, Y(top)), ImVec2(inner_min.x + c + 1.0f, Y(bottom)), color);
+        }
+    }
+    else
+    {
+        ImU32 color = GetColorU32(ImGuiCol_PlotLines);
+        static ImVector<ImVec2> points;
+        points.resize(0);
+        if (width < columns)
+        {
+            // fewer samples than pixels: connect the samples themselves
+            for (int64_t i = (int64_t)begin; i < count && i <= (int64_t)ceil(end); i++)
+                points.push_back(ImVec2(inner_min.x + (float)((i - begin)/width)*inner_width, Y(*reader.Sample(i))));
+        }
+        else
+        {
+            for (int c = 0; c < columns; c++)
+            {
+                if (column_min[c] > column_max[c])
+                    continue;
+                float x = inner_min.x + c + 0.5f;
+                ImVec2 a = ImVec2(x, Y(column_min[c]));
+                ImVec2 b = ImVec2(x, Y(column_max[c]));
+                bool min_first = points.Size > 0 && fabsf(points.back().y - a.y) < fabsf(points.back().y - b.y);
+                points.push_back(min_first ? a : b);
+                points.push_back(min_first ? b : a);
+            }
+        }
+        draw_list->PushClipRect(inner_min, inner_max, true);
+        draw_list->AddPolyline(points.Data, points.Size, color, false, 1.0f);
+        draw_list->PopClipRect();
+    }
+    #undef Y
+
+    if (IsItemHovered() && !IsItemActive())
+    {
+        int c = (int)(io.MousePos.x - inner_min.x);
+        if (c >= 0 && c < columns && column_min[c] <= column_max[c])
+        {
+            long long first = (long long)(begin + c*per_column);
+            long long last = (long long)(begin + (c + 1)*per_column) - 1;
+            if (last <= first)
+                SetTooltip("%lld: %8.4g", first, column_min[c]);
+            else
+                SetTooltip("%lld-%lld: %8.4g to %8.4g", first, last, column_min[c], column_max[c]);
+        }
+    }
+}
+
+// Shows queries that match several logs, or ask for an aggregate, as a
+// table with one row per log. Clicking a row opens that log in the window.
+static void ui::ShowLogQueryTable(log_window_t *window, log_query_t *query)
+{
+    int count = (int)query->matches.size();
+    if (count == 1)
+    {
+        static char buffer[1024];
+        sprintf(buffer, "%g", log_query::Aggregate(query, query->matches[0].log));
+        ImVec2 plot_area_size = ImGui::GetContentRegionAvail();
+        ImGui::PushFont(ui::big_font);
+        ImVec2 text_size = ImGui::CalcTextSize(buffer);
+        ImGui::SetCursorPosX(plot_area_size.x*0.5f - text_size.x*0.5f);
+        ImGui::Text(buffer);
+        ImGui::PopFont();
+        return;
+    }
+
+    ImGui::Columns(2, "##matches");
+    ImGuiListClipper clipper(count);
+    while (clipper.Step())
+    {
+        for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; i++)
+        {
+            log_match_t *m = &query->matches[i];
+            log_t *l = m->log;
+            const char *path = log_query::Path(query, m);
+            if (ImGui::Selectable(path, false, ImGuiSelectableFlags_SpanAllColumns))
+                ImStrncpy(window->query_buffer, path, query_buffer_size);
+            ImGui::NextColumn();
+
+            int data_index = log_query::Sample(m);
+            if (query->aggregate != log_aggregate_none)
+                ImGui::Text("%g", log_query::Aggregate(query, l));
+            else if (l->type == log_type_group)
+                ImGui::TextDisabled("%d logs", (int)l->children.size());
+            else if (l->type == log_type_matrix)
+                ImGui::TextDisabled("%dx%d matrix", l->rows, l->columns);
+            else if (l->type == log_type_array)
+                ImGui::TextDisabled("%dx%d %s", l->rows, l->columns, LogElementName(l->element));
+            else if (data_index >= 0)
+                ImGui::Text("%g", *l->Sample(data_index));
+            else if (data_index == -1 && l->NumSamples() > 0)
+                ImGui::Text("%g", *l->Sample(l->NumSamples() - 1));
+            ImGui::NextColumn();
+        }
+    }
+    ImGui::Columns(1);
+}
+
 static void ui::ShowLogWindow(log_window_t *window)
 {
+    if (!window->query)
+        window->query = new log_query_t();
+    log_query_t *query = window->query;
+    log_query::Update(query, window->query_buffer);
+
     int data_index = -1;
-    log_t *l = logs.Find(window->query_buffer, &data_index);
+    log_t *l = NULL;
+    bool show_table = query->matches.size() > 1 || (query->matches.size() == 1 && query->aggregate != log_aggregate_none);
+    if (query->matches.size() == 1 && !show_table)
+    {
+        data_index = log_query::Sample(&query->matches[0]);
+        if (data_index != -2)
+            l = query->matches[0].log;
+    }
     ImGuiWindowFlags flags = 0;
-    if (l && l->type == log_type_matrix && window->plot_as_heatmap)
+    bool is_matrix = l && (l->type == log_type_matrix || l->type == log_type_array);
+    if (is_matrix && window->plot_as_heatmap)
         flags |= ImGuiWindowFlags_AlwaysVerticalScrollbar;
 
     ImGui::SetNextWindowSize(ImVec2(500, 200), ImGuiCond_FirstUseEver);
@@ -138,22 +399,18 @@ static void ui::ShowLogWindow(log_window_t *window)
 
     ImVec2 plot_area_size = ImGui::GetContentRegionAvail();
 
-    if (l && l->type == log_type_scalar)
+    if (show_table)
     {
-        float scale_min = FLT_MAX;
-        float scale_max = FLT_MAX;
-        const char *label = "##plot";
-        const float *values = &l->data[0];
-        int values_count = (int)l->data.size();
-        int values_offset = 0;
-        const char *overlay = NULL;
-
-        if (values_count == 1 || data_index >= 0)
+        ShowLogQueryTable(window, query);
+    }
+    else if (l && l->type == log_type_scalar)
+    {
+        if (l->spilled + l->NumSamples() == 1 || data_index >= 0)
         {
             int i = data_index >= 0 ? data_index : 0;
-            assert(i >= 0 && i < values_count);
+            assert(i >= 0 && i < l->NumSamples());
             static char buffer[1024];
-            sprintf(buffer, "%g", values[i]);
+            sprintf(buffer, "%g", *l->Sample(i));
             ImGui::PushFont(ui::big_font);
             ImVec2 text_size = ImGui::CalcTextSize(buffer);
             ImGui::SetCursorPosX(plot_area_size.x*0.5f - text_size.x*0.5f);
@@ -162,51 +419,37 @@ static void ui::ShowLogWindow(log_window_t *window)
         }
         else
         {
-            if (window->plot_as_histogram)
-                ImGui::PlotHistogram(label, values, values_count, values_offset, overlay, scale_min, scale_max, plot_area_size);
-            else
-                ImGui::PlotLines(label, values, values_count, values_offset, overlay, scale_min, scale_max, plot_area_size);
-            if (ImGui::IsItemClicked())
-                window->plot_as_histogram = !window->plot_as_histogram;
+            PlotScalarLog(window, l, plot_area_size);
         }
     }
-    else if (l && l->type == log_type_matrix)
+    else if (is_matrix)
     {
         int rows = l->rows;
         int cols = l->columns;
-        int i = data_index >= 0 ? rows*cols*data_index : (int)l->data.size() - rows*cols;
-        assert(i >= 0 && i < (int)l->data.size());
-        float *data = &l->data[i];
+        int i = data_index >= 0 ? data_index : l->NumSamples() - 1;
+        float *data = logs.FloatSample(l, i);
 
         if (window->plot_as_heatmap)
         {
-            float min_value = FLT_MAX;
-            float max_value = -FLT_MAX;
-            for (int j = 0; j < rows*cols; j++)
-            {
-                if (data[j] > max_value) max_value = data[j];
-                if (data[j] < min_value) min_value = data[j];
-            }
-
             ImGui::BeginGroup();
             ImVec2 a = ImGui::GetCursorScreenPos();
-            // ImVec2 a = ImGui::GetWindowContentRegionMin();
-            // a.x += p.x;
-            // a.y += p.y;
             float w = ImGui::GetWindowContentRegionWidth();
             float cell_size = w/cols;
             if (cell_size > 64.0f)
                 cell_size = 64.0f;
             float h = rows*cell_size;
             ImDrawList *list = ImGui::GetWindowDrawList();
-            for (int row = 0; row < rows; row++)
-            for (int col = 0; col < cols; col++)
+            if (log_heatmap::Update(&window->heatmap, l, i))
+            {
+                // the texture is indexed by (row, column), so it's drawn transposed
+                ImTextureID texture = (ImTextureID)(intptr_t)window->heatmap.colors.color[0];
+                ImVec2 b = ImVec2(a.x + cols*cell_size, a.y + h);
+                list->AddImageQuad(texture, a, ImVec2(b.x, a.y), b, ImVec2(a.x, b.y),
+                                   ImVec2(0,0), ImVec2(0,1), ImVec2(1,1), ImVec2(1,0));
+            }
+            else
             {
-                ImVec2 ai = ImVec2(a.x + col*cell_size, a.y + row*cell_size);
-                ImVec2 bi = ImVec2(a.x + (col+1)*cell_size, a.y + (row+1)*cell_size);
-                float v = data[row + rows*col];
-                int c = (int)(255.0f*(v - min_value)/(max_value - min_value));
-                list->AddRectFilled(ai, bi, IM_COL32(c,c,c,255));
+                ImGui::TextDisabled("The matrix is too large to show as a heatmap");
             }
             ImGui::Dummy(ImVec2(w, h));
             if (ImGui::IsItemHovered())
@@ -260,6 +503,8 @@ static void ui::ShowLogWindows()
             if (!window->open)
             {
                 log_window_t *next = window->next;
+                log_heatmap::Free(&window->heatmap);
+                delete window->query;
                 free(window);
                 if (!prev) log_windows::first = next;
                 else prev->next = next;
@@ -288,10 +533,50 @@ static void ui::ShowLogWindows()
         if (IsWindowAppearing())
             SetKeyboardFocusHere();
         InputText("Filename", filename, sizeof(filename));
+        TextDisabled("Filenames ending in .vdblog are saved in the binary format.");
+
+        if (Button("OK [Enter]", ImVec2(120,0)) || enter_button)
+        {
+            size_t n = strlen(filename);
+            if (n >= 7 && strcmp(filename + n - 7, ".vdblog") == 0)
+                log_file::Save(filename);
+            else
+                logs.Dump(filename);
+            CloseCurrentPopup();
+        }
+        SameLine();
+        if (Button("Cancel", ImVec2(120,0)))
+        {
+            CloseCurrentPopup();
+        }
+
+        if (escape_button)
+        {
+            CloseCurrentPopup();
+            ui::escape_eaten = true;
+        }
+        EndPopup();
+    }
+
+    if (load_logs_should_open)
+    {
+        load_logs_should_open = false;
+        OpenPopup("Load logs##popup");
+        CaptureKeyboardFromApp(true);
+    }
+    if (BeginPopupModal("Load logs##popup", NULL, ImGuiWindowFlags_AlwaysAutoResize))
+    {
+        static char filename[1024];
+        static char label[256] = "loaded";
+        if (IsWindowAppearing())
+            SetKeyboardFocusHere();
+        InputText("Filename", filename, sizeof(filename));
+        InputText("Group", label, sizeof(label));
+        TextDisabled("Loads a .vdblog file into the log group /%s.", label);
 
         if (Button("OK [Enter]", ImVec2(120,0)) || enter_button)
         {
-            logs.Dump(filename);
+            log_file::Load(filename, label);
             CloseCurrentPopup();
         }
         SameLine();
@@ -401,9 +686,40 @@ static void ui::MainMenuBar(frame_settings_t *fs)
             if (ImGui::RadioButton("-X", up, VDB_X_DOWN)) *dirty = true;
         }
 
+        // dynamic resolution
+        ImGui::Separator();
+        {
+            float *budget_ms = &fs->render_scaler.budget_ms;
+            bool enabled = *budget_ms > 0.0f;
+            if (ImGui::Checkbox("Frame budget", &enabled))
+            {
+                *budget_ms = enabled ? 16.0f : 0.0f;
+                fs->render_scaler.dirty = true;
+            }
+            ImGui::SameLine(); ImGui::ShowHelpMarker("Lowers the render resolution to keep the frame time within the budget. Overrides the render scale in Settings.");
+            if (enabled && ImGui::DragFloat("Budget", budget_ms, 0.1f, 1.0f, 100.0f, "%.1f ms"))
+            {
+                if (*budget_ms < 1.0f) *budget_ms = 1.0f;
+                fs->render_scaler.dirty = true;
+            }
+            ImGui::Text("Render scale: %.0f%%", 100.0f*dynamic_resolution::applied_scale);
+            if (dynamic_resolution::has_timer_query && *budget_ms > 0.0f)
+                ImGui::Text("GPU: %.2f ms  CPU: %.2f ms", dynamic_resolution::gpu_ms, dynamic_resolution::cpu_ms);
+            else
+                ImGui::Text("GPU: n/a  CPU: %.2f ms", dynamic_resolution::cpu_ms);
+            char overlay[32];
+            ImFormatString(overlay, sizeof(overlay), "%.2f ms", 1000.0f*frame_clock::delta);
+            ImGui::PlotLines("Frame time", frame_clock::times, VDB_FRAME_TIME_HISTORY, frame_clock::next, overlay, 0.0f, FLT_MAX, ImVec2(0.0f, 40.0f));
+        }
+
         ImGui::PopItemWidth();
         ImGui::EndMenu();
     }
+    if (ImGui::BeginMenu("Break"))
+    {
+        BreakMenu(fs);
+        ImGui::EndMenu();
+    }
     if (ImGui::BeginMenu("Settings"))
     {
         ImGui::MenuItem("Show menu", "Alt+M", &settings.show_main_menu);
@@ -429,6 +745,18 @@ static void ui::MainMenuBar(frame_settings_t *fs)
             if (ImGui::MenuItem("1 sec" , NULL, settings.auto_step_delay_ms==1000)) settings.auto_step_delay_ms = 1000;
             ImGui::EndMenu();
         }
+        if (ImGui::BeginMenu("Frame rate"))
+        {
+            if (ImGui::MenuItem("30 fps",    NULL, settings.target_fps==30))  settings.target_fps = 30;
+            if (ImGui::MenuItem("60 fps",    NULL, settings.target_fps==60))  settings.target_fps = 60;
+            if (ImGui::MenuItem("120 fps",   NULL, settings.target_fps==120)) settings.target_fps = 120;
+            if (ImGui::MenuItem("144 fps",   NULL, settings.target_fps==144)) settings.target_fps = 144;
+            if (ImGui::MenuItem("Unlimited", NULL, settings.target_fps==0))   settings.target_fps = 0;
+            ImGui::EndMenu();
+        }
+        ImGui::SameLine(); ImGui::ShowHelpMarker("The most frames per second while vsync is off (e.g. in the live view or if the driver doesn't support it).");
+        ImGui::MenuItem("Live view", NULL, &live);
+        ImGui::SameLine(); ImGui::ShowHelpMarker("Breaks don't pause: a hit is only shown when the display is due for a new frame, and the others return at once.");
         if (ImGui::BeginMenu("Font"))
         {
             if (ImGui::BeginMenu("DPI scale"))
@@ -448,25 +776,31 @@ static void ui::MainMenuBar(frame_settings_t *fs)
         }
         if (ImGui::BeginMenu("Render scale"))
         {
-            #define ITEM(label, _down, _up) \
-                if (ImGui::MenuItem(label, NULL, fs->render_scaler.down==_down && fs->render_scaler.up==_up)) { \
+            #define ITEM(label, _down, _up, _adaptive) \
+                if (ImGui::MenuItem(label, NULL, fs->render_scaler.down==_down && fs->render_scaler.up==_up && fs->render_scaler.adaptive==_adaptive)) { \
                     fs->render_scaler.down = _down; \
                     fs->render_scaler.up = _up; \
+                    fs->render_scaler.adaptive = _adaptive; \
                     fs->render_scaler.dirty = true; \
                 }
-            ITEM("1/1", 0, 0);
-            ITEM("1/2", 1, 0);
-            ITEM("1/4", 2, 0);
-            ITEM("1/8", 3, 0);
+            ITEM("1/1", 0, 0, false);
+            ITEM("1/2", 1, 0, false);
+            ITEM("1/4", 2, 0, false);
+            ITEM("1/8", 3, 0, false);
+            ImGui::Separator();
+            ITEM("2/2", 1, 1, false);
+            ITEM("2/4", 2, 1, false);
+            ITEM("2/8", 3, 1, false);
             ImGui::Separator();
-            ITEM("2/2", 1, 1);
-            ITEM("2/4", 2, 1);
-            ITEM("2/8", 3, 1);
+            ITEM("4/4", 2, 2, false);
+            ITEM("4/8", 3, 2, false);
             ImGui::Separator();
-            ITEM("4/4", 2, 2);
-            ITEM("4/8", 3, 2);
+            ITEM("8/8", 3, 3, false);
             ImGui::Separator();
-            ITEM("8/8", 3, 3);
+            ITEM("Adaptive 1/2", 1, 1, true);
+            ITEM("Adaptive 1/4", 2, 2, true);
+            ITEM("Adaptive 1/8", 3, 3, true);
+            ImGui::SameLine(); ImGui::ShowHelpMarker("Renders at reduced resolution while the camera moves or input is active, and progressively refines to full resolution once the view settles.");
             #undef ITEM
             ImGui::EndMenu();
         }
@@ -477,17 +811,23 @@ static void ui::MainMenuBar(frame_settings_t *fs)
         if (ImGui::MenuItem("Take screenshot", "Alt+S")) take_screenshot_should_open = true;
         if (ImGui::MenuItem("Record video", "Alt+S")) record_video_should_open = true;
         if (ImGui::MenuItem("Ruler", "Alt+R")) ruler_should_open = true;
+        ImGui::MenuItem("History", NULL, &show_history);
         ImGui::EndMenu();
     }
     if (ImGui::BeginMenu("Logs"))
     {
         if (ImGui::MenuItem("New log window", "Alt+L")) NewLogWindow();
         if (ImGui::MenuItem("Save logs", NULL)) save_logs_should_open = true;
+        if (ImGui::MenuItem("Load logs", NULL)) load_logs_should_open = true;
         ImGui::MenuItem("Hide logs", NULL, &hide_logs);
         ImGui::EndMenu();
     }
     ImGui::Separator();
-    if (auto_step)
+    if (live)
+    {
+        if (ImGui::MenuItem("Live...")) live = false;
+    }
+    else if (auto_step)
     {
         if (ImGui::MenuItem("Running...")) auto_step = false;
     }
@@ -501,6 +841,126 @@ static void ui::MainMenuBar(frame_settings_t *fs)
     ImGui::PopStyleVar();
 }
 
+// The log path is saved between quotes (see settings.h), so it can't have any
+static int FilterLogPathChar(ImGuiInputTextCallbackData *data)
+{
+    return data->EventChar == '"' || data->EventChar == '\n';
+}
+
+// Edits the breakpoint policy of the current label (see breakpoints.h), and
+// lists the other labels that don't always break, since they can't be
+// reached from their own break.
+static void ui::BreakMenu(frame_settings_t *fs)
+{
+    break_settings_t &b = fs->breaks;
+    ImGui::Text("%s (hit %llu)", fs->name, (unsigned long long)b.hits);
+    ImGui::Separator();
+    bool changed = false;
+    changed |= ImGui::RadioButton("Always", &b.mode, break_always);
+    changed |= ImGui::RadioButton("Never", &b.mode, break_never);
+    changed |= ImGui::RadioButton("Every Nth hit", &b.mode, break_every);
+    changed |= ImGui::RadioButton("After N hits", &b.mode, break_after);
+    changed |= ImGui::RadioButton("When a log crosses a threshold", &b.mode, break_crossing);
+    ImGui::PushItemWidth(160.0f);
+    if (b.mode == break_every || b.mode == break_after)
+    {
+        if (ImGui::InputInt("N", &b.count))
+        {
+            if (b.count < 1) b.count = 1;
+            changed = true;
+        }
+    }
+    if (b.mode == break_crossing)
+    {
+        if (ImGui::InputText("Log", b.log, sizeof(b.log), ImGuiInputTextFlags_CallbackCharFilter, FilterLogPathChar))
+        {
+            breakpoints::Unresolve(b);
+            changed = true;
+        }
+        ImGui::SameLine(); ImGui::ShowHelpMarker("The path of a scalar log, e.g. /iter/loss. The newest sample is compared at each hit.");
+        changed |= ImGui::InputFloat("Threshold", &b.threshold);
+        changed |= ImGui::RadioButton("Rising", &b.direction, +1); ImGui::SameLine();
+        changed |= ImGui::RadioButton("Falling", &b.direction, -1); ImGui::SameLine();
+        changed |= ImGui::RadioButton("Either", &b.direction, 0);
+    }
+    ImGui::PopItemWidth();
+    if (changed)
+        b.dirty = true;
+
+    bool has_others = false;
+    for (size_t i = 0; i < settings.frames.size(); i++)
+    {
+        frame_settings_t *other = settings.frames[i];
+        if (other == fs || other->breaks.mode == break_always)
+            continue;
+        if (!has_others)
+        {
+            ImGui::Separator();
+            ImGui::TextDisabled("Other labels (click to always break)");
+            has_others = true;
+        }
+        if (ImGui::MenuItem(other->name))
+        {
+            other->breaks.mode = break_always;
+            other->breaks.dirty = true;
+        }
+    }
+}
+
+// Lets the user scrub back through past breakpoint hits (see history.h)
+static void ui::HistoryWindow()
+{
+    history::enabled = show_history; // hits are recorded from the next frame on
+    if (!show_history)
+    {
+        history::viewing = -1;
+        return;
+    }
+    ImGui::SetNextWindowSize(ImVec2(400, 0), ImGuiCond_FirstUseEver);
+    if (ImGui::Begin("History", &show_history))
+    {
+        int n = (int)history::frames.size();
+        if (n == 0)
+        {
+            ImGui::TextDisabled("Hits are recorded when you step past a breakpoint while this window is open.");
+        }
+        else
+        {
+            // position n is the live frame
+            int i = history::viewing >= 0 ? history::viewing : n;
+            if (ImGui::ArrowButton("##older", ImGuiDir_Left) && i > 0) i--;
+            ImGui::SameLine();
+            if (ImGui::ArrowButton("##newer", ImGuiDir_Right) && i < n) i++;
+            ImGui::SameLine();
+            ImGui::PushItemWidth(ImGui::GetContentRegionAvailWidth());
+            ImGui::SliderInt("##hit", &i, 0, n, i == n ? "live" : "%d");
+            ImGui::PopItemWidth();
+            history::viewing = i < n ? i : -1;
+            int shown = i < n ? i : history::follow ? n - 1 : -1; // see history::EndFrame
+            if (i < n)
+                ImGui::Text("%s (hit %d)", history::frames[i]->label, history::frames[i]->hit + 1);
+            else if (shown >= 0)
+                ImGui::Text("Live: %s (hit %d)", history::frames[shown]->label, history::frames[shown]->hit + 1);
+            else
+                ImGui::Text("Live");
+            ImGui::TextDisabled("%.1f of %.1f MB used", history::used_bytes/(1024.0f*1024.0f), VDB_HISTORY_BUDGET/(1024.0f*1024.0f));
+            if (shown >= 0)
+            {
+                for (size_t j = 0; j < history::frames[shown]->cmds.size(); j++)
+                {
+                    history_cmd_t &cmd = history::frames[shown]->cmds[j];
+                    if (cmd.type == history_cmd_widgets)
+                    {
+                        ImGui::Separator();
+                        ImGui::TextUnformatted(cmd.blob->Data());
+                    }
+                }
+            }
+        }
+    }
+    ImGui::End();
+}
+
 static void ui::ExitDialog()
 {
     bool escape = keys::pressed[VDB_KEY_ESCAPE];
@@ -1,5 +1,9 @@
 #include "config.h"
 
+#ifdef VDB_DISABLE
+#error "VDB_DISABLE is for programs that use vdb, vdb itself must be built without it"
+#endif
+
 #ifdef VDB_DEBUG
 #include "glad/glad_3_1_debug.c"
 #else
@@ -18,6 +22,11 @@
 #else
 #define IMGUI_IMPL_OPENGL_LOADER_CUSTOM <opengl.h>
 #endif
+// The current context is per thread, since watched blocks use ImGui on their
+// own thread while the viewer draws (see watch.h)
+struct ImGuiContext;
+static thread_local ImGuiContext *vdb_imgui_context;
+#define GImGui vdb_imgui_context
 #include "imgui/imgui.cpp"
 #include "imgui/imgui_draw.cpp"
 #include "imgui/imgui_demo.cpp"
@@ -44,30 +53,28 @@ const char *GLErrorCodeString(GLenum error)
     return "Not an error";
 }
 
-#define CheckGLError() { \
-    GLenum error = glGetError(); \
-    if (error != GL_NO_ERROR) { \
-        fprintf(stderr, "OpenGL error in file %s line %d: (0x%x) %s\n", __FILE__, __LINE__, error, GLErrorCodeString(error)); \
-        exit(EXIT_FAILURE); \
-    } \
-}
+#include "vdb.h"
 
-#define AssertGL(fmt, ...) { \
-    GLenum error = glGetError(); \
-    if (error != GL_NO_ERROR) { \
-        fprintf(stderr, fmt, __VA_ARGS__); \
-        fprintf(stderr, "OpenGL error in file %s line %d: (0x%x) %s\n", __FILE__, __LINE__, error, GLErrorCodeString(error)); \
-        exit(EXIT_FAILURE); \
-    } \
+// The runtime kill switch (see vdb.h). It's read once, before main, so each
+// check is a test of a flag that doesn't change.
+static bool IsDisabledByEnvironment()
+{
+    const char *value = getenv("VDB");
+    return value && strcmp(value, "0") == 0;
 }
+static const bool vdb_disabled = IsDisabledByEnvironment();
 
-#include "vdb.h"
 #include "matrix.h"
 #include "keys.h"
+#include "intern.h"
 #include "settings.h"
+#include "settings_saver.h"
 #include "colormap.h"
 #include "style.h"
 #include "mouse.h"
+#include "damage.h"
+#include "frame_clock.h"
+#include "gl_debug.h"
 #include "window.h"
 #include "matrix_stack.h"
 #include "camera.h"
@@ -79,8 +86,20 @@ const char *GLErrorCodeString(GLenum error)
 #include "transform.h"
 #include "immediate.h"
 #include "immediate_util.h"
+#include "history.h"
 #include "render_scaler.h"
+#include "dynamic_resolution.h"
+#include "tiled_screenshot.h"
 #include "log.h"
+#include "log_stream.h"
+#include "log_spill.h"
+#include "log_file.h"
+#include "log_heatmap.h"
+#include "log_query.h"
+#include "breakpoints.h"
+#include "trace.h"
+#include "watch.h"
+#include "remote.h"
 #include "ui.h"
 #include "ruler.h"
 #include "widgets.h"
@@ -90,12 +109,20 @@ const char *GLErrorCodeString(GLenum error)
 namespace vdb
 {
     static bool initialized;
-    static bool is_first_frame;
-    static bool is_different_label;
+    static thread_local bool is_first_frame; // of the thread's break (a watched block's is its own)
+    static thread_local bool is_different_label;
+    static ImGuiContext *imgui_context; // made current by each break, whichever thread it's on
     static bool want_step_once;
     static bool want_step_over;
     static int loaded_font_size;
     static frame_settings_t *frame_settings;
+    static bool headless_break_ended; // see vdbTraceRecord
+    static Uint64 live_next_frame; // see SkipLiveHit
+    static const char *live_label; // shown last in the live view
+    static bool live_label_waiting; // another label was skipped since
+    static int live_stride = 1; // hits between reads of the clock
+    static int live_countdown; // hits until the next read
+    static Uint64 live_last_read;
 }
 
 bool vdbIsFirstFrame()
@@ -108,6 +135,11 @@ bool vdbIsDifferentLabel()
     return vdb::is_different_label;
 }
 
+float vdbGetFrameDelta()
+{
+    return frame_clock::delta;
+}
+
 static void InitializeIfNotAlready()
 {
     if (!vdb::initialized)
@@ -117,9 +149,10 @@ static void InitializeIfNotAlready()
         settings.LoadOrDefault(VDB_SETTINGS_FILENAME);
         window_settings_t ws = settings.window;
         window::CreateContext(ws.x, ws.y, ws.width, ws.height);
-        CheckGLError();
+        gl_debug::Check("while creating the window");
+        gl_debug::Init();
 
-        ImGui::CreateContext();
+        vdb::imgui_context = ImGui::CreateContext();
         ImGui_ImplSDL2_InitForOpenGL(window::sdl_window, window::sdl_gl_context);
         ImGui_ImplOpenGL3_Init("#version 150");
         ImGui::StyleColorsDark();
@@ -134,10 +167,17 @@ void vdbDetachContext()
 
 void vdbMakeContextCurrent()
 {
+    if (window::IsHeadless())
+        return;
     InitializeIfNotAlready();
     window::EnsureContextIsCurrent();
 }
 
+bool vdbHasGLDebugOutput()
+{
+    return gl_debug::active;
+}
+
 void vdbStepOnce()
 {
     vdb::want_step_once = true;
@@ -153,6 +193,11 @@ void vdbAutoStep(bool enabled)
     ui::auto_step = enabled;
 }
 
+void vdbLiveView(bool enabled)
+{
+    ui::live = enabled;
+}
+
 static frame_settings_t *GetFrameSettings()
 {
     return vdb::frame_settings;
@@ -160,6 +205,8 @@ static frame_settings_t *GetFrameSettings()
 
 void vdbSaveScreenshot(const char *filename)
 {
+    if (window::IsHeadless())
+        return;
     int width = vdbGetFramebufferWidth();
     int height = vdbGetFramebufferHeight();
     int channels = 4;
@@ -177,16 +224,259 @@ void vdbSaveScreenshot(const char *filename)
     free(data);
 }
 
+// Returns the settings of a label (see settings_t::FindFrame). A cache maps the
+// pointer of a label (usually a string literal) to its settings, so a hit
+// doesn't hash the label. The label is still compared, since the pointer may
+// be a reused buffer.
+static frame_settings_t *FindFrameSettings(const char *label)
+{
+    struct lookup_t
+    {
+        const char *key;
+        frame_settings_t *fs;
+    };
+    static lookup_t cache[VDB_LABEL_CACHE_SIZE];
+
+    lookup_t *entry = &cache[((size_t)label >> 3) & (VDB_LABEL_CACHE_SIZE - 1)];
+    if (entry->key == label && strcmp(entry->fs->name, label) == 0)
+        return entry->fs;
+    entry->key = label;
+    entry->fs = settings.FindFrame(label, strlen(label));
+    return entry->fs;
+}
+
+static void BeginCamera()
+{
+    if (vdb::frame_settings->camera.type != VDB_CUSTOM)
+    {
+        frame_settings_t *fs = vdb::frame_settings;
+        if      (fs->camera.type == VDB_TRACKBALL) vdbCameraTrackball();
+        else if (fs->camera.type == VDB_TURNTABLE) vdbCameraTurntable();
+        else                                              vdbCamera2D();
+
+        if (fs->camera.type != VDB_PLANAR)
+        {
+            vdbDepthTest(true);
+            vdbDepthWrite(true);
+            vdbPerspective(fs->camera.projection.y_fov,
+                fs->camera.projection.min_depth,
+                fs->camera.projection.max_depth);
+        }
+
+        // We do PushMatrix to save current state for drawing grid in vdbEndBreak
+
+        // pre-permutation transform
+        // the built-in cameras assume that y axis is up
+        vdbPushMatrix();
+        vdbOrientation up = *GetCameraUp();
+        if      (up == VDB_Z_UP)   vdbMultMatrix(vdbInitMat4(0,1,0,0, 0,0,1,0, 1,0,0,0, 0,0,0,1).data);
+        else if (up == VDB_X_UP)   vdbMultMatrix(vdbInitMat4(0,0,1,0, 1,0,0,0, 0,1,0,0, 0,0,0,1).data);
+        else if (up == VDB_Z_DOWN) vdbMultMatrix(vdbInitMat4(0,1,0,0, 0,0,-1,0, -1,0,0,0, 0,0,0,1).data);
+        else if (up == VDB_Y_DOWN) vdbMultMatrix(vdbInitMat4(1,0,0,0, 0,-1,0,0, 0,0,-1,0, 0,0,0,1).data);
+        else if (up == VDB_X_DOWN) vdbMultMatrix(vdbInitMat4(0,0,1,0, -1,0,0,0, 0,-1,0,0, 0,0,0,1).data);
+
+        // pre-scaling transform
+        vdbPushMatrix();
+        vdbMultMatrix(vdbMatScale(1.0f/fs->grid.grid_scale, 1.0f/fs->grid.grid_scale, 1.0f/fs->grid.grid_scale).data);
+    }
+}
+
+// An ImGui context for breaks without a window (see BeginHeadlessFrame)
+static ImGuiContext *CreateHeadlessImGuiContext()
+{
+    ImGuiContext *prev = ImGui::GetCurrentContext();
+    ImGuiContext *context = ImGui::CreateContext();
+    ImGui::SetCurrentContext(context);
+    ImGuiIO &io = ImGui::GetIO();
+    io.IniFilename = NULL;
+    unsigned char *pixels;
+    int width, height;
+    io.Fonts->GetTexDataAsAlpha8(&pixels, &width, &height); // builds the default font, which ImGui::NewFrame requires
+    ImGui::SetCurrentContext(prev);
+    return context;
+}
+
+static void BeginHeadlessFrame()
+{
+    vdb::is_first_frame = true;
+
+    ImGuiIO &io = ImGui::GetIO();
+    io.DisplaySize = ImVec2((float)window::window_width, (float)window::window_height);
+
+    // Measured like frame_clock::BeginFrame, but per thread (watched blocks
+    // run their frames alongside the viewer's)
+    static thread_local Uint64 frame_begin = 0;
+    Uint64 now = SDL_GetPerformanceCounter();
+    float seconds = 1.0f/60.0f;
+    if (frame_begin)
+        seconds = (float)((double)(now - frame_begin)/SDL_GetPerformanceFrequency());
+    if (seconds > VDB_MAX_FRAME_DELTA)
+        seconds = VDB_MAX_FRAME_DELTA;
+    if (seconds <= 0.0f) // ImGui asserts that time moves forward
+        seconds = 1e-6f;
+    io.DeltaTime = seconds;
+    frame_begin = now;
+
+    if (!watch::in_block) // the viewer applies them (see hints.h)
+        hints::BeginFrame();
+    transform::BeginFrame();
+    mouse::BeginFrame();
+    immediate_util::BeginFrame();
+    immediate::BeginFrame();
+    colormap::BeginFrame();
+    ImGui::NewFrame(); // the user may call ImGui, even though nothing is shown
+    widgets_panel::NewFrame();
+    immediate::SetRenderOffsetNDC(vdbVec2(0.0f, 0.0f));
+}
+
+// While recording a trace, each break runs once: the first call returns true,
+// and the next (after vdbEndBreak) writes what was recorded and returns false.
+// A remote client sends it instead, and skips the break if it can't be sent
+// (see remote.h).
+static bool BeginHeadlessBreak(const char *label)
+{
+    if (vdb::headless_break_ended)
+    {
+        vdb::headless_break_ended = false;
+        logs.FlushViews(); // the break is over, see vdbLogView
+        if (remote::is_client) remote::EndBlock(label);
+        else                   trace::WriteFrame(label);
+        return false;
+    }
+    if (remote::is_client && !remote::BeginBlock())
+    {
+        logs.FlushViews();
+        return false;
+    }
+
+    vdb::frame_settings = FindFrameSettings(label);
+    BeginHeadlessFrame();
+    if (remote::has_camera)
+    {
+        vdbLoadProjection(remote::projection);
+        vdbLoadMatrix(remote::view_model);
+        if (remote::depth_test)
+        {
+            vdbDepthTest(true);
+            vdbDepthWrite(true);
+        }
+    }
+    else
+    {
+        BeginCamera();
+    }
+    history::BeginFrame();
+    return true;
+}
+
+// Like BeginHeadlessBreak, but the block is handed to the viewer thread when
+// it ends (see watch.h). Blocks share the viewer's frame settings and camera.
+static bool BeginWatchedBreak(const char *label)
+{
+    if (watch::in_block)
+    {
+        watch::EndBlock(label);
+        return false;
+    }
+    watch::view_t view;
+    if (!watch::BeginBlock(&view))
+        return false;
+
+    BeginHeadlessFrame();
+    vdbLoadProjection(view.projection);
+    vdbLoadMatrix(view.view_model);
+    if (view.depth_test)
+    {
+        vdbDepthTest(true);
+        vdbDepthWrite(true);
+    }
+    history::BeginFrame();
+    return true;
+}
+
+// In the live view (vdbLiveView) a hit is only shown when the display is due
+// for a new frame, and other hits return at once, so the program runs at near
+// full speed. When several labels are hit, the one shown last gives way to one
+// that was skipped.
+//
+// Reading the clock can cost more than the rest of a skipped hit (about 45 ns
+// in a VM), so it's only read every live_stride hits. The stride doubles
+// while the reads are less than 1/64 of a frame apart, and halves when they
+// are more than 1/32 apart, so a hit is shown at most that much late.
+static bool SkipLiveHit(const char *label)
+{
+    if (--vdb::live_countdown > 0)
+    {
+        if (label != vdb::live_label)
+            vdb::live_label_waiting = true;
+        return true;
+    }
+    Uint64 now = SDL_GetPerformanceCounter();
+    Uint64 frame = SDL_GetPerformanceFrequency()/VDB_LIVE_VIEW_FPS;
+    Uint64 elapsed = now - vdb::live_last_read;
+    vdb::live_last_read = now;
+    if (elapsed*64 < frame && vdb::live_stride < (1 << 20))
+        vdb::live_stride *= 2;
+    else if (elapsed*32 > frame && vdb::live_stride > 1)
+        vdb::live_stride /= 2;
+    vdb::live_countdown = vdb::live_stride;
+
+    if (now < vdb::live_next_frame)
+    {
+        if (label != vdb::live_label)
+            vdb::live_label_waiting = true;
+        return true;
+    }
+    if (label == vdb::live_label && vdb::live_label_waiting)
+    {
+        vdb::live_label_waiting = false;
+        return true;
+    }
+    vdb::live_next_frame = now + frame;
+    vdb::live_label = label;
+    return false;
+}
+
 bool vdbBeginBreak(const char *label)
 {
+    if (vdb_disabled)
+        return false;
+    if (watch::enabled && !watch::is_viewer)
+        return BeginWatchedBreak(label);
+
+    // Labels are compared (and kept, e.g. by the history) as the interned name
+    // of their settings, so labels built in a buffer with sprintf work too
+    frame_settings_t *fs = FindFrameSettings(label);
+    label = fs->name;
+
     static const char *skip_label = NULL;
     static const char *prev_label = NULL;
     static bool is_first_frame = true;
     vdb::is_first_frame = is_first_frame;
     vdb::is_different_label = label != prev_label;
-    prev_label = label; // todo: strdup
-    if (skip_label == label)
+    prev_label = label;
+    log_stream::BeginBreak(); // also when skipped, so worker threads' logs don't pile up
+    if (window::IsHeadless())
+    {
+        if (vdb::imgui_context)
+            ImGui::SetCurrentContext(vdb::imgui_context);
+        return BeginHeadlessBreak(label);
+    }
+
+    // One check decides whether the hit is skipped, before any other work
+    // (see tools/vdbbench for the cost of a hit skipped by the live view)
+    bool skip = skip_label == label && !watch::is_viewer;
+    if (!skip && is_first_frame && !watch::is_viewer && !remote::is_viewer)
+        skip = breakpoints::Skip(fs) || (ui::live && SkipLiveHit(label));
+    if (skip)
+    {
+        logs.FlushViews(); // see vdbLogView
         return false;
+    }
+
+    if (vdb::imgui_context) // the break may be on another thread than the last
+        ImGui::SetCurrentContext(vdb::imgui_context);
+    GLCallSite(label);
     is_first_frame = false; // todo: first frame detection is janky.
                             // consider e.g. a for loop with single-stepping
 
@@ -233,40 +523,29 @@ bool vdbBeginBreak(const char *label)
     }
 
     if (vdbIsFirstFrame())
-    {
-        // see if we loaded a frame settings matching this frame's label
-        frame_settings_t *fs = NULL;
-        for (int i = 0; i < settings.num_frames; i++)
-        {
-            if (strcmp(settings.frames[i].name, label) == 0)
-            {
-                fs = settings.frames + i;
-                break;
-            }
-        }
+        vdb::frame_settings = FindFrameSettings(label);
 
-        // otherwise add a new one (but only if there's space)
-        if (!fs)
-        {
-            if (settings.num_frames < MAX_FRAME_SETTINGS)
-                fs = settings.frames + (settings.num_frames++);
-            else
-                fs = new frame_settings_t; // will not be saved
-            fs->name = strdup(label);
-            DefaultFrameSettings(fs);
-        }
-
-        assert(fs);
+    window::EnsureContextIsCurrent();
 
-        vdb::frame_settings = fs;
+    bool is_viewer = watch::is_viewer || remote::is_viewer;
+    if (ui::live && !vdb::is_first_frame && !is_viewer)
+    {
+        // the hit was shown for one frame; events are left for the next
+        is_first_frame = true;
+        logs.FlushViews(); // the break is over, see vdbLogView
+        history::Commit(label);
+        return false;
     }
+    window::SetVSync(!ui::live || is_viewer);
 
-    window::EnsureContextIsCurrent();
-
-    if (settings.can_idle && !ui::auto_step)
+    if (settings.can_idle && !ui::auto_step && !(ui::live && !is_viewer))
         window::WaitEvents();
     else
         window::PollEvents();
+    frame_clock::BeginFrame(window::waited_for_events);
+
+    watch::TakeSnapshot();
+    remote::Poll();
 
     window::SetNumSettleFrames(3); // ImGui requires 2-3 frames for e.g. button clicks to settle
     // Subsequent functions in VDB may also require a minimum number of frames to settle,
@@ -288,12 +567,12 @@ bool vdbBeginBreak(const char *label)
     should_step_once |= vdb::want_step_once;
     if (ui::auto_step)
     {
-        static int t = 0;
-        t++;
-        if (t > settings.auto_step_delay_ms*60/1000)
+        static Uint64 last_step = 0;
+        Uint64 now = SDL_GetPerformanceCounter();
+        if (now - last_step >= (Uint64)settings.auto_step_delay_ms*SDL_GetPerformanceFrequency()/1000)
         {
             should_step_once |= true;
-            t = 0;
+            last_step = now;
         }
     }
 
@@ -302,6 +581,8 @@ bool vdbBeginBreak(const char *label)
         vdb::want_step_once = false;
         settings.Save(VDB_SETTINGS_FILENAME);
         is_first_frame = true;
+        logs.FlushViews(); // the break is over, see vdbLogView
+        history::Commit(label);
         return false;
     }
     if (keys::pressed[VDB_KEY_F5] || vdb::want_step_over)
@@ -310,8 +591,17 @@ bool vdbBeginBreak(const char *label)
         settings.Save(VDB_SETTINGS_FILENAME);
         is_first_frame = true;
         skip_label = label;
+        logs.FlushViews(); // the break is over, see vdbLogView
+        history::Commit(label);
         return false;
     }
+    if (window::should_quit && watch::is_viewer)
+    {
+        window::Close();
+        watch::closed = true; // the program keeps running
+    }
+    if (watch::closed && watch::is_viewer)
+        return false;
     if (window::should_quit)
     {
         settings.Save(VDB_SETTINGS_FILENAME);
@@ -325,6 +615,7 @@ bool vdbBeginBreak(const char *label)
     immediate_util::BeginFrame();
     immediate::BeginFrame();
     colormap::BeginFrame();
+    damage::BeginFrame();
 
     ImGui_ImplOpenGL3_NewFrame();
     ImGui_ImplSDL2_NewFrame(window::sdl_window);
@@ -342,6 +633,8 @@ bool vdbBeginBreak(const char *label)
 
     vdb_style_t style = GetStyle();
 
+    dynamic_resolution::BeginFrame(vdb::frame_settings->render_scaler.budget_ms);
+
     glEnable(GL_DEPTH_TEST);
     glDepthMask(GL_TRUE);
     glClearDepth(1.0f);
@@ -350,13 +643,46 @@ bool vdbBeginBreak(const char *label)
     glDepthMask(GL_FALSE);
     glDisable(GL_DEPTH_TEST);
 
-    if (vdb::frame_settings->render_scaler.down > 0)
+    float dynamic_scale = dynamic_resolution::Update(vdb::frame_settings->render_scaler.budget_ms);
+    render_scaler::output_filter = VDB_NEAREST;
+    if (tiled_screenshot::active)
+    {
+        // render scaling is bypassed while capturing
+    }
+    else if (vdb::frame_settings->render_scaler.budget_ms > 0.0f)
+    {
+        if (dynamic_scale < 1.0f)
+        {
+            int w = (int)(window::framebuffer_width*dynamic_scale);
+            int h = (int)(window::framebuffer_height*dynamic_scale);
+            if (w < 1) w = 1;
+            if (h < 1) h = 1;
+            render_scaler::output_filter = VDB_LINEAR;
+            render_scaler::Begin(w, h, 0);
+            glEnable(GL_DEPTH_TEST);
+            glDepthMask(GL_TRUE);
+            glClearDepth(1.0f);
+            glClearColor(style.clear.x, style.clear.y, style.clear.z, 1.0f);
+            glClear(GL_COLOR_BUFFER_BIT|GL_DEPTH_BUFFER_BIT);
+            glDepthMask(GL_FALSE);
+            glDisable(GL_DEPTH_TEST);
+        }
+    }
+    else if (vdb::frame_settings->render_scaler.down > 0)
     {
         int n_down = vdb::frame_settings->render_scaler.down;
         int n_up = vdb::frame_settings->render_scaler.up;
+        bool coarse = false;
+        if (vdb::frame_settings->render_scaler.adaptive)
+        {
+            // drop to 1/(1<<n_down) while interacting, otherwise
+            // refine up to full resolution by interleaving
+            n_up = n_down;
+            coarse = render_scaler::IsInteracting();
+        }
         int w = window::framebuffer_width >> n_down;
         int h = window::framebuffer_height >> n_down;
-        render_scaler::Begin(w, h, n_up);
+        render_scaler::Begin(w, h, n_up, coarse);
         glEnable(GL_DEPTH_TEST);
         glDepthMask(GL_TRUE);
         glClearDepth(1.0f);
@@ -366,52 +692,50 @@ bool vdbBeginBreak(const char *label)
         glDisable(GL_DEPTH_TEST);
     }
 
-    immediate::SetRenderOffsetNDC(vdbGetRenderOffset());
-
-    if (vdb::frame_settings->camera.type != VDB_CUSTOM)
-    {
-        frame_settings_t *fs = vdb::frame_settings;
-        if      (fs->camera.type == VDB_TRACKBALL) vdbCameraTrackball();
-        else if (fs->camera.type == VDB_TURNTABLE) vdbCameraTurntable();
-        else                                              vdbCamera2D();
+    tiled_screenshot::BeginTile();
 
-        if (fs->camera.type != VDB_PLANAR)
-        {
-            vdbDepthTest(true);
-            vdbDepthWrite(true);
-            vdbPerspective(fs->camera.projection.y_fov,
-                fs->camera.projection.min_depth,
-                fs->camera.projection.max_depth);
-        }
-
-        // We do PushMatrix to save current state for drawing grid in vdbEndBreak
-
-        // pre-permutation transform
-        // the built-in cameras assume that y axis is up
-        vdbPushMatrix();
-        vdbOrientation up = *GetCameraUp();
-        if      (up == VDB_Z_UP)   vdbMultMatrix(vdbInitMat4(0,1,0,0, 0,0,1,0, 1,0,0,0, 0,0,0,1).data);
-        else if (up == VDB_X_UP)   vdbMultMatrix(vdbInitMat4(0,0,1,0, 1,0,0,0, 0,1,0,0, 0,0,0,1).data);
-        else if (up == VDB_Z_DOWN) vdbMultMatrix(vdbInitMat4(0,1,0,0, 0,0,-1,0, -1,0,0,0, 0,0,0,1).data);
-        else if (up == VDB_Y_DOWN) vdbMultMatrix(vdbInitMat4(1,0,0,0, 0,-1,0,0, 0,0,-1,0, 0,0,0,1).data);
-        else if (up == VDB_X_DOWN) vdbMultMatrix(vdbInitMat4(0,0,1,0, -1,0,0,0, 0,-1,0,0, 0,0,0,1).data);
+    immediate::SetRenderOffsetNDC(vdbGetRenderOffset());
 
-        // pre-scaling transform
-        vdbPushMatrix();
-        vdbMultMatrix(vdbMatScale(1.0f/fs->grid.grid_scale, 1.0f/fs->grid.grid_scale, 1.0f/fs->grid.grid_scale).data);
-    }
+    BeginCamera();
+    bool is_3D = vdb::frame_settings->camera.type != VDB_PLANAR &&
+                 vdb::frame_settings->camera.type != VDB_CUSTOM;
+    watch::SaveCamera(is_3D);
+    remote::SaveCamera(is_3D);
 
-    CheckGLError();
+    history::BeginFrame();
 
     return true;
 }
 
 void vdbEndBreak()
 {
-    frame_settings_t *fs = vdb::frame_settings;
+    widgets_panel::RecordValues();
+
+    history::EndFrame();
+
+    if (!watch::in_block) // the viewer thread owns the logs
+        log_stream::EndBreak();
+
+    if (window::IsHeadless())
+    {
+        ImGui::EndFrame();
+        if (!watch::in_block)
+            vdb::headless_break_ended = true;
+        return;
+    }
+
+    frame_settings_t *fs = vdb::frame_settings; // the viewer's, in a watched block
+    GLCallSite(fs->name);
 
     if (render_scaler::has_begun)
+    {
         render_scaler::End();
+        damage::Touch(); // may refine over several frames (see render_scaler.h)
+    }
+
+    if (tiled_screenshot::active)
+        damage::Touch();
+    tiled_screenshot::EndTile();
 
     ruler::EndFrame();
 
@@ -613,6 +937,7 @@ void vdbEndBreak()
         }
     }
 
+    bool present = true;
     if (framegrab::active)
     {
         framegrab_options_t opt = framegrab::options;
@@ -642,18 +967,24 @@ void vdbEndBreak()
 
         free(data);
 
+        damage::Touch(); // the frame after the last one captured is presented
+
         window::DontWaitNextFrameEvents();
     }
     else
     {
         ui::MainMenuBar(vdb::frame_settings);
         ui::ShowLogWindows();
+        ui::HistoryWindow();
         ui::WindowSizeDialog();
         ui::FramegrabDialog();
         ui::ExitDialog();
         ruler::DrawOverlay();
         ImGui::Render();
-        ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+        damage::AddDrawData(ImGui::GetDrawData());
+        present = damage::EndFrame(window::framebuffer_width, window::framebuffer_height);
+        if (present)
+            ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
     }
 
     // If any key is down, do not allow window to go idle
@@ -666,6 +997,67 @@ void vdbEndBreak()
         }
     }
 
-    window::SwapBuffers(1.0f/60.0f);
-    CheckGLError();
+    dynamic_resolution::EndFrame();
+    if (present)
+        window::SwapBuffers();
+    dynamic_resolution::AfterSwap();
+    bool is_viewer = watch::is_viewer || remote::is_viewer;
+    window::Pace(present, ui::live && !is_viewer ? 0 : settings.target_fps); // the live view paces itself
+    gl_debug::Check("during the frame");
+}
+
+void vdbTraceRecord(const char *filename)
+{
+    assert(!vdb::initialized && "vdbTraceRecord must be called before the first break");
+    if (!trace::Open(filename))
+        return; // show the window as usual
+
+    vdb::initialized = true;
+    settings.LoadOrDefault(VDB_SETTINGS_FILENAME);
+    window::CreateHeadless(settings.window.width, settings.window.height);
+    vdb::imgui_context = CreateHeadlessImGuiContext();
+}
+
+bool vdbTraceLoad(const char *filename)
+{
+    if (window::IsHeadless())
+        return false;
+    InitializeIfNotAlready();
+    window::EnsureContextIsCurrent();
+    if (!trace::Load(filename))
+        return false;
+    ui::show_history = true;
+    history::viewing = history::frames.empty() ? -1 : 0;
+    return true;
+}
+
+bool vdbRemote(const char *name)
+{
+    assert(!vdb::initialized && "vdbRemote must be called before the first break");
+    if (!remote::Open(name, remote::side_client))
+        return false; // show the window as usual
+
+    remote::is_client = true;
+    vdb::initialized = true;
+    settings.LoadOrDefault(VDB_SETTINGS_FILENAME);
+    window::CreateHeadless(settings.window.width, settings.window.height);
+    vdb::imgui_context = CreateHeadlessImGuiContext();
+    return true;
+}
+
+bool vdbRemoteView(const char *name)
+{
+    if (window::IsHeadless() || remote::header)
+        return false;
+    if (!remote::Open(name, remote::side_viewer))
+        return false;
+    remote::Attach();
+    ui::show_history = true;
+    return true;
+}
+
+void vdbWatch()
+{
+    assert(!vdb::initialized && "vdbWatch must be called before the first break");
+    watch::Start();
 }
@@ -0,0 +1,300 @@
+// Watch mode (vdbWatch). Breaks don't pause the program: a viewer thread owns
+// the window and OpenGL context, and each block runs once without a window
+// (see window::IsHeadless), recording its drawing like a trace does (trace.h).
+// When the block ends, what it recorded becomes the pending snapshot, which
+// the viewer adds to the breakpoint history at its next frame and shows until
+// a newer one arrives (earlier ones can be looked at in Tools > History).
+//
+// Blocks run on their own thread while the viewer draws, so they don't write
+// the viewer's state. What a break sets up anew each frame (the transform,
+// the recorded commands, the widgets, etc.) is thread_local, and what's kept
+// between breaks (imm's lists and vertex buffer, the image slots) or is too
+// big to be per thread (the matrix stacks) is reached through a thread_local
+// pointer, which BeginBlock points at the thread's own block_state_t. The
+// mutex is only held to hand things over: the camera (SaveCamera, BeginBlock),
+// queued images, and the snapshot (EndBlock, TakeSnapshot), so a block never
+// waits for the viewer to draw, and is never skipped. Snapshots are
+// double-buffered: a block swaps its commands with the pending snapshot, so
+// a snapshot that the viewer didn't get to is replaced by the newer one, and
+// neither side copies the commands.
+//
+// Images loaded in a block are queued for the viewer to upload. The viewer
+// owns the log tree, so blocks log through their thread's log stream (see
+// log_stream.h). The camera is moved in the viewer, and blocks draw with its
+// matrices as of its last frame. Blocks read the viewer's settings, window
+// size and input as they are, but its hints are only applied by the viewer
+// (see hints.h). ImGui calls in a block go to the thread's own context and
+// are not shown.
+static ImGuiContext *CreateHeadlessImGuiContext(); // see vdb.cpp
+
+namespace watch
+{
+    struct snapshot_t
+    {
+        const char *label;
+        std::vector<history_cmd_t> cmds;
+        std::vector<char> arena;
+        bool ready;
+    };
+
+    struct queued_image_t
+    {
+        int slot;
+        int width, height, channels;
+        bool is_float;
+        std::vector<char> data;
+    };
+
+    // The viewer's camera, as of its last frame
+    struct view_t
+    {
+        vdbMat4 projection, view_model;
+        bool depth_test;
+    };
+
+    // What a thread's blocks draw with instead of the shared state
+    struct block_state_t
+    {
+        imm_t imm;
+        matrix_stack_t matrix_stack;
+        matrix_stack_t projection_stack;
+        std::vector<imm_vertex_t> list_vertices[IMM_MAX_LISTS];
+        image_t images[MAX_IMAGES];
+        ImGuiContext *context;
+    };
+
+    // Frees the thread's block state when the thread exits
+    struct thread_state_t
+    {
+        block_state_t *block;
+        ~thread_state_t()
+        {
+            if (!block)
+                return;
+            ImGui::DestroyContext(block->context);
+            delete[] block->imm.buffer;
+            delete block;
+        }
+    };
+
+    static bool enabled;
+    static std::atomic<bool> closed(false); // the viewer has stopped (its window was closed, or the program exits)
+    static SDL_Thread *thread;
+    static SDL_mutex *mutex;
+    static SDL_cond *started;
+    static thread_local bool is_viewer;
+    static thread_local thread_state_t thread_state;
+    static thread_local ImGuiContext *thread_context; // current before the block
+    static std::atomic<bool> wake_pending(false);
+    // in_block (see window.h) is set while the thread runs a block
+
+    // guarded by mutex
+    static bool has_started; // the viewer has saved its camera (or stopped)
+    static snapshot_t pending;
+    static std::vector<queued_image_t> queued_images;
+    static view_t view;
+
+    static int ViewerThread(void *)
+    {
+        is_viewer = true;
+        while (!closed)
+        {
+            VDBB("vdbwatch");
+            VDBE();
+        }
+        settings.Save(VDB_SETTINGS_FILENAME);
+        SDL_LockMutex(mutex);
+        has_started = true; // if the window was closed before its first frame
+        SDL_CondSignal(started);
+        SDL_UnlockMutex(mutex);
+        return 0;
+    }
+
+    static void WakeViewer()
+    {
+        if (!wake_pending.exchange(true))
+        {
+            SDL_Event event = {0};
+            event.type = SDL_USEREVENT;
+            SDL_PushEvent(&event); // if it's waiting for events
+        }
+    }
+
+    // Stops the viewer when the program exits
+    static void Stop()
+    {
+        if (!thread || is_viewer || in_block)
+            return;
+        closed = true;
+        WakeViewer();
+        SDL_WaitThread(thread, NULL);
+        thread = NULL;
+    }
+
+    // Starts the viewer thread, and waits until it has drawn its first frame
+    static void Start()
+    {
+        enabled = true;
+        history::follow = true;
+        mutex = SDL_CreateMutex();
+        started = SDL_CreateCond();
+        assert(mutex && started);
+        thread = SDL_CreateThread(ViewerThread, "vdb viewer", NULL);
+        assert(thread);
+        SDL_LockMutex(mutex);
+        while (!has_started)
+            SDL_CondWait(started, mutex);
+        SDL_UnlockMutex(mutex);
+        atexit(Stop);
+    }
+
+    // Points the thread at its block state, and gets the viewer's camera.
+    // Returns false if the viewer has stopped.
+    static bool BeginBlock(view_t *v)
+    {
+        if (closed)
+            return false;
+        block_state_t *b = thread_state.block;
+        if (!b)
+        {
+            b = new block_state_t(); // zeroed
+            b->context = CreateHeadlessImGuiContext();
+            thread_state.block = b;
+        }
+
+        SDL_LockMutex(mutex);
+        *v = view;
+        SDL_UnlockMutex(mutex);
+
+        in_block = true;
+        imm = &b->imm;
+        transform::matrix_stack = &b->matrix_stack;
+        transform::projection_stack = &b->projection_stack;
+        history::list_vertices = b->list_vertices;
+        images = b->images;
+        thread_context = ImGui::GetCurrentContext();
+        ImGui::SetCurrentContext(b->context);
+        return true;
+    }
+
+    // Makes what the block recorded the pending snapshot
+    static void EndBlock(const char *label)
+    {
+        // The viewer has its own draw lists, so the vertices of those that
+        // were drawn go with the commands
+        for (size_t i = 0; i < history::cmds.size(); i++)
+        {
+            history_cmd_t &cmd = history::cmds[i];
+            if (cmd.list < 0)
+                continue;
+            history::AddData(&cmd, history::list_vertices[cmd.list].data(), cmd.count*sizeof(imm_vertex_t));
+            cmd.list = -1;
+        }
+        label = intern::Intern(label); // kept by the history
+
+        ImGui::SetCurrentContext(thread_context);
+        images = shared_images;
+        history::list_vertices = history::shared_list_vertices;
+        transform::projection_stack = &transform::shared_projection_stack;
+        transform::matrix_stack = &transform::shared_matrix_stack;
+        imm = &shared_imm;
+        in_block = false;
+
+        SDL_LockMutex(mutex);
+        std::swap(pending.cmds, history::cmds);
+        std::swap(pending.arena, history::arena);
+        pending.label = label;
+        pending.ready = true;
+        SDL_UnlockMutex(mutex);
+        history::cmds.clear();
+        history::arena.clear();
+        WakeViewer();
+    }
+
+    // Called by vdbLoadImage* in a block
+    static void QueueImage(int slot, const void *data, int width, int height, int channels, bool is_float)
+    {
+        if (!in_block)
+            return;
+        const char *p = (const char*)data;
+        std::vector<char> copy(p, p + (size_t)width*height*channels*(is_float ? sizeof(float) : 1));
+
+        SDL_LockMutex(mutex);
+        queued_image_t *q = NULL;
+        for (size_t i = 0; i < queued_images.size() && !q; i++)
+            if (queued_images[i].slot == slot)
+                q = &queued_images[i]; // not uploaded yet, so it can be replaced
+        if (!q)
+        {
+            queued_images.push_back(queued_image_t());
+            q = &queued_images.back();
+        }
+        q->slot = slot;
+        q->width = width;
+        q->height = height;
+        q->channels = channels;
+        q->is_float = is_float;
+        q->data.swap(copy);
+        SDL_UnlockMutex(mutex);
+    }
+
+    // Called by the viewer after its BeginCamera
+    static void SaveCamera(bool is_3D)
+    {
+        if (!is_viewer)
+            return;
+        SDL_LockMutex(mutex);
+        view.projection = transform::projection;
+        view.view_model = transform::view_model;
+        view.depth_test = is_3D;
+        if (!has_started)
+        {
+            has_started = true;
+            SDL_CondSignal(started);
+        }
+        SDL_UnlockMutex(mutex);
+    }
+
+    // Called by the viewer when it begins a frame: uploads queued images, and
+    // adds the pending snapshot (if any) to the history
+    static void TakeSnapshot()
+    {
+        if (!is_viewer)
+            return;
+        wake_pending = false;
+        static std::vector<queued_image_t> uploads;
+        const char *label = NULL;
+        SDL_LockMutex(mutex);
+        uploads.swap(queued_images);
+        if (pending.ready)
+        {
+            pending.ready = false;
+            label = pending.label;
+            std::swap(pending.cmds, history::cmds);
+            std::swap(pending.arena, history::arena);
+        }
+        SDL_UnlockMutex(mutex);
+
+        for (size_t i = 0; i < uploads.size(); i++)
+        {
+            queued_image_t &q = uploads[i];
+            if (q.is_float) vdbLoadImageFloat32(q.slot, q.data.data(), q.width, q.height, q.channels);
+            else            vdbLoadImageUint8(q.slot, q.data.data(), q.width, q.height, q.channels);
+        }
+        uploads.clear();
+
+        if (!label)
+            return;
+        // The block only knows the images it loaded itself
+        for (size_t i = 0; i < history::cmds.size(); i++)
+        {
+            history_cmd_t &cmd = history::cmds[i];
+            if (cmd.image < 0 || images[cmd.image].volume)
+                continue;
+            cmd.texture = images[cmd.image].handle;
+            if (cmd.type == history_cmd_image)
+                cmd.is_mono = images[cmd.image].channels == 1;
+        }
+        history::Commit(label);
+    }
+}
@@ -24,49 +24,104 @@ struct widget_t
     };
 };
 
+namespace history
+{
+    static bool IsRecording();
+    static void RecordWidgets(const char *text);
+}
+
+// Widgets are found by their interned name (see intern.h), in a map per
+// type, so a block can have hundreds of them and names can be built with
+// sprintf. The panel shows them in the order of their position, which is
+// their index in the order array: new widgets go at the end, and dragging
+// one over another swaps the two, so the order is never sorted.
 namespace widgets_panel
 {
-    enum { MAX_WIDGETS = 1024 };
-    static widget_t widgets[MAX_WIDGETS];
-    static int num_widgets = 0; // Number of variables for the current frame (a uniquely labelled begin/end block)
-    static int selected = -1;
+    // Per thread, so that a watched block's widgets are its own (see watch.h)
+    static thread_local std::vector<widget_t> widgets; // for the current frame (a uniquely labelled begin/end block), in the order they were added
+    static thread_local std::vector<int> order; // indices of widgets, by position
+    static thread_local std::unordered_map<const char*, int> index[WIDGET_TYPE_CHECKBOX + 1]; // interned name -> widget
+    static thread_local int selected = -1;
+
+    // Values in the frame settings (from vdb.ini), by interned name
+    static thread_local std::unordered_map<const char*, const saved_widget_t*> saved;
+    static thread_local frame_settings_t *saved_fs;
+
+    // Direct-mapped cache from the name pointer passed to a widget call to its
+    // interned copy, so that calls with a string literal skip the hashing and
+    // the intern lock (like log_lookup_t). The name is still compared, since
+    // the pointer may be a reused buffer.
+    enum { name_cache_size = 256 };
+    struct name_cache_entry_t { const char *key; const char *name; };
+    static thread_local name_cache_entry_t name_cache[name_cache_size];
+
+    static const char *InternName(const char *name)
+    {
+        name_cache_entry_t *entry = &name_cache[((size_t)name >> 3) & (name_cache_size - 1)];
+        if (entry->key == name && strcmp(entry->name, name) == 0)
+            return entry->name;
+        entry->key = name;
+        entry->name = intern::Intern(name);
+        return entry->name;
+    }
 
     static widget_t *GetWidget(const char *name, widget_type_t type)
     {
-        for (int i = 0; i < num_widgets; i++)
-            if (strcmp(widgets[i].name, name) == 0 && widgets[i].type == type)
-                return &widgets[i];
-        return NULL;
+        std::unordered_map<const char*, int>::iterator it = index[type].find(name);
+        return it != index[type].end() ? &widgets[it->second] : NULL;
+    }
+
+    // The name must be interned. The widget's value is set by the caller.
+    static widget_t *AddWidget(const char *name, widget_type_t type)
+    {
+        int i = (int)widgets.size();
+        widgets.push_back(widget_t());
+        widget_t *widget = &widgets[i];
+        widget->name = name;
+        widget->type = type;
+        widget->changed = false;
+        widget->position = (int)order.size();
+        order.push_back(i);
+        index[type][name] = i;
+        return widget;
     }
 
     static void ImportSavedWidgetSettings(widget_t *w)
     {
-        assert(w->name);
         assert(w);
+        assert(w->name);
+        if (watch::in_block) // the frame settings are the viewer's, which it may be changing
+            return;
         frame_settings_t *fs = GetFrameSettings();
         assert(fs);
-        if (!fs->widgets.widgets)
-            return;
-        for (int i = 0; i < fs->widgets.num_widgets; i++)
+        if (saved_fs != fs)
         {
-            assert(fs->widgets.widgets[i].name);
-            if (strcmp(fs->widgets.widgets[i].name, w->name) == 0)
+            saved.clear();
+            for (int i = 0; i < fs->widgets.num_widgets; i++)
             {
-                // todo: make this work
-                #if 0
-                w->position = fs->widgets.widgets[i].position;
-                #endif
-                if      (w->type == WIDGET_TYPE_FLOAT)    w->f.value = fs->widgets.widgets[i].value;
-                else if (w->type == WIDGET_TYPE_INT)      w->i.value = (int)fs->widgets.widgets[i].value;
-                else if (w->type == WIDGET_TYPE_CHECKBOX) w->t.enabled = fs->widgets.widgets[i].value == 1.0f ? true : false;
-                break;
+                assert(fs->widgets.widgets[i].name);
+                const char *name = intern::Intern(fs->widgets.widgets[i].name);
+                if (saved.find(name) == saved.end()) // the first one wins, as when the list was searched
+                    saved[name] = &fs->widgets.widgets[i];
             }
+            saved_fs = fs;
         }
+        std::unordered_map<const char*, const saved_widget_t*>::iterator it = saved.find(w->name);
+        if (it == saved.end())
+            return;
+        const saved_widget_t *s = it->second;
+        if      (w->type == WIDGET_TYPE_FLOAT)    w->f.value = s->value;
+        else if (w->type == WIDGET_TYPE_INT)      w->i.value = (int)s->value;
+        else if (w->type == WIDGET_TYPE_CHECKBOX) w->t.enabled = s->value == 1.0f ? true : false;
     }
 
     static void NewFrame()
     {
-        num_widgets = 0;
+        widgets.clear();
+        order.clear();
+        for (int type = 0; type <= WIDGET_TYPE_CHECKBOX; type++)
+            index[type].clear();
+        saved_fs = NULL; // the frame settings' list may have been replaced
         selected = -1;
     }
 
@@ -76,25 +131,46 @@ namespace widgets_panel
             selected = -1;
     }
 
+    // Records the widget values of this frame, one per line, in the breakpoint history
+    static void RecordValues()
+    {
+        if (widgets.empty() || !history::IsRecording())
+            return;
+        std::vector<char> buffer(16*1024); // not static, since watched blocks record on their own thread
+        char *text = buffer.data();
+        size_t used = 0;
+        text[0] = '\0';
+        for (size_t i = 0; i < widgets.size() && used < buffer.size(); i++)
+        {
+            widget_t &w = widgets[i];
+            char *end = text + used;
+            size_t left = buffer.size() - used;
+            int n = 0;
+            if      (w.type == WIDGET_TYPE_FLOAT)    { n = snprintf(end, left, "%s: ", w.name); if (n >= 0 && (size_t)n < left) n += snprintf(end + n, left - n, w.f.format, w.f.value); }
+            else if (w.type == WIDGET_TYPE_INT)      n = snprintf(end, left, "%s: %d", w.name, w.i.value);
+            else if (w.type == WIDGET_TYPE_CHECKBOX) n = snprintf(end, left, "%s: %s", w.name, w.t.enabled ? "true" : "false");
+            else continue; // buttons have no value
+            if (n < 0 || (size_t)n + 1 >= left)
+            {
+                *end = '\0'; // drop the truncated line
+                break;
+            }
+            used += n;
+            text[used++] = '\n';
+            text[used] = '\0';
+        }
+        history::RecordWidgets(text);
+    }
+
     static void EndFrame()
     {
-        if (num_widgets == 0)
+        if (widgets.empty())
             return;
 
         static bool is_hovered = false;
         static bool context_menu_open = false;
         static bool unlocked = false;
-
-        struct index_t { int index; int position; };
-        static index_t indices[MAX_WIDGETS];
-        for (int i = 0; i < num_widgets; i++)
-            indices[i] = { i, widgets[i].position };
-
-        qsort(indices, num_widgets, sizeof(index_t), [](const void *pa, const void *pb){
-            const index_t *a = (const index_t*)pa;
-            const index_t *b = (const index_t*)pb;
-            return a->position < b->position ? -1 : +1;
-        });
+        int swap_with = -1; // applied after the loop, so each widget is drawn once
 
         // Set style
         vdb_style_t style = GetStyle();
@@ -116,9 +192,9 @@ namespace widgets_panel
         ImGui::Begin("Quick Var##vdb", NULL, flags);
         is_hovered = ImGui::IsWindowHovered() || ImGui::IsWindowFocused() || context_menu_open;
         ImGui::PushItemWidth(120.0f);
-        for (int j = 0; j < num_widgets; j++)
+        for (size_t j = 0; j < order.size(); j++)
         {
-            int i = indices[j].index;
+            int i = order[j];
             widget_t &w = widgets[i];
 
             ImGui::BeginGroup();
@@ -143,15 +219,19 @@ namespace widgets_panel
                     selected = i;
 
                 if (ImGui::IsItemHovered() && ImGui::IsMouseDown(0) && selected >= 0 && i != selected)
-                {
-                    int temp = widgets[selected].position;
-                    widgets[selected].position = widgets[i].position;
-                    widgets[i].position = temp;
-                }
+                    swap_with = i;
             }
         }
         ImGui::PopItemWidth();
 
+        if (swap_with >= 0)
+        {
+            widget_t &a = widgets[selected];
+            widget_t &b = widgets[swap_with];
+            std::swap(order[a.position], order[b.position]);
+            std::swap(a.position, b.position);
+        }
+
         if (ImGui::BeginPopup("widget context menu"))
         {
             context_menu_open = true;
@@ -177,19 +257,15 @@ namespace widgets_panel
 float vdbSliderFloat(const char *name, float vmin, float vmax, float vinit, const char *format)
 {
     using namespace widgets_panel;
+    name = InternName(name);
     widget_t *widget = GetWidget(name, WIDGET_TYPE_FLOAT);
     if (!widget)
     {
-        assert(num_widgets < MAX_WIDGETS && "Reached maximum number of widgets");
-        widget = &widgets[num_widgets++];
-        widget->position = num_widgets;
-        widget->changed = false;
+        widget = AddWidget(name, WIDGET_TYPE_FLOAT);
         widget->f.value = vinit;
         widget->f.vmin = vmin;
         widget->f.vmax = vmax;
         widget->f.format = format;
-        widget->name = name;
-        widget->type = WIDGET_TYPE_FLOAT;
         ImportSavedWidgetSettings(widget);
     }
     return widget->f.value;
@@ -197,18 +273,14 @@ float vdbSliderFloat(const char *name, float vmin, float vmax, float vinit, cons
 int vdbSliderInt(const char *name, int vmin, int vmax, int vinit)
 {
     using namespace widgets_panel;
+    name = InternName(name);
     widget_t *widget = GetWidget(name, WIDGET_TYPE_INT);
     if (!widget)
     {
-        assert(num_widgets < MAX_WIDGETS && "Reached maximum number of widgets");
-        widget = &widgets[num_widgets++];
-        widget->position = num_widgets;
-        widget->changed = false;
+        widget = AddWidget(name, WIDGET_TYPE_INT);
         widget->i.value = vinit;
         widget->i.vmin = vmin;
         widget->i.vmax = vmax;
-        widget->name = name;
-        widget->type = WIDGET_TYPE_INT;
         ImportSavedWidgetSettings(widget);
     }
     return widget->i.value;
@@ -216,16 +288,12 @@ int vdbSliderInt(const char *name, int vmin, int vmax, int vinit)
 bool vdbCheckbox(const char *name, bool init)
 {
     using namespace widgets_panel;
+    name = InternName(name);
     widget_t *widget = GetWidget(name, WIDGET_TYPE_CHECKBOX);
     if (!widget)
     {
-        assert(num_widgets < MAX_WIDGETS && "Reached maximum number of widgets");
-        widget = &widgets[num_widgets++];
-        widget->position = num_widgets;
-        widget->changed = false;
+        widget = AddWidget(name, WIDGET_TYPE_CHECKBOX);
         widget->t.enabled = init;
-        widget->name = name;
-        widget->type = WIDGET_TYPE_CHECKBOX;
         ImportSavedWidgetSettings(widget);
     }
     return widget->t.enabled;
@@ -233,15 +301,11 @@ bool vdbCheckbox(const char *name, bool init)
 bool vdbButton(const char *name)
 {
     using namespace widgets_panel;
+    name = InternName(name);
     widget_t *widget = GetWidget(name, WIDGET_TYPE_BUTTON);
     if (!widget)
     {
-        assert(num_widgets < MAX_WIDGETS && "Reached maximum number of widgets");
-        widget = &widgets[num_widgets++];
-        widget->position = num_widgets;
-        widget->changed = false;
-        widget->name = name;
-        widget->type = WIDGET_TYPE_BUTTON;
+        widget = AddWidget(name, WIDGET_TYPE_BUTTON);
         ImportSavedWidgetSettings(widget);
     }
     return widget->changed;
@@ -8,10 +8,18 @@
 #include "SDL_syswm.h"
 #endif
 
+namespace watch
+{
+    static thread_local bool in_block; // see watch.h
+}
+
 void PostGLCallback(const char *name, void *funcptr, int len_args, ...) {
     (void) funcptr;
     (void) len_args;
 
+    if (gl_debug::active) // the driver reports errors as they happen (see gl_debug.h)
+        return;
+
     GLenum error_code = glad_glGetError();
 
     if (error_code != GL_NO_ERROR) {
@@ -42,6 +50,30 @@ namespace window
 
     static bool dont_wait_next_frame_events;
 
+    // While recording a trace (vdbTraceRecord) there is no window or OpenGL
+    // context, and the functions that would use OpenGL only record what they do.
+    static bool headless;
+
+    // Watched blocks (vdbWatch) run like this too, on their own thread. So a
+    // headless thread has no context, and since the OpenGL functions are shared
+    // by all threads, the functions that use them check this themselves: they
+    // keep vdb's own copy of what they set (imm->state, the transform stacks,
+    // the bound image) and skip the OpenGL calls. The drawing and state helpers
+    // (DrawImmediate, immediate::SetEnabled, FindUniform) do this in one place.
+    static bool IsHeadless()
+    {
+        return headless || watch::in_block;
+    }
+
+    static void CreateHeadless(int width, int height)
+    {
+        headless = true;
+        framebuffer_width = width;
+        framebuffer_height = height;
+        window_width = width;
+        window_height = height;
+    }
+
     static void CreateContext(int x, int y, int width, int height)
     {
         if (sdl_window)
@@ -64,7 +96,11 @@ namespace window
         SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
         SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 1); // todo: have not tested on OSX!
         #else
+        #ifdef VDB_DEBUG
+        SDL_GL_SetAttribute(SDL_GL_CONTEXT_FLAGS, SDL_GL_CONTEXT_DEBUG_FLAG); // see gl_debug.h
+        #else
         SDL_GL_SetAttribute(SDL_GL_CONTEXT_FLAGS, 0);
+        #endif
         SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
         SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
         SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 1);
@@ -183,15 +219,40 @@ namespace window
         visible = true;
     }
 
-    static void SwapBuffers(float dt)
+    // Vsync is turned off in the live view (vdbLiveView), so that showing a hit
+    // doesn't wait for the display
+    static void SetVSync(bool enabled)
+    {
+        static bool current = true;
+        if (enabled == current)
+            return;
+        current = enabled;
+        SDL_GL_SetSwapInterval(enabled ? 1 : 0);
+        vsynced = enabled && SDL_GL_GetSwapInterval() == 1;
+    }
+
+    static void SwapBuffers()
     {
         assert(sdl_window);
         SDL_GL_SwapWindow(sdl_window);
-        if (!vsynced && dt < 1.0f/60.0f)
+    }
+
+    // Called at the end of a frame. Without vsync the loop is paced to fps frames per
+    // second (0 is unlimited). A frame that wasn't presented (see damage.h) waits
+    // about as long as a vsynced swap would, so the loop doesn't spin.
+    static void Pace(bool presented, int fps)
+    {
+        if (!presented && vsynced)
         {
-            float sleep_s = (1.0f/60.0f) - dt;
-            Uint32 sleep_ms = (Uint32)(sleep_s*1000.0f);
-            SDL_Delay(sleep_ms);
+            SDL_DisplayMode mode;
+            if (SDL_GetWindowDisplayMode(sdl_window, &mode) == 0 && mode.refresh_rate > 0)
+                frame_clock::Pace(mode.refresh_rate);
+            else
+                frame_clock::Pace(60);
+        }
+        else if (!vsynced)
+        {
+            frame_clock::Pace(fps);
         }
     }
 
@@ -267,6 +328,11 @@ namespace window
             if (event->wheel.y > 0) mouse::wheel = +1.0f;
             else if (event->wheel.y < 0) mouse::wheel = -1.0f;
         }
+        else
+        if (event->type == SDL_WINDOWEVENT)
+        {
+            damage::Touch(); // e.g. exposed or resized: what's on the screen may be gone
+        }
     }
 
     static void DontWaitNextFrameEvents()
@@ -274,8 +340,11 @@ namespace window
         dont_wait_next_frame_events = true;
     }
 
+    static bool waited_for_events; // in the last call to WaitEvents (see frame_clock.h)
+
     static void PollEvents()
     {
+        waited_for_events = false;
         BeforeEvents();
         SDL_Event event;
         while (SDL_PollEvent(&event))
@@ -302,6 +371,7 @@ namespace window
         {
             idle_frames++;
             dont_wait_next_frame_events = false;
+            waited_for_events = false;
 
             BeforeEvents();
             SDL_Event event;
@@ -314,6 +384,7 @@ namespace window
         }
         else
         {
+            waited_for_events = true;
             BeforeEvents();
             SDL_Event event;
             SDL_WaitEvent(&event);
@@ -5,3 +5,4 @@ set INCLUDES=/I..\include
 set SOURCES=test.cpp
 set LIBS=/libpath:%SDL2_DIR%\lib\x86 /libpath:%VDB_DIR%\lib vdb.lib SDL2.lib SDL2main.lib opengl32.lib
 cl /nologo /Zi /MD %INCLUDES% test.cpp /link %LIBS% /subsystem:console
+cl /nologo /Zi /MD %INCLUDES% test_logs.cpp /link %LIBS% /subsystem:console
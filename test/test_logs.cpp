@@ -0,0 +1,53 @@
+// Checks logging from a program that never breaks: the log tree has no
+// owner, so vdbLogDump must take it and drain what main and a worker thread
+// logged, and flush pending views. Runs without a window, and returns nonzero on failure.
+//
+// Build vdb as a library first (see test.cpp), then run make or build.bat.
+#include <stdio.h>
+#include <string.h>
+#include <thread>
+#include <vdb.h>
+
+static bool Contains(const char *filename, const char *text)
+{
+    FILE *f = fopen(filename, "rb");
+    if (!f)
+        return false;
+    static char buffer[64*1024];
+    size_t n = fread(buffer, 1, sizeof(buffer) - 1, f);
+    fclose(f);
+    buffer[n] = '\0';
+    return strstr(buffer, text) != NULL;
+}
+
+int main(int, char **)
+{
+    for (int i = 0; i < 3; i++)
+        vdbLogScalar("main", (float)i);
+    std::thread worker([] { vdbLogScalar("worker", 7.0f); });
+    worker.join();
+
+    const char *filename = "test_logs.txt";
+    vdbLogDump(filename);
+    bool ok = true;
+    if (!Contains(filename, "\"main\": [0, 1, 2]")) { fprintf(stderr, "FAIL: main's samples are missing\n"); ok = false; }
+    if (!Contains(filename, "\"worker\": 7"))       { fprintf(stderr, "FAIL: the worker's sample is missing\n"); ok = false; }
+
+    // main now owns the tree, and logs into it directly
+    vdbLogScalar("main", 3.0f);
+    vdbLogDump(filename);
+    if (!Contains(filename, "\"main\": [0, 1, 2, 3]")) { fprintf(stderr, "FAIL: main's later sample is missing\n"); ok = false; }
+
+    // without breaks, a dump ends the view: x is copied then, and may change after
+    float x = 1.0f;
+    vdbLogView("view", &x, sizeof(x), VDB_FLOAT32, 1);
+    x = 5.0f;
+    vdbLogDump(filename);
+    x = 9.0f;
+    vdbLogDump(filename);
+    if (!Contains(filename, "\"view\": [5]")) { fprintf(stderr, "FAIL: the view wasn't flushed by the dump\n"); ok = false; }
+
+    remove(filename);
+    printf(ok ? "test_logs: ok\n" : "test_logs: failed\n");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,22 @@
+// The loop of vdbbench.cpp, compiled with VDB_DISABLE
+#define VDB_DISABLE
+#include <chrono>
+#include <vdb.h>
+
+double RunDisabled(int iterations)
+{
+    volatile float x = 0.0f;
+    std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++)
+    {
+        VDBB("vdbbench");
+        vdbBeginPoints();
+        vdbVertex(x, x);
+        vdbEnd();
+        VDBE();
+        vdbLogScalar("x", x);
+        vdbVertex(x, x);
+    }
+    std::chrono::duration<double, std::nano> ns = std::chrono::steady_clock::now() - begin;
+    return ns.count();
+}
@@ -0,0 +1,39 @@
+// Shows a trace file written with vdbTraceRecord. The recorded hits are in
+// the History window, where you can scrub through them, along with the logs
+// (in the group /trace) and the widget values of each hit. With -r, it is the
+// viewer of a program that called vdbRemote(name) instead, and shows its hits
+// as they arrive (either may be started first, and restarted).
+//
+// Build vdb as a library first (see test/test.cpp), then run make or build.bat.
+// Usage: vdbreplay file.vdbtrace
+//        vdbreplay -r name
+#include <stdio.h>
+#include <string.h>
+#include <vdb.h>
+
+int main(int argc, char **argv)
+{
+    if (argc == 3 && strcmp(argv[1], "-r") == 0)
+    {
+        if (!vdbRemoteView(argv[2]))
+        {
+            fprintf(stderr, "vdbreplay: could not open '%s'\n", argv[2]);
+            return 1;
+        }
+    }
+    else if (argc != 2)
+    {
+        fprintf(stderr, "usage: %s file.vdbtrace\n       %s -r name\n", argv[0], argv[0]);
+        return 1;
+    }
+    else if (!vdbTraceLoad(argv[1]))
+    {
+        fprintf(stderr, "vdbreplay: could not load '%s'\n", argv[1]);
+        return 1;
+    }
+    for (;;) // exits when the window is closed
+    {
+        VDBB("vdbreplay");
+        VDBE();
+    }
+}